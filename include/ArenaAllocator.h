@@ -0,0 +1,265 @@
+#ifndef ARENAALLOCATOR_H
+#define ARENAALLOCATOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+class ArenaAllocatorBase
+{
+public:
+	//Number of blocks requested to the heap by all the arenas
+	static size_t GetHeapAllocations() { return heapAllocations.load(std::memory_order_relaxed);	}
+
+protected:
+	static inline std::atomic<size_t> heapAllocations = 0;
+};
+
+/**
+ * Allocator that keeps freed single objects on a per thread arena.
+ *
+ * Meant for std::allocate_shared of objects created and destroyed at packet
+ * rate, so the object and its control block are recycled instead of going
+ * through malloc. Each block remembers the arena it was allocated from, and
+ * blocks freed on another thread are pushed to a lock free remote list of the
+ * owning arena, which is drained by the owner when its local list is empty.
+ * Arenas are kept alive after their thread exits until all their blocks are
+ * released, and blocks allocated during thread teardown are not cached.
+ */
+template <typename T, size_t MaxCached = 4096>
+class ArenaAllocator : public ArenaAllocatorBase
+{
+public:
+	using value_type = T;
+
+	template <typename U>
+	struct rebind
+	{
+		using other = ArenaAllocator<U, MaxCached>;
+	};
+
+	ArenaAllocator() = default;
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U, MaxCached>&) {}
+
+	T* allocate(size_t n)
+	{
+		//Only single objects are cached
+		if (n!=1)
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+
+		Arena* arena = GetArena();
+
+		//If the thread arena is already gone, like from other thread_local destructor
+		if (!arena)
+		{
+			//Allocate unowned block, it will be freed on release
+			Node* node = static_cast<Node*>(::operator new(sizeof(Node)));
+			node->arena = nullptr;
+			heapAllocations.fetch_add(1, std::memory_order_relaxed);
+			return reinterpret_cast<T*>(node->object);
+		}
+
+		//If there are no local free blocks
+		if (!arena->head)
+			//Get the ones released by other threads
+			arena->Drain();
+
+		Node* node = arena->head;
+
+		//If there is any free block
+		if (node)
+		{
+			//Pop it
+			arena->head = node->next;
+			arena->cached--;
+		} else {
+			//Allocate new one
+			node = static_cast<Node*>(::operator new(sizeof(Node)));
+			node->arena = arena;
+			heapAllocations.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		//Owned by the application now
+		arena->outstanding++;
+
+		return reinterpret_cast<T*>(node->object);
+	}
+
+	void deallocate(T* p, size_t n)
+	{
+		//Only single objects are cached
+		if (n!=1)
+			return ::operator delete(p);
+
+		Node* node = reinterpret_cast<Node*>(reinterpret_cast<unsigned char*>(p) - offsetof(Node, object));
+		Arena* arena = node->arena;
+
+		//If it was allocated after its thread arena was gone
+		if (!arena)
+			return ::operator delete(node);
+
+		//If it was allocated on other thread
+		if (arena!=GetArena())
+			//Give it back to its owner
+			return arena->Release(node);
+
+		//Not owned by the application anymore
+		arena->outstanding--;
+
+		//If we have too many already
+		if (arena->cached>=MaxCached)
+			return ::operator delete(node);
+
+		//Push it
+		node->next = arena->head;
+		arena->head = node;
+		arena->cached++;
+	}
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U, MaxCached>&) const { return true;	}
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U, MaxCached>&) const { return false;	}
+
+private:
+	struct Arena;
+
+	struct Node
+	{
+		Arena* arena;
+		union
+		{
+			Node* next;
+			alignas(T) unsigned char object[sizeof(T)];
+		};
+	};
+
+	struct Arena
+	{
+		//Only accessed by the owner thread
+		Node* head = nullptr;
+		size_t cached = 0;
+		size_t outstanding = 0;
+		//Blocks released by other threads
+		std::atomic<Node*> remote = nullptr;
+		//Blocks still to be released after the owner thread exited
+		std::atomic<intptr_t> pending = 0;
+
+		static Node* Closed() { return reinterpret_cast<Node*>(uintptr_t(1));	}
+
+		void Drain()
+		{
+			//Get all blocks released by other threads at once
+			Node* node = remote.exchange(nullptr, std::memory_order_acquire);
+
+			while (node)
+			{
+				Node* next = node->next;
+				//Not owned by the application anymore
+				outstanding--;
+				//Cache it or free it if we have too many already
+				if (cached<MaxCached)
+				{
+					node->next = head;
+					head = node;
+					cached++;
+				} else {
+					::operator delete(node);
+				}
+				node = next;
+			}
+		}
+
+		void Release(Node* node)
+		{
+			Node* next = remote.load(std::memory_order_relaxed);
+
+			//Push it to the remote list
+			while (next!=Closed())
+			{
+				node->next = next;
+				if (remote.compare_exchange_weak(next, node, std::memory_order_release, std::memory_order_relaxed))
+					//Done
+					return;
+			}
+
+			//Owner thread is gone, free it
+			::operator delete(node);
+
+			//If it was the last one
+			if (pending.fetch_sub(1, std::memory_order_acq_rel)==1)
+				delete this;
+		}
+
+		void Close()
+		{
+			//Get blocks released so far
+			Drain();
+
+			//Free all cached blocks
+			while (head)
+			{
+				Node* node = head;
+				head = node->next;
+				::operator delete(node);
+			}
+
+			//Blocks released from now on will be freed by the releasing thread
+			Node* node = remote.exchange(Closed(), std::memory_order_acquire);
+
+			//Free the ones that raced with us
+			while (node)
+			{
+				Node* next = node->next;
+				outstanding--;
+				::operator delete(node);
+				node = next;
+			}
+
+			//If there are no blocks left in use
+			if (pending.fetch_add(outstanding, std::memory_order_acq_rel)+(intptr_t)outstanding==0)
+				delete this;
+		}
+	};
+
+	//Trivially destructible, so it is still readable after the owner is destroyed
+	struct Local
+	{
+		Arena* arena;
+		bool closed;
+	};
+
+	struct Owner
+	{
+		Local& local;
+
+		~Owner()
+		{
+			//Release on thread exit
+			local.arena->Close();
+			//Late allocations and frees on this thread don't use it anymore
+			local.arena = nullptr;
+			local.closed = true;
+		}
+	};
+
+	static Arena* GetArena()
+	{
+		static thread_local Local local = {};
+
+		//If first use on this thread
+		if (!local.arena && !local.closed)
+		{
+			//Create it
+			local.arena = new Arena();
+			//Close it on thread exit
+			static thread_local Owner owner = { local };
+		}
+
+		return local.arena;
+	}
+};
+
+#endif /* ARENAALLOCATOR_H */
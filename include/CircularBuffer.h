@@ -1,6 +1,7 @@
 #ifndef CIRCULARBUFFER_H
 #define CIRCULARBUFFER_H
 
+#include <array>
 #include <optional>
 #include "WrapExtender.h"
 
@@ -107,6 +108,16 @@ public:
 		return static_cast<S>(first);
 	}
 
+	uint64_t GetFirstExtSeq() const
+	{
+		return first;
+	}
+
+	uint64_t GetLastExtSeq() const
+	{
+		return last;
+	}
+
 	uint64_t GetLength() const
 	{
 		return first != std::numeric_limits<uint64_t>::max() ? last - first + 1 : 0;
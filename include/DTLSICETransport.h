@@ -31,6 +31,8 @@
 #include "Endpoint.h"
 #include "SRTPSession.h"
 #include "SendSideBandwidthEstimation.h"
+#include "CircularBuffer.h"
+#include "Pacer.h"
 
 class DTLSICETransport : 
 	public RTPSender,
@@ -65,7 +67,7 @@ public:
 	};
 
 public:
-	DTLSICETransport(Sender *sender,TimeService& timeService, ObjectPool<Packet>& packetPool);
+	DTLSICETransport(Sender *sender,TimeService& timeService, PacketPool& packetPool);
 	virtual ~DTLSICETransport();
 	
 	void Start();
@@ -78,6 +80,7 @@ public:
 	virtual int Reset(DWORD ssrc) override;
 	virtual int Enqueue(const RTPPacket::shared& packet) override;
 	virtual int Enqueue(const RTPPacket::shared& packet,std::function<RTPPacket::shared(const RTPPacket::shared&)> modifier) override;
+	virtual int Enqueue(std::vector<RTPPacket::shared>&& packets) override;
 	int Dump(const char* filename, bool inbound = true, bool outbound = true, bool rtcp = true, bool rtpHeadersOnly = false);
 	int Dump(UDPDumper* dumper, bool inbound = true, bool outbound = true, bool rtcp = true, bool rtpHeadersOnly = false);
 	int StopDump();
@@ -121,6 +124,9 @@ public:
 	virtual int onData(const ICERemoteCandidate* candidate,const BYTE* data,DWORD size)  override;
 	
 	DWORD GetRTT() const { return rtt; }
+	//Packets enqueued from other threads and loop wakeups needed to send them
+	QWORD GetEnqueuedPackets() const { return enqueuedPackets;	}
+	QWORD GetEnqueueWakeups() const	 { return enqueueWakeups;	}
 	
 	TimeService& GetTimeService() { return timeService; }
 	
@@ -130,11 +136,17 @@ private:
 	void SetState(DTLSState state);
 	void CheckProbeTimer();
 	void Probe(QWORD now);
+	bool IsPacing();
+	void Pace(QWORD now);
+	void ScheduleEnqueued();
 	int Send(RTPPacket::shared&& packet);
+	int SendNow(RTPPacket::shared&& packet);
 	int Send(const RTCPCompoundPacket::shared& rtcp);
+	int SendRTCP(Packet&& buffer,DWORD len);
 	void SetRTT(DWORD rtt,QWORD now);
-	void onRTCP(const RTCPCompoundPacket::shared &rtcp);
+	void onRTCP(const RTCPCompoundView& rtcp);
 	void ReSendPacket(RTPOutgoingSourceGroup *group,WORD seq);
+	void ReSendPacketNow(RTPOutgoingSourceGroup *group,const RTPPacket::shared& original);
 	DWORD SendProbe(const RTPPacket::shared& packet);
 	DWORD SendProbe(RTPOutgoingSourceGroup *group,BYTE padding);
 	void SendTransportWideFeedbackMessage(DWORD ssrc);
@@ -163,7 +175,7 @@ private:
 private:
 	Sender*		sender = nullptr;
 	TimeService&	timeService;
-	ObjectPool<Packet>& packetPool;
+	PacketPool& packetPool;
 	datachannels::impl::Endpoint endpoint;
 	datachannels::Endpoint::Options dcOptions;
 	Listener*	listener = nullptr;
@@ -171,13 +183,13 @@ private:
 	DTLSState	state = DTLSState::New;
 	Maps		sendMaps;
 	Maps		recvMaps;
+	RTPSendProfile	sendProfile;
 	ICERemoteCandidate* active			= nullptr;
 	SRTPSession	send;
 	SRTPSession	recv;
 	WORD		transportSeqNum			= 0;
 	WORD		feedbackPacketCount		= 0;
 	DWORD		lastFeedbackPacketExtSeqNum	= 0;
-	WORD		feedbackCycles			= 0;
 	OutgoingStreams outgoing;
 	IncomingStreams incoming;
 	std::map<std::string,RTPIncomingSourceGroup*> rids;
@@ -196,7 +208,11 @@ private:
 	Acumulator<uint32_t, uint64_t> rtxBitrate;
 	Acumulator<uint32_t, uint64_t> probingBitrate;
 	
-	std::map<DWORD,PacketStats::shared> transportWideReceivedPacketsStats;
+	//Receive time of each packet by transport wide seq num, and the ones not reported yet
+	CircularBuffer<QWORD,WORD,4096> transportWideReceivedPacketsStats;
+	DWORD transportWidePendingPackets		= 0;
+	QWORD transportWideFirstPendingExtSeqNum	= 0;
+	QWORD transportWideFirstPendingTime		= 0;
 	
 	std::unique_ptr<UDPDumper> dumper;
 	volatile bool dumpInRTP			= false;
@@ -208,7 +224,16 @@ private:
 	DWORD probingBitrateLimit		= maxProbingBitrate *4;
 	volatile bool senderSideEstimationEnabled = true;
 
-	Timer::shared probingTimer;
+	//Packets enqueued from other threads, sent on next loop wakeup
+	moodycamel::ConcurrentQueue<RTPPacket::shared> enqueued;
+	std::atomic<bool> enqueuedScheduled	= false;
+	std::atomic<QWORD> enqueuedPackets	= 0;
+	std::atomic<QWORD> enqueueWakeups	= 0;
+
+	//Releases paced packets and sends probing padding when there is nothing queued
+	Pacer	pacer;
+	Timer::shared pacerTimer;
+	bool	probingActive = false;
 	QWORD   lastProbe = 0;
 	QWORD 	initTime = 0;
 	volatile bool started = false;
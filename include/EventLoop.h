@@ -2,6 +2,7 @@
 #define EVENTLOOP_H
 
 #include <thread>
+#include <vector>
 #include <functional>
 #include <chrono>
 #include <optional>
@@ -11,7 +12,7 @@
 #include "config.h"
 #include "concurrentqueue.h"
 #include "Packet.h"
-#include "ObjectPool.h"
+#include "PacketPool.h"
 #include "TimeService.h"
 #include "FileDescriptor.h"
 #include "PacketHeader.h"
@@ -33,6 +34,21 @@ public:
 		Lagging,
 		Overflown
 	};
+	enum class Backend
+	{
+		Poll,
+		IoUring
+	};
+	struct Stats
+	{
+		//Segments per syscall are sentPackets/sendCalls and recvPackets/recvCalls
+		uint64_t sendCalls	= 0;
+		uint64_t sentDatagrams	= 0;
+		uint64_t sentPackets	= 0;
+		uint64_t recvCalls	= 0;
+		uint64_t recvDatagrams	= 0;
+		uint64_t recvPackets	= 0;
+	};
 	
 	static bool SetAffinity(std::thread::native_handle_type thread, int cpu);
 	static bool SetThreadName(std::thread::native_handle_type thread, const std::string& name);
@@ -59,6 +75,7 @@ private:
 		TimerImpl(const TimerImpl&) = delete;
 		virtual void Cancel() override;
 		virtual void Again(const std::chrono::milliseconds& ms) override;
+		virtual void Again(const std::chrono::microseconds& us) override;
 		virtual void Repeat(const std::chrono::milliseconds& repeat) override;
 		virtual void Reschedule(const std::chrono::milliseconds& ms, const std::chrono::milliseconds& repeat) override;
 		virtual bool IsScheduled()			const override { return next.count();	}
@@ -69,6 +86,15 @@ private:
 		std::chrono::milliseconds next;
 		std::chrono::milliseconds repeat;
 		std::function<void(std::chrono::milliseconds)> callback;
+
+		//Timing wheel intrusive node, the wheel keeps a reference while scheduled
+		std::chrono::microseconds when	= 0us;
+		uint64_t	tick		= 0;
+		uint8_t		level		= 0;
+		uint8_t		slot		= 0;
+		TimerImpl*	prev		= nullptr;
+		TimerImpl*	following	= nullptr;
+		shared		scheduled;
 	};
 	
 	struct RawTx
@@ -89,7 +115,8 @@ public:
 	virtual ~EventLoop();
 	
 	bool Start(std::function<void(void)> loop);
-	bool Start(int fd = FD_INVALID);
+	//The io_uring backend falls back to poll if it is not supported by the kernel
+	bool Start(int fd = FD_INVALID, Backend backend = Backend::Poll);
 	bool Stop();
 	
 	virtual const std::chrono::milliseconds GetNow() const override { return now; }
@@ -97,6 +124,7 @@ public:
 	virtual Timer::shared CreateTimer(const std::chrono::milliseconds& ms, std::function<void(std::chrono::milliseconds)> timeout) override;
 	virtual Timer::shared CreateTimer(const std::chrono::milliseconds& ms, const std::chrono::milliseconds& repeat, std::function<void(std::chrono::milliseconds)> timeout) override;
 	virtual std::future<void> Async(std::function<void(std::chrono::milliseconds)> func) override;
+	virtual void Post(Task&& task) override;
 	
 	void Send(const uint32_t ipAddr, const uint16_t port, Packet&& packet, const std::optional<PacketHeader::FlowRoutingInfo>& rawTxData = std::nullopt, const std::optional<std::function<void(std::chrono::milliseconds)>>& callback = std::nullopt);
 	void Run(const std::chrono::milliseconds &duration = std::chrono::milliseconds::max());
@@ -107,25 +135,37 @@ public:
 	bool SetThreadName(const std::string& name);
 	bool SetPriority(int priority);
 	bool IsRunning() const { return running; }
+	//Updated from the loop thread without locking, values may be slightly outdated
+	const Stats& GetStats() const { return stats; }
 	
 
-	ObjectPool<Packet>& GetPacketPool() { return packetPool; }
+	PacketPool& GetPacketPool() { return packetPool; }
 
 protected:
 	void Signal();
 	void ClearSignal();
 	inline void AssertThread() const { assert(std::this_thread::get_id()==thread.get_id()); }
+	inline bool IsLoopThread() const { return std::this_thread::get_id()==thread.get_id(); }
 	void CancelTimer(TimerImpl::shared timer);
+	void ScheduleTimer(const TimerImpl::shared& timer, const std::chrono::microseconds& when);
 	
 	void ProcessTasks(const std::chrono::milliseconds& now);
 	void ProcessTriggers(const std::chrono::milliseconds& now);
-	int  GetNextTimeout(int defaultTimeout, const std::chrono::milliseconds& until = std::chrono::milliseconds::max()) const;
+	std::chrono::microseconds GetNextTimeout(const std::chrono::microseconds& defaultTimeout, const std::chrono::milliseconds& until = std::chrono::milliseconds::max()) const;
 	const auto GetPipe() const
 	{
 		return pipe;
 	}
 
 	const std::chrono::milliseconds Now();
+	static std::chrono::microseconds NowMicros();
+private:
+	void LinkTimer(TimerImpl* timer);
+	void UnlinkTimer(TimerImpl* timer);
+	void AdvanceTimers(const std::chrono::microseconds& now, std::vector<TimerImpl::shared>& triggered);
+	std::optional<uint64_t> GetNextTimerTick() const;
+private:
+	bool RunUring(const std::chrono::milliseconds &duration);
 private:
 	struct SendBuffer
 	{
@@ -163,14 +203,31 @@ private:
 		std::optional<std::function<void(std::chrono::milliseconds)>> callback;
 		
 	};
+	struct QueuedTask
+	{
+		Task task;
+		//Only for Async
+		std::optional<std::promise<void>> promise;
+		//When it was queued, for latency tracing
+		std::chrono::microseconds queued = 0us;
+	};
 	static const size_t MaxSendingQueueSize;
 	static const size_t MaxMultipleSendingMessages;
 	static const size_t MaxMultipleReceivingMessages;
 	static const size_t PacketPoolSize;
+	static const size_t UringBufferCount;
+	static const size_t WheelLevels = 4;
+	static const size_t WheelSlots = 256;
+	static const std::chrono::microseconds WheelResolution;
+	static const size_t MaxGSOSegments;
+	static const size_t MaxGSOSize;
+	static const size_t MaxMultipleGROMessages;
+	static const size_t MaxGROSize;
 private:
 	std::thread	thread;
 	State		state		= State::Normal;
 	Listener*	listener	= nullptr;
+	Backend		backend		= Backend::Poll;
 	int		fd		= 0;
 	int		pipe[2]		= {FD_INVALID, FD_INVALID};
 	pollfd		ufds[2]		= {};
@@ -178,10 +235,14 @@ private:
 	volatile bool	running		= false;
 	std::chrono::milliseconds now	= 0ms;
 	moodycamel::ConcurrentQueue<SendBuffer>	sending;
-	moodycamel::ConcurrentQueue<std::pair<std::promise<void>,std::function<void(std::chrono::milliseconds)>>>  tasks;
-	std::multimap<std::chrono::milliseconds,TimerImpl::shared> timers;
-	ObjectPool<Packet> packetPool;
+	moodycamel::ConcurrentQueue<QueuedTask>	tasks;
+	//Hierarchical timing wheel, each level has 256 times the resolution of the previous one
+	TimerImpl*	wheel[WheelLevels][WheelSlots]	= {};
+	size_t		wheelCount[WheelLevels]		= {};
+	uint64_t	wheelTick			= 0;
+	PacketPool packetPool;
 	std::optional<RawTx> rawTx;
+	Stats stats;
 
 };
 
@@ -0,0 +1,117 @@
+#ifndef IOURING_H
+#define IOURING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+//Multishot recvmsg and provided buffer rings are required
+#if defined(IORING_RECV_MULTISHOT) && defined(IORING_ENTER_EXT_ARG)
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+#ifdef HAVE_IO_URING
+
+/**
+ * Minimal io_uring wrapper using the raw syscalls, so no liburing is needed.
+ *
+ * Only meant to be used from a single thread, the one running the event loop.
+ */
+class IoUring
+{
+public:
+	IoUring() = default;
+	~IoUring();
+	IoUring(const IoUring&) = delete;
+	IoUring& operator=(const IoUring&) = delete;
+
+	/**
+	 * Create the ring and map the submission and completion queues
+	 * @param entries	Submission queue size
+	 * @param cqEntries	Completion queue size, must be bigger to hold multishot completions
+	 */
+	bool Init(uint32_t entries, uint32_t cqEntries);
+
+	/**
+	 * Register a ring of provided buffers for receiving
+	 * @param group		Buffer group id to be used on the sqes
+	 * @param count		Number of buffers, must be power of 2
+	 * @param size		Size of each buffer
+	 */
+	bool RegisterBufferRing(uint16_t group, uint16_t count, uint32_t size);
+
+	//Get a free sqe, cleared, or null if the submission queue is full
+	io_uring_sqe* GetSQE();
+
+	/**
+	 * Submit pending sqes and wait for completions
+	 * @param wait		Number of completions to wait for
+	 * @param timeout	Max wait time in microseconds, negative to wait forever
+	 * @return number of sqes submitted or negative errno
+	 */
+	int SubmitAndWait(uint32_t wait = 0, int64_t timeout = -1);
+
+	//Run callback for each completion available and consume them
+	template <typename Callback>
+	uint32_t ForEachCQE(Callback&& callback)
+	{
+		uint32_t head = *cqHead;
+		uint32_t tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+		uint32_t count = 0;
+
+		//Process all completions
+		for (; head!=tail; ++head, ++count)
+			callback(cqes[head & *cqMask]);
+
+		//Release them to the kernel
+		__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+
+		return count;
+	}
+
+	uint8_t* GetBuffer(uint16_t id)	const { return buffers + (size_t)id * bufferSize;	}
+	uint32_t GetBufferSize()	const { return bufferSize;				}
+
+	//Give buffer back to the kernel, visible after CommitBuffers
+	void RecycleBuffer(uint16_t id);
+	void CommitBuffers();
+
+	bool IsValid() const { return fd!=-1; }
+private:
+	int	fd		= -1;
+
+	//Submission queue
+	void*		sqRing		= nullptr;
+	size_t		sqRingSize	= 0;
+	uint32_t*	sqHead		= nullptr;
+	uint32_t*	sqTail		= nullptr;
+	uint32_t*	sqMask		= nullptr;
+	uint32_t*	sqArray		= nullptr;
+	uint32_t	sqEntries	= 0;
+	io_uring_sqe*	sqes		= nullptr;
+	size_t		sqesSize	= 0;
+	uint32_t	pending		= 0;
+
+	//Completion queue
+	void*		cqRing		= nullptr;
+	size_t		cqRingSize	= 0;
+	uint32_t*	cqHead		= nullptr;
+	uint32_t*	cqTail		= nullptr;
+	uint32_t*	cqMask		= nullptr;
+	io_uring_cqe*	cqes		= nullptr;
+
+	//Provided buffers
+	io_uring_buf_ring* bufferRing	= nullptr;
+	size_t		bufferRingSize	= 0;
+	uint8_t*	buffers		= nullptr;
+	size_t		buffersSize	= 0;
+	uint32_t	bufferSize	= 0;
+	uint16_t	bufferCount	= 0;
+	uint16_t	bufferTail	= 0;
+};
+
+#endif
+
+#endif /* IOURING_H */
@@ -0,0 +1,75 @@
+#ifndef PACER_H
+#define PACER_H
+
+#include <deque>
+#include "config.h"
+#include "rtp/RTPPacket.h"
+
+/**
+ * Token bucket pacer with a queue per priority class.
+ *
+ * Packets are released in priority order while there is budget left, which is
+ * refilled at a multiple of the target bitrate. Audio is never held back and
+ * the rate is increased when needed so no packet waits more than MaxQueueTime.
+ * All times are in microseconds.
+ */
+class Pacer
+{
+public:
+	enum Class
+	{
+		Audio,
+		Retransmission,
+		Video,
+		NumClasses
+	};
+
+	static const double PacingFactor;
+	static const QWORD MaxQueueTime;
+	static const QWORD MaxBurstTime;
+	static const DWORD PacketOverhead;
+public:
+	//Set target bitrate in bps, packets are not paced if 0
+	void SetBitrate(DWORD bitrate)	{ this->bitrate = bitrate;	}
+	DWORD GetBitrate() const	{ return bitrate;		}
+	bool IsEnabled() const		{ return bitrate;		}
+
+	void Enqueue(Class type, const RTPPacket::shared& packet, QWORD now);
+	//Get next packet that can be sent now, if any
+	RTPPacket::shared Dequeue(QWORD now, Class& type);
+	//Consume budget for a sent packet, including the ones not paced
+	void OnSent(QWORD now, DWORD size);
+	//Time to wait until next packet can be released, (QWORD)-1 if empty
+	QWORD GetWaitTime(QWORD now);
+	void Clear();
+
+	bool  IsEmpty()			const { return !queuedPackets;			}
+	DWORD GetQueuedPackets()	const { return queuedPackets;			}
+	QWORD GetQueuedBytes()		const { return queuedBytes;			}
+	DWORD GetQueuedPackets(Class type) const { return queues[type].size();	}
+	//Time the oldest packet has been waiting
+	QWORD GetQueueTime(QWORD now) const;
+private:
+	struct Item
+	{
+		RTPPacket::shared packet;
+		QWORD time;
+		DWORD size;
+	};
+
+	void Update(QWORD now);
+	//Rate in bps needed to drain the queue in time
+	QWORD GetRate(QWORD now) const;
+private:
+	std::deque<Item> queues[NumClasses];
+	DWORD queuedPackets	= 0;
+	QWORD queuedBytes	= 0;
+	DWORD bitrate		= 0;
+	//Bytes that can be sent now, negative when in debt
+	int64_t budget		= 0;
+	//Fraction of byte of budget, in bits per million
+	QWORD remainder		= 0;
+	QWORD last		= 0;
+};
+
+#endif /* PACER_H */
@@ -0,0 +1,88 @@
+#ifndef PACKETPOOL_H
+#define PACKETPOOL_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "config.h"
+#include "concurrentqueue.h"
+#include "Packet.h"
+
+/**
+ * Slab allocator for packets, split in size classes.
+ *
+ * The owner thread (the event loop one) keeps a magazine of free packets per
+ * class that is used without any synchronization, and refills it from or
+ * flushes it to a lock-free depot shared with the rest of threads. So packets
+ * can be picked on any thread and released on another one.
+ */
+class PacketPool
+{
+public:
+	enum SizeClass
+	{
+		RTCP,
+		RTP,
+		Jumbo,
+		NumSizeClasses
+	};
+
+	struct Stats
+	{
+		uint64_t hits		= 0;
+		uint64_t misses		= 0;
+		uint64_t released	= 0;
+		//Released packets freed because the pool was full
+		uint64_t dropped	= 0;
+		//Packets picked and not yet released, approximate as packets can be released to a different pool
+		int64_t  inUse		= 0;
+		int64_t  highWater	= 0;
+	};
+
+	static const size_t RTCPPacketSize;
+	static const size_t JumboPacketSize;
+public:
+	/**
+	 * Create pool
+	 * @param size	Number of packets of each class kept on the pool, RTP class is preallocated
+	 */
+	PacketPool(size_t size);
+	PacketPool(const PacketPool&) = delete;
+	PacketPool& operator=(const PacketPool&) = delete;
+
+	//Get a packet with at least the requested capacity
+	Packet pick(size_t size = MTU);
+	void release(Packet&& packet);
+
+	//Set thread using the magazines, packets are kept on the depot until it is set
+	void SetOwner(std::thread::id owner)		{ this->owner = owner;	}
+
+	Stats GetStats(SizeClass sizeClass) const;
+	Stats GetStats() const;
+
+	static size_t GetCapacity(SizeClass sizeClass);
+	static SizeClass GetSizeClass(size_t size);
+private:
+	struct Slab
+	{
+		std::vector<Packet> magazine;
+		moodycamel::ConcurrentQueue<Packet> depot;
+		std::atomic<uint64_t> hits	= 0;
+		std::atomic<uint64_t> misses	= 0;
+		std::atomic<uint64_t> released	= 0;
+		std::atomic<uint64_t> dropped	= 0;
+		std::atomic<int64_t>  inUse	= 0;
+		std::atomic<int64_t>  highWater	= 0;
+	};
+
+	bool IsOwner() const { return std::this_thread::get_id()==owner.load(std::memory_order_relaxed); }
+	size_t GetLimit(SizeClass sizeClass) const;
+private:
+	static const size_t MagazineSize;
+
+	size_t size;
+	std::atomic<std::thread::id> owner;
+	Slab slabs[NumSizeClasses];
+};
+
+#endif /* PACKETPOOL_H */
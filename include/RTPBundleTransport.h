@@ -8,12 +8,17 @@
 #include <map>
 #include <string>
 #include <memory>
+#include <vector>
+#include <mutex>
+#include <atomic>
 #include <poll.h>
 #include <srtp2/srtp.h>
 #include "config.h"
 #include "DTLSICETransport.h"
 #include "EventLoop.h"
 #include "PacketHeader.h"
+#include "ReusePortSteering.h"
+#include "RemoteAddressMap.h"
 
 class RTPBundleTransport :
 	public DTLSICETransport::Sender,
@@ -44,7 +49,13 @@ public:
 		
 	};
 public:
-	RTPBundleTransport();
+	/**
+	 * Create bundle transport
+	 * @param shards	Number of sockets and event loops sharing the same port via SO_REUSEPORT.
+	 *			Each ICE transport is pinned to one shard, which receives, decrypts and sends all its traffic.
+	 *			When using more than one shard, use the ICE transport time service instead of GetTimeService().
+	 */
+	RTPBundleTransport(uint32_t shards = 1);
 	virtual ~RTPBundleTransport();
 	int Init();
 	int Init(int port);
@@ -64,14 +75,28 @@ public:
 	void SetRawTx(int32_t ifindex, unsigned int sndbuf, bool skipQdisc, const std::string& selfLladdr, uint32_t fallbackSelfAddr, const std::string& fallbackDstLladdr, uint16_t port);
 	void ClearRawTx();
 
-	void SetIceTimeout(uint32_t timeout)	{ iceTimeout = std::chrono::milliseconds(timeout);	}
-	bool SetAffinity(int cpu)		{ return loop.SetAffinity(cpu);				}
-	bool SetThreadName(const std::string& name) { return loop.SetThreadName(name);			}
-	bool SetPriority(int priority)		{ return loop.SetPriority(priority);			}
+	void SetIceTimeout(uint32_t timeout);
+	//When sharded, each shard is pinned to consecutive cpus starting at the one provided
+	bool SetAffinity(int cpu);
+	bool SetThreadName(const std::string& name);
+	bool SetPriority(int priority);
 	TimeService& GetTimeService()		{ return loop;						}
+	uint32_t GetShards() const		{ return shards.size() + 1;				}
 private:
+	RTPBundleTransport(RTPBundleTransport* main, uint32_t index);
 	void onTimer(std::chrono::milliseconds now);
 	void SendBindingRequest(Connection::shared connection,ICERemoteCandidate* candidate);
+	
+	//Shard routing, only on the main transport
+	bool StartShards();
+	RTPBundleTransport* GetLeastLoadedShard();
+	RTPBundleTransport* FindShard(const std::string& username);
+	RTPBundleTransport* FindShard(uint32_t ip, uint16_t port);
+	void AddRoute(const std::string& username, RTPBundleTransport* shard);
+	void RemoveRoute(const std::string& username);
+	void AddRoute(uint32_t ip, uint16_t port, RTPBundleTransport* shard);
+	void RemoveRoute(uint32_t ip, uint16_t port);
+	bool Forward(RTPBundleTransport* from, RTPBundleTransport* shard, const uint8_t* data, const size_t size, const uint32_t ip, const uint16_t port);
 private:
 	//Sockets
 	int 	socket;
@@ -83,9 +108,20 @@ private:
 
 	std::map<std::string, Connection::shared>	connections;
 	std::map<std::string, ICERemoteCandidate>	candidates;
+	RemoteAddressMap<ICERemoteCandidate>		remotes;
 	std::map<std::pair<uint64_t,uint32_t>, std::pair<std::string,std::string>> transactions;
 	uint32_t maxTransId = 0;
 	Use	use;
+	
+	//Multi-threaded mode, main transport is null when not sharded
+	RTPBundleTransport* main = nullptr;
+	uint32_t index = 0;
+	std::atomic<uint32_t> load = 0;
+	std::vector<std::unique_ptr<RTPBundleTransport>> shards;
+	std::mutex routesMutex;
+	std::map<std::string,RTPBundleTransport*> usernameRoutes;
+	std::map<uint64_t,RTPBundleTransport*> remoteRoutes;
+	ReusePortSteering steering;
 };
 
 #endif
@@ -0,0 +1,191 @@
+#ifndef REMOTEADDRESSMAP_H
+#define REMOTEADDRESSMAP_H
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+/**
+ * Open addressing hash map from a remote ip:port to a non owned pointer.
+ *
+ * The ip and port are packed on a 48 bit key, so lookups don't allocate nor
+ * compare strings. The last found entry is cached, as packets received on the
+ * same recvmmsg batch usually come from the same sender.
+ */
+template <typename T>
+class RemoteAddressMap
+{
+public:
+	RemoteAddressMap(uint32_t capacity = 64)
+	{
+		//Get power of 2 size
+		while ((1u<<bits)<capacity)
+			bits++;
+		//Allocate entries
+		entries.resize(1u<<bits);
+	}
+
+	T* Find(uint32_t ip, uint16_t port)
+	{
+		//Get key
+		uint64_t key = GetKey(ip,port);
+
+		//Check last hit first
+		if (key==lastKey)
+			return lastValue;
+
+		//Probe until empty slot
+		for (uint32_t i = GetHome(key); entries[i].key!=Empty; i = Next(i))
+		{
+			//If found
+			if (entries[i].key==key)
+			{
+				//Cache it
+				lastKey = key;
+				lastValue = entries[i].value;
+				//Done
+				return lastValue;
+			}
+		}
+
+		//Not found
+		return nullptr;
+	}
+
+	void Set(uint32_t ip, uint16_t port, T* value)
+	{
+		//Get key
+		uint64_t key = GetKey(ip,port);
+
+		//Grow if we are over 3/4 of the capacity
+		if ((size+1)*4>entries.size()*3)
+			Grow();
+
+		//Invalidate cache
+		lastKey = Empty;
+
+		//Probe until empty slot
+		uint32_t i = GetHome(key);
+		for (; entries[i].key!=Empty; i = Next(i))
+		{
+			//If already present
+			if (entries[i].key==key)
+			{
+				//Update value
+				entries[i].value = value;
+				//Done
+				return;
+			}
+		}
+
+		//Store new one
+		entries[i] = { key, value };
+		size++;
+	}
+
+	bool Remove(uint32_t ip, uint16_t port)
+	{
+		//Get key
+		uint64_t key = GetKey(ip,port);
+
+		//Invalidate cache
+		lastKey = Empty;
+
+		//Find it
+		uint32_t i = GetHome(key);
+		for (; entries[i].key!=key; i = Next(i))
+			//If not found
+			if (entries[i].key==Empty)
+				return false;
+
+		//Shift back following entries of the cluster so probing doesn't need tombstones
+		for (uint32_t j = Next(i); entries[j].key!=Empty; j = Next(j))
+		{
+			//Get home slot of the entry
+			uint32_t home = GetHome(entries[j].key);
+			//If the hole is between its home and its current position
+			if (i<=j ? (home<=i || home>j) : (home<=i && home>j))
+			{
+				//Move it to the hole
+				entries[i] = entries[j];
+				//The hole is now here
+				i = j;
+			}
+		}
+
+		//Clear hole
+		entries[i] = {};
+		size--;
+
+		//Removed
+		return true;
+	}
+
+	void Clear()
+	{
+		//Clear all entries
+		std::fill(entries.begin(),entries.end(),Entry{});
+		size = 0;
+		lastKey = Empty;
+	}
+
+	uint32_t GetSize() const	{ return size;	}
+	bool IsEmpty() const		{ return !size;	}
+
+private:
+	static constexpr uint64_t Empty = UINT64_MAX;
+
+	struct Entry
+	{
+		uint64_t key = Empty;
+		T* value = nullptr;
+	};
+
+	static uint64_t GetKey(uint32_t ip, uint16_t port)
+	{
+		return ((uint64_t)ip)<<16 | port;
+	}
+
+	uint32_t GetHome(uint64_t key) const
+	{
+		//Fibonacci hashing
+		return (key * 0x9E3779B97F4A7C15ull) >> (64 - bits);
+	}
+
+	uint32_t Next(uint32_t i) const
+	{
+		return (i + 1) & (entries.size() - 1);
+	}
+
+	void Grow()
+	{
+		//Double size
+		std::vector<Entry> old(1u<<++bits);
+		old.swap(entries);
+		size = 0;
+
+		//Rehash all
+		for (const auto& entry : old)
+		{
+			//Skip empty
+			if (entry.key==Empty)
+				continue;
+			//Probe until empty slot
+			uint32_t i = GetHome(entry.key);
+			while (entries[i].key!=Empty)
+				i = Next(i);
+			//Store it
+			entries[i] = entry;
+			size++;
+		}
+	}
+
+private:
+	std::vector<Entry> entries;
+	uint32_t size = 0;
+	uint8_t bits = 1;
+	uint64_t lastKey = Empty;
+	T* lastValue = nullptr;
+};
+
+#endif /* REMOTEADDRESSMAP_H */
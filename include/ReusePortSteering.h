@@ -0,0 +1,47 @@
+#ifndef REUSEPORTSTEERING_H
+#define REUSEPORTSTEERING_H
+
+#include <stdint.h>
+#include "config.h"
+#include "FileDescriptor.h"
+
+/**
+ * Steers datagrams received on a SO_REUSEPORT socket group to a fixed socket
+ * index based on the remote ip:port of the datagram.
+ *
+ * An eBPF program is attached to the reuseport group which looks up the source
+ * address of each datagram in a hash map. If found, the stored socket index is
+ * used, otherwise the kernel falls back to its default 4-tuple hashing.
+ */
+class ReusePortSteering
+{
+public:
+	ReusePortSteering() = default;
+	ReusePortSteering(const ReusePortSteering&) = delete;
+	ReusePortSteering& operator=(const ReusePortSteering&) = delete;
+
+	/**
+	 * Load steering program and attach it to the reuseport group of the socket
+	 * @param fd		Any socket of the reuseport group, must be already bound
+	 * @param maxEntries	Max number of remote addresses that can be steered
+	 * @return true if the steering is in place
+	 */
+	bool Attach(int fd, uint32_t maxEntries = 64*1024);
+
+	/**
+	 * Steer datagrams from the remote address to the socket at the given index
+	 * @param ip	Remote ip address in host order
+	 * @param port	Remote port in host order
+	 * @param index	Index of the socket inside the reuseport group, in order of binding
+	 */
+	bool Set(uint32_t ip, uint16_t port, uint32_t index);
+	bool Remove(uint32_t ip, uint16_t port);
+
+	bool IsAttached() const { return attached; }
+private:
+	FileDescriptor map;
+	FileDescriptor prog;
+	bool attached = false;
+};
+
+#endif /* REUSEPORTSTEERING_H */
@@ -1,6 +1,7 @@
 #ifndef SRTPSESSION_H
 #define SRTPSESSION_H
 #include <srtp2/srtp.h>
+#include <sys/uio.h>
 #include <vector>
 #include "config.h"
 
@@ -49,6 +50,17 @@ public:
 	size_t UnprotectRTP(uint8_t* data, size_t size);
 	size_t UnprotectRTCP(uint8_t* data, size_t size);
 	
+	/**
+	 * Process a batch of packets in place, as the ones read at once by the event loop
+	 * @param packets	Packet buffers, iov_len is updated with the new size or set to 0 on error
+	 * @param count		Number of packets
+	 * @return number of packets processed correctly, last error is kept on failure
+	 */
+	size_t ProtectRTP(iovec* packets, size_t count);
+	size_t ProtectRTCP(iovec* packets, size_t count);
+	size_t UnprotectRTP(iovec* packets, size_t count);
+	size_t UnprotectRTCP(iovec* packets, size_t count);
+	
 	bool IsSetup() const { return srtp; }
 	const char* GetLastError() const
 	{
@@ -83,6 +95,9 @@ public:
 		return "Uknown";
 	}
 	Status GetLastStatus() const { return err; }
+private:
+	template <typename Function>
+	size_t Process(Function&& function, iovec* packets, size_t count);
 private:
 	srtp_t srtp = nullptr;
 	Status err = Status::OK;
@@ -0,0 +1,45 @@
+#ifndef SCALEDFRAMECACHE_H
+#define SCALEDFRAMECACHE_H
+
+#include <memory>
+#include <vector>
+#include "config.h"
+#include "framescaler.h"
+
+/**
+ * Resized copies of the frames of a video source.
+ *
+ * Each distinct size and aspect ratio mode is resized only once per source
+ * frame, so mosaics and slots showing the same source at the same size reuse
+ * it. Sizes not requested for a whole source frame are released.
+ */
+class ScaledFrameCache
+{
+public:
+	//Get frame resized to the requested size, nullptr on error
+	BYTE* Get(QWORD frameNum, BYTE* frame, DWORD width, DWORD height, DWORD dstWidth, DWORD dstHeight, bool keepAspectRatio);
+	void Clear();
+
+	DWORD GetLength()	const { return entries.size();	}
+	QWORD GetHits()		const { return hits;		}
+	QWORD GetMisses()	const { return misses;		}
+private:
+	struct Entry
+	{
+		DWORD width;
+		DWORD height;
+		bool keepAspectRatio;
+		//Source frame currently resized on buffer
+		QWORD frameNum;
+		FrameScaler scaler;
+		std::vector<BYTE> buffer;
+	};
+private:
+	std::vector<std::unique_ptr<Entry>> entries;
+	QWORD current	= 0;
+	QWORD previous	= 0;
+	QWORD hits	= 0;
+	QWORD misses	= 0;
+};
+
+#endif /* SCALEDFRAMECACHE_H */
@@ -0,0 +1,137 @@
+#ifndef SMALLFUNCTION_H
+#define SMALLFUNCTION_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <typename Signature, size_t Capacity = 64>
+class SmallFunction;
+
+/**
+ * Move only callable wrapper with inline storage.
+ *
+ * Callables up to Capacity bytes that can be moved without throwing are
+ * stored inside the object, so wrapping a lambda with small captures does not
+ * allocate. Bigger ones are moved to the heap like std::function does.
+ */
+template <typename R, typename... Args, size_t Capacity>
+class SmallFunction<R(Args...), Capacity>
+{
+public:
+	SmallFunction() = default;
+	SmallFunction(std::nullptr_t) {}
+
+	template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, SmallFunction>>>
+	SmallFunction(F&& func)
+	{
+		using T = std::decay_t<F>;
+		//If it fits
+		if constexpr (IsInline<T>())
+		{
+			//Construct in place
+			::new (static_cast<void*>(&storage)) T(std::forward<F>(func));
+			ops = &InlineOps<T>::ops;
+		} else {
+			//Store pointer to heap copy
+			::new (static_cast<void*>(&storage)) T*(new T(std::forward<F>(func)));
+			ops = &HeapOps<T>::ops;
+		}
+	}
+
+	SmallFunction(SmallFunction&& other) noexcept
+	{
+		//Steal other one
+		if (other.ops)
+			other.ops->move(&other.storage, &storage);
+		ops = other.ops;
+		other.ops = nullptr;
+	}
+
+	SmallFunction& operator=(SmallFunction&& other) noexcept
+	{
+		if (this!=&other)
+		{
+			//Release ours
+			reset();
+			//Steal other one
+			if (other.ops)
+				other.ops->move(&other.storage, &storage);
+			ops = other.ops;
+			other.ops = nullptr;
+		}
+		return *this;
+	}
+
+	SmallFunction(const SmallFunction&) = delete;
+	SmallFunction& operator=(const SmallFunction&) = delete;
+
+	~SmallFunction()
+	{
+		reset();
+	}
+
+	R operator()(Args... args)
+	{
+		return ops->invoke(&storage, std::forward<Args>(args)...);
+	}
+
+	explicit operator bool() const	{ return ops;			}
+	//True if callable is stored on the heap
+	bool IsHeap() const		{ return ops && ops->heap;	}
+
+	void reset()
+	{
+		//Destroy callable
+		if (ops)
+			ops->destroy(&storage);
+		ops = nullptr;
+	}
+
+private:
+	using Storage = std::aligned_storage_t<Capacity, alignof(std::max_align_t)>;
+
+	struct Ops
+	{
+		R    (*invoke)(void*, Args&&...);
+		//Move construct on destination and destroy source
+		void (*move)(void*, void*);
+		void (*destroy)(void*);
+		bool heap;
+	};
+
+	template <typename T>
+	static constexpr bool IsInline()
+	{
+		return sizeof(T)<=Capacity && alignof(T)<=alignof(Storage) && std::is_nothrow_move_constructible_v<T>;
+	}
+
+	template <typename T>
+	struct InlineOps
+	{
+		static R invoke(void* data, Args&&... args)	{ return (*static_cast<T*>(data))(std::forward<Args>(args)...);	}
+		static void move(void* from, void* to)
+		{
+			::new (to) T(std::move(*static_cast<T*>(from)));
+			static_cast<T*>(from)->~T();
+		}
+		static void destroy(void* data)			{ static_cast<T*>(data)->~T();		}
+		static constexpr Ops ops = { invoke, move, destroy, false };
+	};
+
+	template <typename T>
+	struct HeapOps
+	{
+		static R invoke(void* data, Args&&... args)	{ return (**static_cast<T**>(data))(std::forward<Args>(args)...);	}
+		static void move(void* from, void* to)		{ ::new (to) T*(*static_cast<T**>(from));	}
+		static void destroy(void* data)			{ delete *static_cast<T**>(data);		}
+		static constexpr Ops ops = { invoke, move, destroy, true };
+	};
+
+private:
+	Storage storage;
+	const Ops* ops = nullptr;
+};
+
+#endif /* SMALLFUNCTION_H */
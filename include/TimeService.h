@@ -7,6 +7,8 @@
 #include <functional>
 #include <future>
 
+#include "SmallFunction.h"
+
 class Timer
 {
 public:
@@ -15,6 +17,8 @@ public:
 	virtual ~Timer() = default;
 	virtual void Cancel() = 0;
 	virtual void Again(const std::chrono::milliseconds& ms) = 0;
+	//Sub millisecond scheduling, for pacing
+	virtual void Again(const std::chrono::microseconds& us) = 0;
 	virtual bool IsScheduled() const = 0;
 	virtual void Repeat(const std::chrono::milliseconds& repeat) = 0;
 	virtual void Reschedule(const std::chrono::milliseconds& ms, const std::chrono::milliseconds& repeat) = 0;
@@ -28,6 +32,9 @@ private:
 	
 class TimeService
 {
+public:
+	//Callables with small captures are stored without allocating
+	using Task = SmallFunction<void(std::chrono::milliseconds)>;
 public:
 	virtual ~TimeService() = default;
 	virtual const std::chrono::milliseconds GetNow() const = 0;
@@ -35,6 +42,8 @@ public:
 	virtual Timer::shared CreateTimer(const std::chrono::milliseconds& ms, std::function<void(std::chrono::milliseconds)> timeout) = 0;
 	virtual Timer::shared CreateTimer(const std::chrono::milliseconds& ms, const std::chrono::milliseconds& repeat, std::function<void(std::chrono::milliseconds)> timeout) = 0;
 	virtual std::future<void> Async(std::function<void(std::chrono::milliseconds)> func) = 0;
+	//Run on the loop without being notified when done, cheaper than Async when the future is not needed
+	virtual void Post(Task&& task) = 0;
 	inline void Sync(std::function<void(std::chrono::milliseconds)> func) 
 	{
 		//Run async and wait for future
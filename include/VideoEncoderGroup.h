@@ -0,0 +1,91 @@
+#ifndef VIDEOENCODERGROUP_H
+#define VIDEOENCODERGROUP_H
+
+#include <map>
+#include <memory>
+#include <set>
+#include <tuple>
+#include <vector>
+#include "config.h"
+#include "use.h"
+#include "codecs.h"
+#include "video.h"
+#include "pipevideoinput.h"
+#include "VideoEncoderWorker.h"
+
+class VideoMixer;
+
+/**
+ * Shared encoders for the participants viewing the same mosaic.
+ *
+ * Listeners requesting the same codec, size, fps and bitrate tier are served
+ * by a single encoder, so the mosaic is encoded once per tier instead of once
+ * per viewer. Requested bitrates are rounded down to the configured tiers.
+ * Encoders are started with the first listener of a tier and stopped when the
+ * last one leaves. Intra requests from the listeners of a tier are coalesced
+ * by the encoder worker. The group owns the inputs fed by the mixer, so it must
+ * be ended before the mixer is destroyed. If the mosaic is deleted the mixer
+ * stops feeding them and the encoders are idle until the group is ended.
+ *
+ * Not used by MultiConf yet, participants are still encoded by their own
+ * VideoStream. Using it requires a VideoStream mode that packetizes the
+ * frames of a group listener instead of grabbing and encoding its input,
+ * with rate control mapped to tier changes and intra requests forwarded
+ * to SendFPU, enabled by a participant property.
+ */
+class VideoEncoderGroup
+{
+public:
+	struct Tier
+	{
+		VideoCodec::Type codec;
+		int width;
+		int height;
+		int fps;
+		int bitrate;
+
+		bool operator<(const Tier& other) const
+		{
+			return std::tie(codec,width,height,fps,bitrate) < std::tie(other.codec,other.width,other.height,other.fps,other.bitrate);
+		}
+	};
+public:
+	VideoEncoderGroup(VideoMixer& mixer, int mosaicId, const std::vector<int>& bitrates, int intraPeriod, const Properties& properties);
+	~VideoEncoderGroup();
+
+	bool AddListener(const MediaFrame::Listener::shared& listener, VideoCodec::Type codec, int width, int height, int fps, int bitrate);
+	bool RemoveListener(const MediaFrame::Listener::shared& listener);
+	//Request an intra frame on the encoder of the listener
+	void SendFPU(const MediaFrame::Listener::shared& listener);
+	void End();
+
+	//Bitrate tier used for a requested bitrate
+	int GetTierBitrate(int bitrate) const;
+	bool GetTier(const MediaFrame::Listener::shared& listener, Tier& tier);
+	DWORD GetNumEncoders();
+	DWORD GetNumListeners();
+private:
+	struct Encoder
+	{
+		PipeVideoInput input;
+		VideoEncoderWorker worker;
+		std::set<MediaFrame::Listener::shared> listeners;
+	};
+	typedef std::map<Tier,std::unique_ptr<Encoder>> Encoders;
+	typedef std::map<MediaFrame::Listener::shared,Tier> Tiers;
+private:
+	//Stop feeding and encoding the mosaic
+	void Release(Encoder& encoder);
+private:
+	VideoMixer& mixer;
+	int mosaicId;
+	std::vector<int> bitrates;
+	int intraPeriod;
+	Properties properties;
+
+	Mutex mutex;
+	Encoders encoders;
+	Tiers tiers;
+};
+
+#endif /* VIDEOENCODERGROUP_H */
@@ -10,12 +10,23 @@
 
 #include <pthread.h>
 #include <set>
+#include <vector>
 #include "config.h"
 #include "codecs.h"
 #include "video.h"
 
 class VideoEncoderWorker
 {
+public:
+	//Encoded size and bitrate of each output, frames are sent to the listeners with the rendition id as ssrc
+	struct Rendition
+	{
+		DWORD id;
+		int width;
+		int height;
+		int bitrate;
+	};
+	typedef std::vector<Rendition> Renditions;
 public:
 	VideoEncoderWorker();
 	virtual ~VideoEncoderWorker();
@@ -23,6 +34,8 @@ public:
 	int Init(VideoInput *input);
 	int SetCodec(VideoCodec::Type codec,int mode,int fps,int bitrate,int intraPeriod,const Properties & properties);
 	int SetVideoCodec(VideoCodec::Type codec,int width, int height, int fps,int bitrate,int intraPeriod,const Properties & properties);
+	//Grab once at the biggest size and scale and encode each rendition in parallel
+	int SetVideoCodec(VideoCodec::Type codec,const Renditions& renditions, int fps,int intraPeriod,const Properties & properties);
 	int End();
 
 	int  SetTemporalBitrateLimit(int bitrate);
@@ -46,6 +59,7 @@ private:
 	
 private:
 	Listeners		listeners;
+	Renditions		renditions;
 	
 	VideoInput *input	= nullptr;
 	VideoCodec::Type codec  = VideoCodec::UNKNOWN;
@@ -0,0 +1,43 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "config.h"
+
+/**
+ * Fixed set of threads for running independent tasks in parallel.
+ *
+ * Run() hands a batch of tasks to the workers, runs some of them on the
+ * calling thread too, and returns when all of them have finished. Only one
+ * batch is run at a time.
+ */
+class WorkerPool
+{
+public:
+	using Task = std::function<void()>;
+public:
+	WorkerPool(DWORD numWorkers);
+	~WorkerPool();
+
+	void Run(std::vector<Task>& tasks);
+	DWORD GetNumWorkers() const { return workers.size();	}
+private:
+	void Loop();
+	//Run next pending task of current batch, lock must be held
+	bool RunNext(std::unique_lock<std::mutex>& lock);
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable pending;
+	std::condition_variable finished;
+	std::vector<Task>* tasks = nullptr;
+	size_t next = 0;
+	size_t remaining = 0;
+	bool stopping = false;
+};
+
+#endif /* WORKERPOOL_H */
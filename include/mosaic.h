@@ -6,6 +6,7 @@
 #include "vad.h"
 #include "logo.h"
 #include "use.h"
+#include <atomic>
 #include <map>
 #include <set>
 
@@ -72,6 +73,17 @@ public:
 			}
 		};
 	};
+	
+	struct Stats
+	{
+		QWORD composed		= 0;
+		//Compose times in us
+		QWORD composeTime	= 0;
+		QWORD maxComposeTime	= 0;
+		QWORD updatedSlots	= 0;
+		//Slots with a participant but no new frame since last compose
+		QWORD skippedSlots	= 0;
+	};
 public:
 	typedef std::map<int,PartInfo*> Participants;
 	typedef std::set<PartInfo*,PartInfo::Short> ParticipantsOrder;
@@ -95,6 +107,11 @@ public:
 	int GetPaddingBottom()	const { return paddingBottom;	}
 	
 	int HasChanged()	const { return mosaicChanged;	}
+	//If slots are not overlapped they can be updated in parallel
+	virtual bool HasOverlappingSlots() const { return false;	}
+	
+	const Stats& GetStats()	const { return stats;		}
+	void AddComposeStats(QWORD time,DWORD updated,DWORD skipped);
 
 	BYTE* GetFrame();
 	virtual int Update(int index,BYTE *frame,int width,int heigth, bool keepAspectRatio = true) = 0;
@@ -157,7 +174,8 @@ protected:
 	Mutex			mutex;
 	Participants		participants;
 	ParticipantsOrder	order;
-	int mosaicChanged;
+	//Set from slot updates running in parallel
+	std::atomic<int> mosaicChanged;
 	int numSlots;
 
 	// information on whether slot is locked, free, fixed (= id of participant), vad
@@ -181,7 +199,9 @@ protected:
 
 	Overlay  overlay;
 	bool	 overlayUsed;
-	bool	 overlayNeedsUpdate;
+	std::atomic<bool> overlayNeedsUpdate;
+	
+	Stats	stats;
 	
 	int	paddingLeft	= 0;
 	int	paddingRight	= 0;
@@ -9,6 +9,7 @@
 #define	OVERLAY_H
 #include "config.h"
 
+#include <vector>
 
 class Canvas
 {
@@ -20,15 +21,28 @@ public:
 	int RenderText(const std::wstring& text,DWORD x,DWORD y,DWORD width,DWORD height);
 	int RenderText(const std::wstring& text,DWORD x,DWORD y,DWORD width,DWORD height,const Properties& properties);
 	int RenderText(const std::string& utf8,DWORD x,DWORD y,DWORD width,DWORD height,const Properties& properties);
+	//Blend overlay on the frame, only the tiles with visible overlay pixels are processed
 	void Draw(BYTE*image, BYTE* frame);
 	void Reset();
-	BYTE* GetCanvas()	{ return overlay;	}
+	//Writable overlay, non transparent tiles are calculated again on next draw
+	BYTE* GetCanvas()	{ spansNeedUpdate = true; return overlay;	}
+protected:
+	//Run of consecutive tiles with non transparent pixels in a pair of luma lines
+	struct Span
+	{
+		DWORD line;	//Chroma line
+		DWORD start;	//First luma column
+		DWORD end;	//Last luma column, not included
+	};
+	void UpdateSpans();
 protected:
 	DWORD overlaySize;
 	BYTE* overlay;
 	DWORD width;
 	DWORD height;
 	bool display;	
+	std::vector<Span> spans;
+	bool spansNeedUpdate;
 };
 
 class Overlay : public Canvas
@@ -38,7 +52,7 @@ public:
 	~Overlay();
 
 	BYTE* Display(BYTE* frame);
-	BYTE* GetOverlay() { return GetCanvas(); }
+	BYTE* GetOverlay() { return overlay; }
 private:
 	DWORD imageSize;
 	BYTE* image;
@@ -18,6 +18,8 @@ public:
 
 	BYTE*	GetFrame();
 	int	IsChanged(DWORD version);
+	//Increased on each new frame or size change
+	QWORD	GetFrameNum()	{ return frameNum;		};
 	int 	GetWidth()	{ return videoWidth;		};
 	int 	GetHeight()	{ return videoHeight;		};
 	int	Init();
@@ -31,6 +33,7 @@ private:
 	bool	versionChanged;
 	int 	inited;
 	DWORD	version;
+	QWORD	frameNum = 0;
 
 	pthread_mutex_t* videoMixerMutex;
 	pthread_cond_t*  videoMixerCond;
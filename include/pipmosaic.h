@@ -14,6 +14,8 @@ public:
 	virtual int GetSlots();
 
 	virtual BYTE* GetFrame();
+	//Pip slots are drawn over the first one
+	virtual bool HasOverlappingSlots() const { return true; }
 
 	virtual int Update(int index,BYTE *frame,int width,int heigth, bool keepAspectRatio);
 	virtual int Clean(int index);
@@ -11,6 +11,7 @@
 #include "use.h"
 #include "remoteratecontrol.h"
 #include "rtp/RTPPacket.h"
+#include <list>
 
 class RemoteRateEstimator
 {
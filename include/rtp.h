@@ -15,6 +15,7 @@
 #include "rtp/RTPHeader.h"
 #include "rtp/RTPHeaderExtension.h"
 #include "rtp/RTPPacket.h"
+#include "rtp/RTPSendProfile.h"
 #include "rtp/RTPPacketSched.h"
 #include "rtp/RTPRedundantPacket.h"
 #include "rtp/RTPDepacketizer.h"
@@ -31,6 +32,7 @@
 #include "rtp/RTCPNACK.h"
 #include "rtp/RTCPReceiverReport.h"
 #include "rtp/RTCPSDES.h"
+#include "rtp/RTCPCompoundView.h"
 #include "rtp/RTPWaitedBuffer.h"
 #include "rtp/RTPLostPackets.h"
 #include "rtp/RTPSource.h"
@@ -48,6 +50,13 @@ public:
 public:
 	virtual int Enqueue(const RTPPacket::shared& packet) = 0;
 	virtual int Enqueue(const RTPPacket::shared& packet,std::function<RTPPacket::shared(const RTPPacket::shared&)> modifier) = 0;
+	//Enqueue all the packets of a frame at once, ownership is transferred so they are not cloned
+	virtual int Enqueue(std::vector<RTPPacket::shared>&& packets)
+	{
+		for (const auto& packet : packets)
+			Enqueue(packet);
+		return packets.size();
+	}
 };
 
 class RTPReceiver
@@ -2,6 +2,7 @@
 #define DEPENDENCYDESCRIPTOR_H
 
 #include "config.h"
+#include <memory>
 #include <optional>
 #include <utility>
 #include <vector>
@@ -50,6 +51,9 @@ struct FrameDependencyTemplate : public LayerInfo
 
 struct TemplateDependencyStructure
 {
+	//Structures are immutable once parsed, so packets share them instead of copying
+	using shared = std::shared_ptr<const TemplateDependencyStructure>;
+	
 	uint32_t templateIdOffset = 0;
 	uint32_t dtsCount	  = 0;
 	uint32_t chainsCount	  = 0;
@@ -118,6 +122,7 @@ struct DependencyDescriptor
 	void Dump() const;
 	
 	static std::optional<DependencyDescriptor> Parse(BitReader& reader, const std::optional<TemplateDependencyStructure>& templateDependencyStructure = std::nullopt);
+	static std::optional<DependencyDescriptor> Parse(BitReader& reader, const TemplateDependencyStructure* templateDependencyStructure);
 
 	friend bool operator==(const DependencyDescriptor& lhs, const DependencyDescriptor& rhs)
 	{
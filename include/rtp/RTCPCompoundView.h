@@ -0,0 +1,181 @@
+#ifndef RTCPCOMPOUNDVIEW_H
+#define RTCPCOMPOUNDVIEW_H
+
+#include "config.h"
+#include "tools.h"
+#include "rtp/RTCPPacket.h"
+#include "rtp/RTCPRTPFeedback.h"
+#include "rtp/RTCPPayloadFeedback.h"
+
+/**
+ * Non owning views over a serialized RTCP compound packet.
+ *
+ * Packets are iterated in place and typed views read the fields from the
+ * buffer on demand, so no object is allocated while processing it. Views are
+ * only valid while the buffer is. Sizes are checked by RTCPCompoundView::IsValid()
+ * and by the IsValid() method of each typed view, getters don't check them.
+ */
+class RTCPPacketView
+{
+public:
+	RTCPPacketView(const BYTE* data, DWORD size) : data(data), size(size) {}
+
+	RTCPPacket::Type GetType()	const { return (RTCPPacket::Type)data[1];	}
+	BYTE  GetCount()		const { return data[0] & 0x1F;			}
+	const BYTE* GetData()		const { return data;				}
+	DWORD GetSize()			const { return size;				}
+	void  Dump()			const;
+protected:
+	const BYTE* data;
+	DWORD size;
+};
+
+class RTCPReportView
+{
+public:
+	static const DWORD Size = 24;
+public:
+	RTCPReportView(const BYTE* data) : data(data) {}
+
+	DWORD GetSSRC()			const { return get4(data,0);			}
+	BYTE  GetFactionLost()		const { return get1(data,4);			}
+	DWORD GetLostCount()		const { return get3(data,5) & 0x7FFFFF;		}
+	DWORD GetLastSeqNum()		const { return get4(data,8);			}
+	DWORD GetJitter()		const { return get4(data,12);			}
+	DWORD GetLastSR()		const { return get4(data,16);			}
+	DWORD GetDelaySinceLastSR()	const { return get4(data,20);			}
+	DWORD GetDelaySinceLastSRMilis() const
+	{
+		//Get the delay, expressed in units of 1/65536 seconds
+		DWORD dslr = GetDelaySinceLastSR();
+		//Return in milis
+		return (dslr>>16)*1000 + ((double)(dslr & 0xFFFF))/65.635;
+	}
+private:
+	const BYTE* data;
+};
+
+class RTCPSenderReportView : public RTCPPacketView
+{
+public:
+	RTCPSenderReportView(const RTCPPacketView& packet) : RTCPPacketView(packet) {}
+
+	bool  IsValid()			const { return size>=28+GetCount()*RTCPReportView::Size;	}
+	DWORD GetSSRC()			const { return get4(data,4);			}
+	DWORD GetNTPSec()		const { return get4(data,8);			}
+	DWORD GetNTPFrac()		const { return get4(data,12);			}
+	QWORD GetNTPTimestamp()		const { return get8(data,8);			}
+	DWORD GetRTPTimestamp()		const { return get4(data,16);			}
+	DWORD GetPacketsSent()		const { return get4(data,20);			}
+	DWORD GetOctectsSent()		const { return get4(data,24);			}
+	//Sender time in us since epoch
+	QWORD GetTimestamp()		const;
+	RTCPReportView GetReport(BYTE i) const { return RTCPReportView(data+28+i*RTCPReportView::Size);	}
+};
+
+class RTCPReceiverReportView : public RTCPPacketView
+{
+public:
+	RTCPReceiverReportView(const RTCPPacketView& packet) : RTCPPacketView(packet) {}
+
+	bool  IsValid()			const { return size>=8+GetCount()*RTCPReportView::Size;	}
+	DWORD GetSSRC()			const { return get4(data,4);			}
+	RTCPReportView GetReport(BYTE i) const { return RTCPReportView(data+8+i*RTCPReportView::Size);	}
+};
+
+class RTCPByeView : public RTCPPacketView
+{
+public:
+	RTCPByeView(const RTCPPacketView& packet) : RTCPPacketView(packet) {}
+
+	bool  IsValid()			const { return size>=4+GetCount()*4u;		}
+	DWORD GetSSRC(BYTE i)		const { return get4(data,4+i*4);		}
+};
+
+/**
+ * Generic feedback message, RTPFB or PSFB, with the feedback control
+ * information of the known types.
+ */
+class RTCPFeedbackView : public RTCPPacketView
+{
+public:
+	RTCPFeedbackView(const RTCPPacketView& packet) : RTCPPacketView(packet) {}
+
+	bool  IsValid()			const { return size>=12;			}
+	BYTE  GetFeedbackType()		const { return GetCount();			}
+	DWORD GetSenderSSRC()		const { return get4(data,4);			}
+	DWORD GetMediaSSRC()		const { return get4(data,8);			}
+	const BYTE* GetFCI()		const { return data+12;				}
+	DWORD GetFCISize()		const { return size-12;				}
+
+	//Generic NACK
+	DWORD GetNACKCount()		const { return GetFCISize()/4;			}
+	RTCPRTPFeedback::NACKField GetNACK(DWORD i) const { return RTCPRTPFeedback::NACKField(get2(data,12+i*4),get2(data,14+i*4));	}
+
+	//Receiver estimated max bitrate
+	bool  IsREMB()			const;
+	DWORD GetREMBBitrate()		const;
+	BYTE  GetREMBSSRCCount()	const;
+	DWORD GetREMBSSRC(BYTE i)	const { return get4(data,20+i*4);		}
+};
+
+class RTCPCompoundView
+{
+public:
+	class Iterator
+	{
+	public:
+		Iterator(const BYTE* data) : data(data) {}
+		RTCPPacketView operator*() const		{ return RTCPPacketView(data,GetLength());	}
+		bool operator!=(const Iterator& other) const	{ return data!=other.data;			}
+		Iterator& operator++()
+		{
+			//Skip current one
+			data += GetLength();
+			return *this;
+		}
+	private:
+		DWORD GetLength() const	{ return (get2(data,2)+1)*4;	}
+	private:
+		const BYTE* data;
+	};
+public:
+	RTCPCompoundView(const BYTE* data, DWORD size) : data(data), size(size) {}
+
+	//Check the headers of all the packets
+	bool IsValid() const;
+	Iterator begin() const	{ return Iterator(data);		}
+	Iterator end() const	{ return Iterator(data+size);		}
+	const BYTE* GetData() const	{ return data;		}
+	DWORD GetSize() const	{ return size;			}
+	void Dump() const;
+private:
+	const BYTE* data;
+	DWORD size;
+};
+
+/**
+ * Writes RTCP packets directly on a buffer, appending them to a compound one.
+ * Each Add method returns false and writes nothing if there is not enough room.
+ */
+class RTCPCompoundBuilder
+{
+public:
+	RTCPCompoundBuilder(BYTE* data, DWORD size) : data(data), size(size) {}
+
+	bool AddNACK(DWORD senderSSRC, DWORD mediaSSRC, const RTCPRTPFeedback::NACKField* fields, DWORD num);
+	bool AddPLI(DWORD senderSSRC, DWORD mediaSSRC);
+	bool AddREMB(DWORD senderSSRC, DWORD bitrate, const DWORD* ssrcs, BYTE num);
+	bool AddTransportWideFeedback(DWORD senderSSRC, DWORD mediaSSRC, const RTCPRTPFeedback::TransportWideFeedbackMessageField& field);
+
+	DWORD GetSize() const	{ return len;	}
+private:
+	//Write common header and ssrcs of a feedback message, returns pointer to fci
+	BYTE* AddFeedback(RTCPPacket::Type type, BYTE feedbackType, DWORD senderSSRC, DWORD mediaSSRC, DWORD fciSize);
+private:
+	BYTE* data;
+	DWORD size;
+	DWORD len = 0;
+};
+
+#endif /* RTCPCOMPOUNDVIEW_H */
@@ -1,7 +1,8 @@
 #ifndef RTPBUFFER_H
 #define	RTPBUFFER_H
 
-#include <map>
+#include <algorithm>
+#include <vector>
 
 #include "config.h"
 #include "acumulator.h"
@@ -9,10 +10,26 @@
 #include "rtp/RTPPacket.h"
 #include "TimeService.h"
 
+/**
+ * Reordering buffer for incoming packets.
+ *
+ * Packets are stored on a power of two ring indexed by extended sequence number
+ * with an occupancy bitmap, so insertion and removal don't allocate and the next
+ * packet present is found by scanning the bitmap a word at a time. The ring grows
+ * when needed up to a full sequence number cycle.
+ */
 class RTPBuffer 
 {
 public:
-	RTPBuffer() : waited(1000) {}
+	static constexpr DWORD InitialCapacity	= 256;
+	static constexpr DWORD MaxCapacity	= 65536;
+public:
+	RTPBuffer() : 
+		waited(1000),
+		slots(InitialCapacity),
+		present(InitialCapacity/64, 0),
+		mask(InitialCapacity-1)
+	{}
 	~RTPBuffer() = default;
 	bool Add(const RTPPacket::shared& rtp)
 	{
@@ -29,59 +46,82 @@ public:
 		}
 		
 		//Check if we already have it
-		if (packets.find(seq)!=packets.end())
+		if (count && seq>=first && seq<=last && IsPresent(seq))
 		{
 			//Error
 			//UltraDebug("-RTPBuffer::Add() | Already have that packet [next:%u,seq:%u,maxWaitTime=%d,cycles:%d-%u]\n",next,seq,maxWaitTime,rtp->GetSeqCycles(),rtp->GetSeqNum());
 			//Skip it and lost forever
 			return false;
 		}
+		
+		//Get new window
+		DWORD lo = count ? std::min(first,seq) : seq;
+		DWORD hi = count ? std::max(last,seq) : seq;
+		
+		//If it doesn't fit on the ring and we can't grow it
+		if (hi-lo>mask && !Grow(hi-lo+1))
+		{
+			//Debug
+			Debug("-RTPBuffer::Add() | Sequence number jump, dropping queued packets [seq:%u,first:%u,last:%u,queued:%u]\n",seq,first,last,count);
+			//Queued ones are lost
+			discarded += count;
+			Clear();
+			//Only the new one
+			lo = hi = seq;
+		}
 
 		//Add packet
-		packets[seq] = rtp;
+		DWORD index = seq & mask;
+		slots[index] = rtp;
+		present[index/64] |= (uint64_t)1 << (index%64);
+		//Update window
+		first = lo;
+		last  = hi;
+		count++;
 		
 		return true;
 	}
 	
 	RTPPacket::shared GetOrdered(QWORD now)
 	{
-		
-		//Check if we have somethin in queue
-		if (!packets.empty())
+		//While we have somethin in queue
+		while (count)
 		{
-			//Get first
-			auto it = packets.begin();
 			//Get first seq num
-			DWORD seq = it->first;
-			//Get packet
-			auto candidate = it->second;
+			DWORD seq = first;
+			DWORD index = seq & mask;
 			//Get time of the packet
-			QWORD time = candidate->GetTime();
+			QWORD time = slots[index]->GetTime();
 
 			//Check if first is the one expected or wait if not
-			if (next==(DWORD)-1 || seq==next || time+maxWaitTime<=now || hurryUp)
+			if (!(next==(DWORD)-1 || seq==next || time+maxWaitTime<=now || hurryUp))
+				//Wait
+				break;
+			
+			//Update next
+			next = seq+1;
+			//Waiting time
+			waited.Update(now, now>time ? now-time : 0);
+			//Remove it
+			RTPPacket::shared candidate = std::move(slots[index]);
+			present[index/64] &= ~((uint64_t)1 << (index%64));
+			//If no mor packets
+			if (!--count)
+				//Not hurryUp more
+				hurryUp = false;
+			else
+				//Move to next one present
+				first = FindNext(seq+1);
+			//Skip if empty
+			if (!candidate->GetMediaLength())
 			{
-				//Update next
-				next = seq+1;
-				//Waiting time
-				waited.Update(now, now>time ? now-time : 0);
-				//Remove it
-				packets.erase(it);
-				//If no mor packets
-				if (packets.empty())
-					//Not hurryUp more
-					hurryUp = false;
-				//Skip if empty
-				if (!candidate->GetMediaLength())
-				{
-					//This one is dropped
-					discarded++;
-					//Try next
-					return GetOrdered(now);
-				}
-				//Return it
-				return candidate;
+				//This one is dropped
+				discarded++;
+				//Try next
+				continue;
 			}
+			//Return it
+			return candidate;
 		}
 		//Rerturn 
 		return NULL;
@@ -89,8 +129,14 @@ public:
 	
 	void Clear()
 	{
-		//Clear all list
-		packets.clear();
+		//Release all queued packets
+		for (DWORD seq = count ? first : 0; count; seq = FindNext(seq+1))
+		{
+			DWORD index = seq & mask;
+			slots[index].reset();
+			present[index/64] &= ~((uint64_t)1 << (index%64));
+			count--;
+		}
 	}
 
 	void HurryUp()
@@ -115,7 +161,7 @@ public:
 	DWORD Length() const
 	{
 		//REturn objets in queu
-		return packets.size();
+		return count;
 	}
 	
 	void SetMaxWaitTime(DWORD maxWaitTime)
@@ -165,18 +211,14 @@ public:
 	QWORD GetWaitTime(QWORD now)
 	{
 		//Check if we have somethin in queue
-		if (packets.empty())
+		if (!count)
 			//Forever
 			return (QWORD)-1;
 		
-		//Get frist packet
-		auto it = packets.begin();
 		//Get first seq num
-		DWORD seq = it->first;
-		//Get packet
-		auto candidate = it->second;
+		DWORD seq = first;
 		//Get time of the packet
-		QWORD time = candidate->GetTime();
+		QWORD time = slots[seq & mask]->GetTime();
 		//Get wait time
 		if (next==(DWORD)-1 || seq==next || time+maxWaitTime<=now || hurryUp)
 			//Now!
@@ -186,9 +228,68 @@ public:
 	}
 	
 private:
-	//The event list
-	std::map<DWORD,RTPPacket::shared> packets;
+	bool IsPresent(DWORD seq) const
+	{
+		DWORD index = seq & mask;
+		return present[index/64] & ((uint64_t)1 << (index%64));
+	}
+	
+	//Get first packet present from seq, which must be on the window
+	DWORD FindNext(DWORD seq) const
+	{
+		while (seq<=last)
+		{
+			DWORD index = seq & mask;
+			//Get bits from this one till the end of the word, ring size is multiple of 64 so it doesn't wrap inside a word
+			uint64_t bits = present[index/64] >> (index%64);
+			//If any present
+			if (bits)
+				return seq + __builtin_ctzll(bits);
+			//Next word
+			seq += 64 - index%64;
+		}
+		return last;
+	}
+	
+	bool Grow(DWORD needed)
+	{
+		//Double size until it fits
+		DWORD capacity = mask+1;
+		while (capacity<needed)
+			capacity *= 2;
+		//Check max size
+		if (capacity>MaxCapacity)
+			return false;
+		
+		//Create new ring
+		std::vector<RTPPacket::shared> grown(capacity);
+		std::vector<uint64_t> bitmap(capacity/64, 0);
+		DWORD newMask = capacity-1;
+		
+		//Move all queued packets
+		for (DWORD i = 0, seq = first; i<count; ++i, seq = FindNext(seq+1))
+		{
+			DWORD index = seq & newMask;
+			grown[index] = std::move(slots[seq & mask]);
+			bitmap[index/64] |= (uint64_t)1 << (index%64);
+		}
+		
+		//Use new one
+		slots.swap(grown);
+		present.swap(bitmap);
+		mask = newMask;
+		
+		return true;
+	}
+private:
 	Acumulator<uint32_t, uint64_t> waited;
+	//Packets indexed by ext seq num and their occupancy
+	std::vector<RTPPacket::shared> slots;
+	std::vector<uint64_t> present;
+	DWORD mask		= 0;
+	DWORD first		= 0;
+	DWORD last		= 0;
+	DWORD count		= 0;
 	
 	bool  hurryUp		= false;
 	DWORD next		= (DWORD)-1;
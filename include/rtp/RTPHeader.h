@@ -8,10 +8,37 @@
 #ifndef RTPHEADER_H
 #define RTPHEADER_H
 #include "config.h"
-#include <list>
+#include <array>
 
 class RTPHeader
 {
+public:
+	//CC is 4 bits
+	static constexpr BYTE MaxCSRCs = 15;
+
+	//Fixed capacity csrc list, so parsing doesn't allocate
+	class CSRCs
+	{
+	public:
+		bool push_back(DWORD csrc)
+		{
+			//Check we have room
+			if (count==MaxCSRCs)
+				return false;
+			//Add it
+			csrcs[count++] = csrc;
+			return true;
+		}
+		void clear()				{ count = 0;			}
+		size_t size()			const	{ return count;			}
+		bool empty()			const	{ return !count;		}
+		DWORD operator[](size_t i)	const	{ return csrcs[i];		}
+		const DWORD* begin()		const	{ return csrcs.data();		}
+		const DWORD* end()		const	{ return csrcs.data() + count;	}
+	private:
+		std::array<DWORD,MaxCSRCs> csrcs = {};
+		BYTE count = 0;
+	};
 public:
 	RTPHeader() = default;
 
@@ -29,7 +56,7 @@ public:
 	DWORD	timestamp	= 0;
 	DWORD	ssrc		= 0;
 
-	std::list<DWORD> csrcs;
+	CSRCs csrcs;
 };
 
 #endif /* RTPHEADER_H */
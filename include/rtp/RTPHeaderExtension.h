@@ -15,6 +15,7 @@
 #define RTPHEADEREXTENSION_H
 #include <optional>
 #include <cmath>
+#include <array>
 
 #include "config.h"
 #include "tools.h"
@@ -147,10 +148,33 @@ public:
 		}
 	};
 	
+	//Position of the serialized values that change on each sent packet, 0 if not present
+	struct Offsets
+	{
+		DWORD absSentTime	= 0;
+		DWORD transportSeqNum	= 0;
+	};
+	
+	//Negotiated ids indexed by extension type, compiled from the extension map for O(1) lookups
+	class IdMap
+	{
+	public:
+		IdMap()					{ ids.fill((BYTE)RTPMap::NotFound);	}
+		explicit IdMap(const RTPMap& extMap);
+		
+		BYTE GetId(Type type) const		{ return type<ids.size() ? ids[type] : (BYTE)RTPMap::NotFound;	}
+		bool HasId(Type type) const		{ return GetId(type)!=RTPMap::NotFound;				}
+		bool operator==(const IdMap& other) const { return ids==other.ids;	}
+		bool operator!=(const IdMap& other) const { return ids!=other.ids;	}
+	private:
+		std::array<BYTE,16> ids;
+	};
+	
 public:
 	DWORD Parse(const RTPMap &extMap,const BYTE* data,const DWORD size);
-	bool  ParseDependencyDescriptor(const std::optional<TemplateDependencyStructure>& templateDependencyStructure);
-	DWORD Serialize(const RTPMap &extMap,BYTE* data,const DWORD size) const;
+	bool  ParseDependencyDescriptor(const TemplateDependencyStructure* templateDependencyStructure);
+	DWORD Serialize(const RTPMap &extMap,BYTE* data,const DWORD size,Offsets* offsets = nullptr) const;
+	DWORD Serialize(const IdMap &ids,BYTE* data,const DWORD size,Offsets* offsets = nullptr) const;
 	void  Dump() const;
 public:
 	QWORD	absSentTime	= 0;
@@ -7,6 +7,7 @@
 #include "rtp/RTPPacket.h"
 #include "rtp/RTPSource.h"
 #include "rtp/RTCPReport.h"
+#include "rtp/RTCPCompoundView.h"
 #include "acumulator.h"
 #include "WrapExtender.h"
 
@@ -69,6 +70,7 @@ struct RTPIncomingSource : public RTPSource
 	void Update(QWORD now,DWORD seqNum,DWORD size,const std::vector<LayerInfo> &layerInfos, bool aggreagtedLayers);
 	
 	void Process(QWORD now, const RTCPSenderReport::shared& sr);
+	void Process(QWORD now, const RTCPSenderReportView& sr);
 	void SetLastTimestamp(QWORD now, QWORD timestamp, QWORD captureTimestamp = 0);
 	
 	virtual void Update(QWORD now,DWORD seqNum,DWORD size) override;
@@ -81,6 +83,9 @@ struct RTPIncomingSource : public RTPSource
 	}
 	
 	RTCPReport::shared CreateReport(QWORD now);
+private:
+	template<typename SenderReport>
+	void ProcessSenderReport(QWORD now, const SenderReport& sr);
 };
 
 #endif /* RTPINCOMINGSOURCE_H */
@@ -42,6 +42,7 @@ public:
 	void Update();
 	void SetRTT(DWORD rtt, QWORD now);
 	std::list<RTCPRTPFeedback::NACKField::shared>  GetNacks() { return losts.GetNacks(); }
+	DWORD GetNacks(RTCPRTPFeedback::NACKField* fields, DWORD max, QWORD now, DWORD rtt) { return losts.GetNacks(fields,max,now,rtt); }
 	
 	void Start(bool remb = false);
 	void Stop();
@@ -82,7 +83,7 @@ private:
 	RTPBuffer	packets;
 	std::set<RTPIncomingMediaStream::Listener*>  listeners;
 	std::optional<std::vector<bool>> activeDecodeTargets;
-	std::optional<TemplateDependencyStructure> templateDependencyStructure;
+	TemplateDependencyStructure::shared templateDependencyStructure;
 	
 	bool  isRTXEnabled = true;
 	WORD  rttrtxSeq	 = 0 ;
@@ -2,6 +2,7 @@
 #define RTPLOSTPACKETS_H
 
 #include <list>
+#include <vector>
 
 #include "config.h"
 #include "rtp/RTPPacket.h"
@@ -10,17 +11,41 @@
 
 class RTPLostPackets
 {
+public:
+	static const BYTE  MaxRetries;
+	static const DWORD MinRetryInterval;
 public:
 	RTPLostPackets(WORD num);
-	~RTPLostPackets();
+	~RTPLostPackets() = default;
 	void Reset();
 	WORD AddPacket(const RTPPacket::shared &packet);
 	std::list<RTCPRTPFeedback::NACKField::shared>  GetNacks() const;
+	/**
+	 * Get nack fields for the lost packets that have to be requested now
+	 * Packets already nacked are not requested again until an rtt has passed or after MaxRetries.
+	 * @param fields	Buffer to write the fields to
+	 * @param max		Max number of fields to write
+	 * @param now		Current time in ms
+	 * @param rtt		Current rtt in ms
+	 * @return number of fields written
+	 */
+	DWORD GetNacks(RTCPRTPFeedback::NACKField* fields, DWORD max, QWORD now, DWORD rtt);
 	void Dump() const;
 	DWORD GetTotal() const {return total;}
-	
+
 private:
-	QWORD *packets;
+	bool IsReceived(DWORD extSeq) const	{ DWORD index = extSeq & mask; return received[index/64] & ((uint64_t)1 << (index%64));	}
+	//Get mask of lost packets on the window starting from extSeq
+	uint64_t GetLost(DWORD extSeq) const;
+	bool CanRetry(DWORD extSeq, QWORD now, DWORD rtt) const;
+	void Retry(DWORD extSeq, QWORD now);
+	void Remove(DWORD extSeq, DWORD num);
+private:
+	//Received bitmap, retries and last nack time of each packet on the window, by ext seq num
+	std::vector<uint64_t> received;
+	std::vector<BYTE> retries;
+	std::vector<DWORD> nacked;
+	DWORD mask  = 0;
 	WORD size   = 0;
 	WORD len    = 0;
 	DWORD first = 0;
@@ -29,4 +54,3 @@ private:
 
 
 #endif /* RTPLOSTPACKETS_H */
-
@@ -5,6 +5,7 @@
 #include "rtp/RTPPacket.h"
 #include "rtp/RTPSource.h"
 #include "rtp/RTCPSenderReport.h"
+#include "rtp/RTCPCompoundView.h"
 
 struct RTPOutgoingSource : 
 	public RTPSource
@@ -50,9 +51,13 @@ struct RTPOutgoingSource :
 	
 	RTCPSenderReport::shared CreateSenderReport(QWORD time);
 	bool ProcessReceiverReport(QWORD time, const RTCPReport::shared& report);
+	bool ProcessReceiverReport(QWORD time, const RTCPReportView& report);
 	bool IsLastSenderReportNTP(DWORD ntp);
 
 	void SetLastTimestamp(QWORD now, QWORD timestamp);
+private:
+	template<typename Report>
+	bool ProcessReport(QWORD now, Report& report);
 };
 
 #endif /* RTPOUTGOINGSOURCE_H */
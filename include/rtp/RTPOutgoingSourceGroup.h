@@ -9,7 +9,7 @@
 #include "rtp/RTPPacket.h"
 #include "rtp/RTPOutgoingSource.h"
 #include "TimeService.h"
-#include "CircularBuffer.h"
+#include "rtp/RTPPacketHistory.h"
 
 struct RTPOutgoingSourceGroup
 {
@@ -39,8 +39,13 @@ public:
 	void Update(QWORD now);
 	void Update();
 	//RTX packets
-	void AddPacket(const RTPPacket::shared& packet);
-	RTPPacket::shared GetPacket(WORD seq) const;
+	void AddPacket(const RTPPacket::shared& packet, const BYTE* data, DWORD size, QWORD now);
+	RTPPacket::shared GetPacket(WORD seq, QWORD now);
+	void SetRTT(DWORD rtt)					{ history.SetRTT(rtt);	}
+	void SetRTXHistory(DWORD maxAge, DWORD maxBytes)	{ history.SetMaxAge(maxAge); history.SetMaxBytes(maxBytes); }
+	//Reference payloads shared with the publisher instead of copying them
+	void SetRTXSharedPayloads(bool shared)			{ history.SetSharePayloads(shared); }
+	const RTPPacketHistory& GetRTXHistory() const		{ return history;	}
 
 	void Stop();
 	
@@ -53,7 +58,7 @@ public:
 	QWORD lastUpdated = 0;
 private:	
 	TimeService& timeService;
-	CircularBuffer<RTPPacket::shared, uint16_t, 512> packets;
+	RTPPacketHistory history;
 	std::set<Listener*> listeners;
 };
 
@@ -21,8 +21,12 @@
 #include "rtp/RTPPayloadPool.h"
 #include "vp8/vp8.h"
 #include "vp9/VP9PayloadDescription.h"
+#include "ArenaAllocator.h"
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <vector>
 
 class RTPPacket
 {
@@ -36,21 +40,34 @@ public:
 public:
 	static RTPPacket::shared Parse(const BYTE* data, DWORD size, const RTPMap& rtpMap, const RTPMap& extMap);
 	static RTPPacket::shared Parse(const BYTE* data, DWORD size, const RTPMap& rtpMap, const RTPMap& extMap, QWORD time);
+	
+	//Create packet recycling the memory of previous ones released on this thread
+	template <typename... Args>
+	static RTPPacket::shared Create(Args&&... args)
+	{
+		return std::allocate_shared<RTPPacket>(ArenaAllocator<RTPPacket>(), std::forward<Args>(args)...);
+	}
 public:
 	RTPPacket(MediaFrame::Type media, BYTE codec);
 	RTPPacket(MediaFrame::Type media, BYTE codec, QWORD time);
 	RTPPacket(MediaFrame::Type media, BYTE codec, const RTPHeader& header, const RTPHeaderExtension& extension);
 	RTPPacket(MediaFrame::Type media, BYTE codec, const RTPHeader& header, const RTPHeaderExtension& extension, QWORD time);
+	RTPPacket(MediaFrame::Type media, BYTE codec, const RTPHeader& header, RTPHeaderExtension&& extension, QWORD time);
 	RTPPacket(MediaFrame::Type media, BYTE codec, const RTPHeader& header, const RTPHeaderExtension& extension, const RTPPayload::shared& payload, QWORD time);
 	virtual ~RTPPacket();
 
 	RTPPacket::shared Clone() const;
 	
 	DWORD Serialize(BYTE* data,DWORD size,const RTPMap& extMap) const;
+	DWORD Serialize(BYTE* data,DWORD size,const RTPHeaderExtension::IdMap& extIds) const;
+	//True if the serialization has been stored for the other clones
+	bool  IsSerializationShared() const;
 	
-	bool SetPayload(const BYTE *data,DWORD size)	{ return payload->SetPayload(data,size);	}
-	bool SkipPayload(DWORD skip)			{ return payload->SkipPayload(skip);		}
-	bool PrefixPayload(BYTE *data,DWORD size)	{ return payload->PrefixPayload(data,size);	}
+	bool SetPayload(const BYTE *data,DWORD size)	{ Invalidate(); return payload->SetPayload(data,size);		}
+	bool SkipPayload(DWORD skip)			{ Invalidate(); return payload->SkipPayload(skip);		}
+	bool PrefixPayload(BYTE *data,DWORD size)	{ Invalidate(); return payload->PrefixPayload(data,size);	}
+	//Payload shared with the packet this one was cloned from, nullptr if owned
+	RTPPayload::shared GetSharedPayload() const	{ return ownedPayload ? nullptr : payload;			}
 	
 	bool RecoverOSN();
 	void SetOSN(DWORD extSeqNum);
@@ -73,7 +90,7 @@ public:
 	void SetTimestampCycles(DWORD cycles)	{ this->timestampCycles = cycles;	}
 	void SetClockRate(DWORD rate)		{ this->clockRate = rate;		}
 
-	void SetMediaLength(DWORD len)		{ payload->SetMediaLength(len);		}
+	void SetMediaLength(DWORD len)		{ Invalidate(); payload->SetMediaLength(len);	}
 	
 	//Getters
 	MediaFrame::Type GetMedia()	const { return media;				} //Deprecated
@@ -100,17 +117,17 @@ public:
 
 	//Extensions
 	void  SetAbsSentTime(QWORD absSentTime)						{ header.extension = extension.hasAbsSentTime		= true; extension.absSentTime = absSentTime;	}
-	void  SetTimeOffset(int timeOffset)						{ header.extension = extension.hasTimeOffset		= true; extension.timeOffset = timeOffset;	}
+	void  SetTimeOffset(int timeOffset)						{ Invalidate(); header.extension = extension.hasTimeOffset		= true; extension.timeOffset = timeOffset;	}
 	void  SetTransportSeqNum(DWORD seq)						{ header.extension = extension.hasTransportWideCC	= true; extension.transportSeqNum = seq;	}
-	void  SetFrameMarkings(const RTPHeaderExtension::FrameMarks& frameMarks )	{ header.extension = extension.hasFrameMarking		= true; extension.frameMarks = frameMarks;	}
-	void  SetRId(const std::string &rid)						{ header.extension = extension.hasRId			= true; extension.rid = rid;			}
-	void  SetRepairedId(const std::string &repairedId)				{ header.extension = extension.hasRepairedId		= true; extension.repairedId = repairedId;	}
+	void  SetFrameMarkings(const RTPHeaderExtension::FrameMarks& frameMarks )	{ Invalidate(); header.extension = extension.hasFrameMarking		= true; extension.frameMarks = frameMarks;	}
+	void  SetRId(const std::string &rid)						{ Invalidate(); header.extension = extension.hasRId			= true; extension.rid = rid;			}
+	void  SetRepairedId(const std::string &repairedId)				{ Invalidate(); header.extension = extension.hasRepairedId		= true; extension.repairedId = repairedId;	}
 	void  SetMediaStreamId(const std::string &mid)					{ header.extension = extension.hasMediaStreamId		= true; extension.mid = mid;			}
-	void  SetDependencyDescriptor(DependencyDescriptor& dependencyDescriptor)	{ header.extension = extension.hasDependencyDescriptor	= true; extension.dependencyDescryptor = dependencyDescriptor;		}
-	void  SetAbsoluteCaptureTimestamp(QWORD ntp)					{ header.extension = extension.hasAbsoluteCaptureTime	= true; extension.absoluteCaptureTime.SetAbsoluteCaptureTimestamp(ntp); }
-	void  SetAbsoluteCaptureTime(QWORD ms)						{ header.extension = extension.hasAbsoluteCaptureTime	= true; extension.absoluteCaptureTime.SetAbsoluteCaptureTime(ms);	}
+	void  SetDependencyDescriptor(DependencyDescriptor& dependencyDescriptor)	{ Invalidate(); header.extension = extension.hasDependencyDescriptor	= true; extension.dependencyDescryptor = dependencyDescriptor;		}
+	void  SetAbsoluteCaptureTimestamp(QWORD ntp)					{ Invalidate(); header.extension = extension.hasAbsoluteCaptureTime	= true; extension.absoluteCaptureTime.SetAbsoluteCaptureTimestamp(ntp); }
+	void  SetAbsoluteCaptureTime(QWORD ms)						{ Invalidate(); header.extension = extension.hasAbsoluteCaptureTime	= true; extension.absoluteCaptureTime.SetAbsoluteCaptureTime(ms);	}
 	
-	bool  ParseDependencyDescriptor(const std::optional<TemplateDependencyStructure>& templateDependencyStructure, std::optional<std::vector<bool>>& activeDecodeTargets);
+	bool  ParseDependencyDescriptor(const TemplateDependencyStructure::shared& templateDependencyStructure, const std::optional<std::vector<bool>>& activeDecodeTargets);
 	
 	//Disable extensions
 	void  DisableAbsSentTime()		{ extension.hasAbsSentTime		= false; CheckExtensionMark(); }
@@ -136,7 +153,7 @@ public:
 	
 	const RTPHeaderExtension::FrameMarks&			GetFrameMarks()			 const { return extension.frameMarks;		}
 	const std::optional<DependencyDescriptor>&		GetDependencyDescriptor()	 const { return extension.dependencyDescryptor;	}
-	const std::optional<TemplateDependencyStructure>&	GetTemplateDependencyStructure() const { return templateDependencyStructure;	}
+	const TemplateDependencyStructure::shared&		GetTemplateDependencyStructure() const { return templateDependencyStructure;	}
 	const std::optional<std::vector<bool>>&			GetActiveDecodeTargets()	 const { return activeDecodeTargets;		}
 	const VideoOrientation&					GetVideoOrientation()		 const { return extension.cvo;			}
 	
@@ -160,7 +177,7 @@ public:
 		if (extension.dependencyDescryptor)
 			extension.dependencyDescryptor->activeDecodeTargets = activeDecodeTargets;
 	}
-	void OverrideTemplateDependencyStructure(const std::optional<TemplateDependencyStructure>& templateDependencyStructure)
+	void OverrideTemplateDependencyStructure(const TemplateDependencyStructure::shared& templateDependencyStructure)
 	{
 		this->templateDependencyStructure = templateDependencyStructure;
 	}
@@ -189,7 +206,7 @@ public:
 	std::optional<VP8PayloadHeader>		vp8PayloadHeader;
 	std::optional<VP9PayloadDescription>	vp9PayloadDescriptor;
 	std::optional<std::vector<bool>>	activeDecodeTargets;
-	std::optional<TemplateDependencyStructure> templateDependencyStructure;
+	TemplateDependencyStructure::shared	templateDependencyStructure;
 	Buffer::shared				config;
 
 	bool rewitePictureIds = false;
@@ -208,6 +225,34 @@ protected:
 						|| extension.hasVideoOrientation
 						|| extension.hasDependencyDescriptor; }
 
+private:
+	/**
+	 * Extensions and payload serialized by the first clone sent, shared with the
+	 * rest of clones of the same packet so they only have to rewrite the RTP
+	 * header and patch the abs-send-time and transport-wide seq num values.
+	 * Bytes are only stored once there is more than one clone to reuse them.
+	 */
+	struct SharedSerialization
+	{
+		std::mutex	mutex;
+		std::atomic<bool> ready = false;
+		std::atomic<DWORD> clones = 0;
+		//Inputs the bytes depend on
+		RTPHeaderExtension::IdMap extIds;
+		std::string	mid;
+		DWORD		flags = 0;
+		DWORD		mediaLength = 0;
+		//Serialized extension header and payload, recycled with the block
+		BYTE		data[MTU];
+		DWORD		dataLength = 0;
+		RTPHeaderExtension::Offsets offsets;
+	};
+	
+	DWORD SerializeFull(BYTE* data,DWORD size,const RTPHeaderExtension::IdMap& extIds,DWORD* headerLength = nullptr,RTPHeaderExtension::Offsets* offsets = nullptr) const;
+	DWORD GetSerializationFlags() const;
+	bool  CanShareSerialization() const	{ return !osn && !rewitePictureIds && !extension.hasDependencyDescriptor;	}
+	void  Invalidate()			{ std::atomic_store(&sharedSerialization, std::shared_ptr<SharedSerialization>());	}
+
 private:
 	MediaFrame::Type media;
 	BYTE		codec;
@@ -223,6 +268,7 @@ private:
 	QWORD time			= 0;
 	bool isKeyFrame			= false;
 	QWORD senderTime		= 0;
+	mutable std::shared_ptr<SharedSerialization> sharedSerialization;
 
 };
 #endif /* RTPPACKET_H */
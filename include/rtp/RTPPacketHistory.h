@@ -0,0 +1,96 @@
+#ifndef RTPPACKETHISTORY_H
+#define RTPPACKETHISTORY_H
+
+#include <deque>
+#include <vector>
+
+#include "config.h"
+#include "rtp/RTPPacket.h"
+
+/**
+ * History of sent packets available for retransmission.
+ *
+ * Only headers are kept per packet, the payloads as sent are copied on a byte
+ * slab shared by all of them that grows on demand up to the max size, so memory
+ * depends on the bitrate and the max age instead of on a fixed packet count.
+ * Packets older than the max age are evicted, and so are the oldest ones when
+ * the slab is full. Times are in ms.
+ *
+ * Optionally, payloads of clones sent unmodified are not copied but referenced,
+ * so all the subscribers of the same publisher share a single copy of them.
+ * Referenced payloads are only bounded by the max age.
+ */
+class RTPPacketHistory
+{
+public:
+	static const DWORD DefaultMaxAge;
+	static const DWORD DefaultMaxBytes;
+	static const DWORD MinAge;
+	static const DWORD RTTs;
+	static const DWORD InitialCapacity;
+public:
+	RTPPacketHistory(DWORD maxAge = DefaultMaxAge, DWORD maxBytes = DefaultMaxBytes);
+
+	void SetMaxAge(DWORD maxAge)	{ this->maxAge = maxAge;	}
+	void SetMaxBytes(DWORD maxBytes);
+	void SetSharePayloads(bool sharePayloads)	{ this->sharePayloads = sharePayloads;	}
+	//Packets are kept for a few rtts, but at least MinAge and no more than max age
+	void SetRTT(DWORD rtt)		{ this->rtt = rtt;		}
+	DWORD GetAge() const;
+
+	//Add sent packet with its serialized data
+	bool Add(const RTPPacket::shared& packet, const BYTE* data, DWORD size, QWORD now);
+	//Rebuild packet with given seq num, nullptr if not available anymore
+	RTPPacket::shared Get(WORD seq, QWORD now);
+	void Clear();
+
+	DWORD GetLength()	const { return entries.size();				}
+	DWORD GetBytes()	const { return bytes;					}
+	DWORD GetCapacity()	const { return slab.size();				}
+	DWORD GetFirstSeq()	const { return entries.empty() ? 0 : entries.front().extSeqNum;	}
+	DWORD GetLastSeq()	const { return entries.empty() ? 0 : entries.back().extSeqNum;	}
+	QWORD GetHits()		const { return hits;					}
+	QWORD GetMisses()	const { return misses;					}
+	QWORD GetEvicted()	const { return evicted;					}
+	QWORD GetReferenced()	const { return referenced;				}
+private:
+	struct Entry
+	{
+		RTPHeader		header;
+		RTPHeaderExtension	extension;
+		MediaFrame::Type	media;
+		BYTE			codec;
+		bool			keyFrame;
+		DWORD			clockRate;
+		DWORD			extSeqNum;
+		QWORD			time;
+		QWORD			sent;
+		//Payload position on the slab
+		DWORD			offset;
+		DWORD			size;
+		//Shared payload, not copied on the slab
+		RTPPayload::shared	payload;
+	};
+
+	void Expire(QWORD now);
+	void Evict();
+	//Get offset on the slab for the payload, evicting or growing as needed
+	DWORD Allocate(DWORD size);
+	//Move payloads to a new slab
+	void Resize(DWORD capacity);
+private:
+	std::deque<Entry> entries;
+	std::vector<BYTE> slab;
+	DWORD head	= 0;
+	DWORD bytes	= 0;
+	DWORD maxAge	= 0;
+	DWORD maxBytes	= 0;
+	DWORD rtt	= 0;
+	bool  sharePayloads = false;
+	QWORD hits	= 0;
+	QWORD misses	= 0;
+	QWORD evicted	= 0;
+	QWORD referenced = 0;
+};
+
+#endif /* RTPPACKETHISTORY_H */
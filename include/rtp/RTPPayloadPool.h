@@ -2,6 +2,7 @@
 #define RTPPAYLOAD_POOL_H_
 
 #include "concurrentqueue.h"
+#include "ArenaAllocator.h"
 #include "RTPPayload.h"
 
 class RTPPayloadPool
@@ -33,13 +34,13 @@ public:
 			//Create a new one
 			payload = new RTPPayload();
 
-		//We need to create a new one
+		//We need to create a new one, recycling the control block memory
 		return RTPPayload::shared(payload, [&](auto p) {
 			//Reset it
 			p->Reset();
 			//Enqueue it back
 			pool.enqueue(p);
-		});
+		}, ArenaAllocator<RTPPayload>());
 	}
 
 private:
@@ -0,0 +1,39 @@
+#ifndef RTPSENDPROFILE_H
+#define RTPSENDPROFILE_H
+
+#include <array>
+
+#include "config.h"
+#include "rtp/RTPMap.h"
+#include "rtp/RTPHeaderExtension.h"
+
+/**
+ * Negotiated payload types and header extension ids used for sending, compiled
+ * from the send maps when they are set so each outgoing packet only needs
+ * O(1) lookups instead of scanning the maps.
+ */
+class RTPSendProfile
+{
+public:
+	RTPSendProfile();
+
+	void Compile(const RTPMap& rtp, const RTPMap& ext, const RTPMap& apt);
+	void Reset();
+
+	BYTE GetPayloadType(BYTE codec) const		{ return payloadTypes[codec];				}
+	bool HasCodec(BYTE codec) const			{ return payloadTypes[codec]!=RTPMap::NotFound;		}
+	//RTX payload type for the original one, NotFound if not negotiated
+	BYTE GetRTXPayloadType(BYTE payloadType) const	{ return rtxPayloadTypes[payloadType];			}
+	//First RTX payload type, used for padding only packets
+	BYTE GetDefaultRTXPayloadType() const		{ return defaultRTXPayloadType;				}
+	bool HasRTX() const				{ return defaultRTXPayloadType!=RTPMap::NotFound;	}
+	bool HasExtension(RTPHeaderExtension::Type type) const { return extIds.HasId(type);			}
+	const RTPHeaderExtension::IdMap& GetExtensionIds() const { return extIds;				}
+private:
+	std::array<BYTE,256> payloadTypes;
+	std::array<BYTE,256> rtxPayloadTypes;
+	BYTE defaultRTXPayloadType = RTPMap::NotFound;
+	RTPHeaderExtension::IdMap extIds;
+};
+
+#endif /* RTPSENDPROFILE_H */
@@ -37,6 +37,7 @@ public:
 	
 	// RTPIncomingMediaStream::Listener interface
 	virtual void onRTP(const RTPIncomingMediaStream* stream, const RTPPacket::shared& packet) override;
+	virtual void onRTP(const RTPIncomingMediaStream* stream, const std::vector<RTPPacket::shared>& packets) override;
 	virtual void onBye(const RTPIncomingMediaStream* stream) override;
 	virtual void onEnded(const RTPIncomingMediaStream* stream) override;
 
@@ -54,6 +55,8 @@ public:
 
 protected:
 	void RequestPLI();
+	//Rewrite packet for the outgoing stream, adding it and any generated one to the forwarded ones
+	void Forward(const RTPIncomingMediaStream* stream, const RTPPacket::shared& packet, std::vector<RTPPacket::shared>& forwarded);
 
 private:
 	TimeService& timeService;
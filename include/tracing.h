@@ -54,6 +54,7 @@ PERFETTO_DEFINE_CATEGORIES(
 #define TRACE_EVENT(...)
 #define TRACE_EVENT_BEGIN(...)
 #define TRACE_EVENT_END(...)
+#define TRACE_COUNTER(...)
 #define TRACE_EVENT_CATEGORY_ENABLED(...)
 
 #endif /* MEDOOZE_TRACING */
@@ -8,8 +8,11 @@
 #include "mosaic.h"
 #include "logo.h"
 #include "EventSource.h"
+#include "WorkerPool.h"
+#include "ScaledFrameCache.h"
 #include <list>
 #include <map>
+#include <memory>
 
 class VideoMixer 
 {
@@ -47,6 +50,10 @@ public:
 	int AddMosaicParticipant(int mosaicId,int partId);
 	int RemoveMosaicParticipant(int mosaicId,int partId);
 	int GetMosaicPositions(int mosaicId,std::list<int> &positions);
+	int GetMosaicStats(int mosaicId,Mosaic::Stats &stats);
+	//Inputs fed with the mosaic frames, not bound to any participant and not owned by the mixer
+	int AddMosaicInput(int mosaicId,PipeVideoInput* input);
+	int RemoveMosaicInput(int mosaicId,PipeVideoInput* input);
 	int SetSlot(int mosaicId,int num,int id);
 	int ResetSlots(int mosaicId);
 	int SetCompositionType(int mosaicId,Mosaic::Type comp,int size);
@@ -82,6 +89,8 @@ private:
 		Mosaic *mosaic;
 		std::wstring name;
 		bool refresh;
+		//Frames resized for the slots showing it, protected by output lock
+		ScaledFrameCache scaled;
 		
 		VideoSource(const std::wstring &name)
 		{
@@ -98,6 +107,7 @@ private:
 
 	typedef std::map<int,VideoSource *> Videos;
 	typedef std::map<int,Mosaic *> Mosaics;
+	typedef std::multimap<int,PipeVideoInput *> MosaicInputs;
 private:
 	static DWORD vadDefaultChangePeriod;
 private:
@@ -107,6 +117,7 @@ private:
 	Videos lstVideos;
 	//Mosaics
 	Mosaics mosaics;
+	MosaicInputs mosaicInputs;
 	int maxMosaics = MosaicDefault;
 
 	//Las propiedades del mosaico
@@ -128,6 +139,8 @@ private:
 	DWORD		version = 0;
 	Properties	overlay;
 	Properties	overlaySpeaking;
+	//Threads for updating mosaic slots in parallel
+	std::unique_ptr<WorkerPool> workers;
 };
 
 #endif
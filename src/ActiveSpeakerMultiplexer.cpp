@@ -156,7 +156,7 @@ void ActiveSpeakerMultiplexer::onRTP(const RTPIncomingMediaStream* incoming, con
 		//Exit
 		return;
 
-	timeService.Async([=, packet = packet](auto) {
+	timeService.Post([=, packet = packet](auto) {
 		//Double check we have audio level
 		if (!packet->HasAudioLevel())
 			return;
@@ -215,7 +215,7 @@ void ActiveSpeakerMultiplexer::onEnded(const RTPIncomingMediaStream* incoming)
 	if (!incoming)
 		return;
 
-	timeService.Async([=](auto) {
+	timeService.Post([=](auto) {
 
 		Debug("-ActiveSpeakerDetectorFacade::onEnded() async [incoming:%p]\n", incoming);
 
@@ -47,8 +47,10 @@ constexpr auto MaxRTXOverhead			= 0.50f;
 constexpr auto TransportWideCCMaxPackets	= 100;
 constexpr auto TransportWideCCMaxInterval	= 5E4;	//50ms
 constexpr auto MaxProbingHistorySize		= 50;
+constexpr auto MaxNACKFields			= 64;
+constexpr auto MaxEnqueuedBatch			= 64;
 
-DTLSICETransport::DTLSICETransport(Sender *sender,TimeService& timeService, ObjectPool<Packet>& packetPool) :
+DTLSICETransport::DTLSICETransport(Sender *sender,TimeService& timeService, PacketPool& packetPool) :
 	sender(sender),
 	timeService(timeService),
 	packetPool(packetPool),
@@ -142,11 +144,11 @@ int DTLSICETransport::onData(const ICERemoteCandidate* candidate,const BYTE* dat
 			//Write udp packet
 			dumper->WriteUDP(now/1000,candidate->GetIPAddress(),candidate->GetPort(),0x7F000001,5004,data,len);
 
-		//Parse it
-		auto rtcp = RTCPCompoundPacket::Parse(data,len);
+		//Get view of it
+		RTCPCompoundView rtcp(data,len);
 
 		//Check packet
-		if (!rtcp)
+		if (!rtcp.IsValid())
 		{
 			//Debug
 			Debug("-DTLSICETransport::onData() | RTCP wrong data\n");
@@ -207,32 +209,34 @@ int DTLSICETransport::onData(const ICERemoteCandidate* candidate,const BYTE* dat
 		// Get current seq mum
 		WORD transportSeqNum = packet->GetTransportSeqNum();
 
-		//Get max seq num so far, it is either last one if queue is empy or last one of the queue
-		DWORD maxFeedbackPacketExtSeqNum = transportWideReceivedPacketsStats.size() ? transportWideReceivedPacketsStats.rbegin()->first : lastFeedbackPacketExtSeqNum;
-
-		//Check if we have a sequence wrap
-		if (transportSeqNum < 0x00FF && (maxFeedbackPacketExtSeqNum & 0xFFFF)>0xFF00)
+		//Store receive time, the ring takes care of the sequence wrapping, drop it if it is too old
+		if (transportWideReceivedPacketsStats.Set(transportSeqNum, now))
 		{
-			//Increase cycles
-			feedbackCycles++;
-			//If looping
-			if (feedbackCycles)
-				//Send feedback now
-				SendTransportWideFeedbackMessage(ssrc);
+			//Get extended value
+			QWORD transportExtSeqNum = transportWideReceivedPacketsStats.GetLastExtSeq() - (WORD)(transportWideReceivedPacketsStats.GetLastSeq() - transportSeqNum);
+			//Skip it if it has been already reported as lost
+			if (!lastFeedbackPacketExtSeqNum || transportExtSeqNum>lastFeedbackPacketExtSeqNum)
+			{
+				//If it is the first one pending
+				if (!transportWidePendingPackets++)
+				{
+					//Store it
+					transportWideFirstPendingExtSeqNum = transportExtSeqNum;
+					transportWideFirstPendingTime = now;
+				//If it is out of order
+				} else if (transportExtSeqNum<transportWideFirstPendingExtSeqNum) {
+					//Report from this one
+					transportWideFirstPendingExtSeqNum = transportExtSeqNum;
+				}
+			}
 		}
 
-		//Get extended value
-		DWORD transportExtSeqNum = feedbackCycles << 16 | transportSeqNum;
-
-		//Add packets to the transport wide stats
-		transportWideReceivedPacketsStats[transportExtSeqNum] = PacketStats::Create(packet, size, now);
-
 		//If we have enought or timeout 
-		if (packet->GetMark() || transportWideReceivedPacketsStats.size() > TransportWideCCMaxPackets || (now - transportWideReceivedPacketsStats.begin()->second->time) > TransportWideCCMaxInterval)
+		if (transportWidePendingPackets && (packet->GetMark() || transportWidePendingPackets > TransportWideCCMaxPackets || (now - transportWideFirstPendingTime) > TransportWideCCMaxInterval))
 			//Send feedback message
 			SendTransportWideFeedbackMessage(ssrc);
 		//Schedule for later
-		if (transportWideReceivedPacketsStats.size())
+		if (transportWidePendingPackets)
 		{
 			//If timer is still valid and has not been scheduled already
 			if (sseTimer && !sseTimer->IsScheduled())
@@ -460,25 +464,27 @@ int DTLSICETransport::onData(const ICERemoteCandidate* candidate,const BYTE* dat
 		//Increase rejected counter
 		source->dropPackets++;
 	
+	//Lost packets that have not been nacked or were nacked more than an rtt ago
+	RTCPRTPFeedback::NACKField fields[MaxNACKFields];
+	DWORD num = 0;
+	
 	//Send nack feedback
 	if ( group->type == MediaFrame::Video && 
-		( lost>0 ||  (group->GetCurrentLost() && (now-source->lastNACKed)/1000>fmax(rtt,20)))
+		( lost>0 || group->GetCurrentLost()) &&
+		( num = group->GetNacks(fields,MaxNACKFields,now/1000,rtt))
 	   )
 	{
 		//UltraDebug("-DTLSICETransport::onData() | Lost packets [ssrc:%u,ssrc:%u,seq:%d,lost:%d,total:%u]\n",ssrc,packet->GetSSRC(),packet->GetSeqNum(),lost,group->GetCurrentLost());
 
-		//Create rtcp sender retpor
-		auto rtcp = RTCPCompoundPacket::Create();
-
-		//Create NACK
-		auto nack = rtcp->CreatePacket<RTCPRTPFeedback>(RTCPRTPFeedback::NACK,mainSSRC,packet->GetSSRC());
-
-		//Get nacks for lost
-		for (auto field : group->GetNacks())
-			//Add it
-			nack->AddField(field);
+		//Pick one packet buffer from the pool
+		Packet buffer = packetPool.pick();
+		
+		//Write NACK directly on it
+		RTCPCompoundBuilder rtcp(buffer.GetData(),buffer.GetCapacity()-SRTP_MAX_TRAILER_LEN);
+		rtcp.AddNACK(mainSSRC,packet->GetSSRC(),fields,num);
+		
 		//Send packet
-		Send(rtcp);
+		SendRTCP(std::move(buffer),rtcp.GetSize());
 
 		//Update last time nacked
 		source->lastNACKed = now;
@@ -594,7 +600,7 @@ DWORD DTLSICETransport::SendProbe(const RTPPacket::shared& original)
 	auto packet = original->Clone();
 
 	//Try to send it via rtx
-	BYTE apt = sendMaps.apt.GetTypeForCodec(packet->GetPayloadType());
+	BYTE apt = sendProfile.GetRTXPayloadType(packet->GetPayloadType());
 		
 	//Check if we ar using rtx or not
 	if (!group->rtx.ssrc || apt==RTPMap::NotFound)
@@ -611,7 +617,7 @@ DWORD DTLSICETransport::SendProbe(const RTPPacket::shared& original)
 	packet->SetPadding(0);
 	
 	//Add transport wide cc on video
-	if (group->type == MediaFrame::Video && sendMaps.ext.GetTypeForCodec(RTPHeaderExtension::TransportWideCC)!=RTPMap::NotFound)
+	if (group->type == MediaFrame::Video && sendProfile.HasExtension(RTPHeaderExtension::TransportWideCC))
 		//Set transport wide seq num
 		packet->SetTransportSeqNum(++transportSeqNum);
 	else
@@ -619,7 +625,7 @@ DWORD DTLSICETransport::SendProbe(const RTPPacket::shared& original)
 		packet->DisableTransportSeqNum();
 	
 	//If we are using abs send time for sending
-	if (sendMaps.ext.GetTypeForCodec(RTPHeaderExtension::AbsoluteSendTime)!=RTPMap::NotFound)
+	if (sendProfile.HasExtension(RTPHeaderExtension::AbsoluteSendTime))
 		//Set abs send time
 		packet->SetAbsSentTime(now/1000);
 	else
@@ -647,7 +653,7 @@ DWORD DTLSICETransport::SendProbe(const RTPPacket::shared& original)
 	DWORD	size = buffer.GetCapacity();
 	
 	//Serialize data
-	int len = packet->Serialize(data,size,sendMaps.ext);
+	int len = packet->Serialize(data,size,sendProfile.GetExtensionIds());
 	
 	//IF failed
 	if (!len)
@@ -723,6 +729,8 @@ DWORD DTLSICETransport::SendProbe(const RTPPacket::shared& original)
 	now = getTime();
 	//Update bitrate
 	outgoingBitrate.Update(now/1000,len);
+	//Consume pacing budget
+	pacer.OnSent(now,len);
 		
 	//Update last send time and stats
 	source.Update(now/1000, packet, len);
@@ -744,7 +752,7 @@ DWORD DTLSICETransport::SendProbe(RTPOutgoingSourceGroup *group,BYTE padding)
 	RTPHeaderExtension	extension;
 	
 	//Check if we ar using rtx or not
-	bool rtx = group->rtx.ssrc && !sendMaps.apt.empty();
+	bool rtx = group->rtx.ssrc && sendProfile.HasRTX();
 		
 	//Check which source are we using
 	RTPOutgoingSource& source = rtx ? group->rtx : group->media;
@@ -757,7 +765,7 @@ DWORD DTLSICETransport::SendProbe(RTPOutgoingSourceGroup *group,BYTE padding)
 	{
 		//Update RTX headers
 		header.ssrc		= source.ssrc;
-		header.payloadType	= sendMaps.apt.begin()->first;
+		header.payloadType	= sendProfile.GetDefaultRTXPayloadType();
 		header.sequenceNumber	= extSeqNum = source.NextSeqNum();
 		header.timestamp	= source.lastTimestamp++;
 		//Padding
@@ -776,7 +784,7 @@ DWORD DTLSICETransport::SendProbe(RTPOutgoingSourceGroup *group,BYTE padding)
 	auto now = getTime();
 
 	//Add transport wide cc on video
-	if (group->type == MediaFrame::Video && sendMaps.ext.GetTypeForCodec(RTPHeaderExtension::TransportWideCC)!=RTPMap::NotFound)
+	if (group->type == MediaFrame::Video && sendProfile.HasExtension(RTPHeaderExtension::TransportWideCC))
 	{
 		//Add extension
 		header.extension = true;
@@ -786,7 +794,7 @@ DWORD DTLSICETransport::SendProbe(RTPOutgoingSourceGroup *group,BYTE padding)
 	}
 	
 	//If we are using abs send time for sending
-	if (sendMaps.ext.GetTypeForCodec(RTPHeaderExtension::AbsoluteSendTime)!=RTPMap::NotFound)
+	if (sendProfile.HasExtension(RTPHeaderExtension::AbsoluteSendTime))
 	{
 		//Use extension
 		header.extension = true;
@@ -820,7 +828,7 @@ DWORD DTLSICETransport::SendProbe(RTPOutgoingSourceGroup *group,BYTE padding)
 	if (header.extension)
 	{
 		//Serialize
-		n = extension.Serialize(sendMaps.ext,data+len,size-len);
+		n = extension.Serialize(sendProfile.GetExtensionIds(),data+len,size-len);
 		//Comprobamos que quepan
 		if (!n)
 		{
@@ -911,6 +919,8 @@ DWORD DTLSICETransport::SendProbe(RTPOutgoingSourceGroup *group,BYTE padding)
 	now = getTime();
 	//Update bitrate
 	outgoingBitrate.Update(now/1000,len);
+	//Consume pacing budget
+	pacer.OnSent(now,len);
 	
 	//Update last send time and stats
 	source.Update(now/1000, header, len);
@@ -935,7 +945,7 @@ void DTLSICETransport::ReSendPacket(RTPOutgoingSourceGroup *group,WORD seq)
 	UltraDebug("-DTLSICETransport::ReSendPacket() | resending [seq:%d,ssrc:%u,rtx:%u,instant:%llu, isWindow:%d, count:%d, empty:%d]\n", seq, group->media.ssrc, group->rtx.ssrc, instant, rtxBitrate.IsInWindow(), rtxBitrate.GetCount(), rtxBitrate.IsEmpty());
 
 	//if sse is enabled
-	if (senderSideEstimationEnabled && sendMaps.ext.GetTypeForCodec(RTPHeaderExtension::TransportWideCC) != RTPMap::NotFound)
+	if (senderSideEstimationEnabled && sendProfile.HasExtension(RTPHeaderExtension::TransportWideCC))
 	{
 		//Get target bitrate
 		DWORD targetBitrate = senderSideBandwidthEstimator->GetTargetBitrate();
@@ -947,18 +957,37 @@ void DTLSICETransport::ReSendPacket(RTPOutgoingSourceGroup *group,WORD seq)
 	}
 	
 	//Find packet to retransmit
-	auto original = group->GetPacket(seq);
+	auto original = group->GetPacket(seq,now/1000);
 
 	//If we don't have it anymore
 	if (!original)
 		//Debug
-		return (void)UltraDebug("-DTLSICETransport::ReSendPacket() | packet not found[seq:%d,ssrc:&%u,rtx:%u]\n",seq,group->media.ssrc,group->rtx.ssrc);
+		return (void)UltraDebug("-DTLSICETransport::ReSendPacket() | packet not found[seq:%d,ssrc:&%u,rtx:%u,hits:%llu,misses:%llu,evicted:%llu]\n",seq,group->media.ssrc,group->rtx.ssrc,group->GetRTXHistory().GetHits(),group->GetRTXHistory().GetMisses(),group->GetRTXHistory().GetEvicted());
+	
+	//If we are pacing
+	if (IsPacing())
+	{
+		//Queue it before video
+		pacer.Enqueue(Pacer::Retransmission,original,now);
+		//Send what we can now
+		Pace(now);
+		return;
+	}
+	
+	//Send it now
+	ReSendPacketNow(group,original);
+}
+
+void DTLSICETransport::ReSendPacketNow(RTPOutgoingSourceGroup *group,const RTPPacket::shared& original)
+{
+	//Get current time
+	auto now = getTime();
 	
 	//Create resend packet
 	auto packet = original->Clone();
 	
 	//Try to send it via rtx
-	BYTE apt = sendMaps.apt.GetTypeForCodec(packet->GetPayloadType());
+	BYTE apt = sendProfile.GetRTXPayloadType(packet->GetPayloadType());
 		
 	//Check if we ar using rtx or not
 	bool rtx = group->rtx.ssrc && apt!=RTPMap::NotFound;
@@ -978,7 +1007,7 @@ void DTLSICETransport::ReSendPacket(RTPOutgoingSourceGroup *group,WORD seq)
 	}
 	
 	//Add transport wide cc on video
-	if (group->type == MediaFrame::Video && sendMaps.ext.GetTypeForCodec(RTPHeaderExtension::TransportWideCC)!=RTPMap::NotFound)
+	if (group->type == MediaFrame::Video && sendProfile.HasExtension(RTPHeaderExtension::TransportWideCC))
 		//Set transport wide seq num
 		packet->SetTransportSeqNum(++transportSeqNum);
 	else
@@ -986,7 +1015,7 @@ void DTLSICETransport::ReSendPacket(RTPOutgoingSourceGroup *group,WORD seq)
 		packet->DisableTransportSeqNum();
 	
 	//If we are using abs send time for sending
-	if (sendMaps.ext.GetTypeForCodec(RTPHeaderExtension::AbsoluteSendTime)!=RTPMap::NotFound)
+	if (sendProfile.HasExtension(RTPHeaderExtension::AbsoluteSendTime))
 		//Set abs send time
 		packet->SetAbsSentTime(now/1000);
 	else
@@ -1014,7 +1043,7 @@ void DTLSICETransport::ReSendPacket(RTPOutgoingSourceGroup *group,WORD seq)
 	DWORD	size = buffer.GetCapacity();
 	
 	//Serialize data
-	int len = packet->Serialize(data,size,sendMaps.ext);
+	int len = packet->Serialize(data,size,sendProfile.GetExtensionIds());
 	
 	//IF failed
 	if (!len)
@@ -1090,6 +1119,8 @@ void DTLSICETransport::ReSendPacket(RTPOutgoingSourceGroup *group,WORD seq)
 	//Update bitrate
 	outgoingBitrate.Update(now/1000,len);
 	rtxBitrate.Update(now/1000,len);
+	//Consume pacing budget
+	pacer.OnSent(now,len);
 	
 	//Update stats
 	source.Update(now/1000, packet, len);
@@ -1218,6 +1249,8 @@ void DTLSICETransport::SetLocalProperties(const Properties& properties)
 	//Clear extension
 	extensions.clear();
 
+	//Compile them for sending
+	sendProfile.Compile(sendMaps.rtp,sendMaps.ext,sendMaps.apt);
 }
 
 void DTLSICETransport::SetSRTPProtectionProfiles(const std::string& profiles)
@@ -1713,9 +1746,9 @@ bool DTLSICETransport::RemoveOutgoingSourceGroup(RTPOutgoingSourceGroup *group)
 		Send(RTCPCompoundPacket::Create(RTCPBye::Create(ssrcs,"terminated")));
 
 		//If last one
-		if (outgoing.size()==0 && probingTimer)
-			//Stop probing timer
-			probingTimer->Cancel();
+		if (outgoing.size()==0)
+			//Stop probing
+			CheckProbeTimer();
 	});
 	
 	//Done
@@ -1725,7 +1758,7 @@ bool DTLSICETransport::RemoveOutgoingSourceGroup(RTPOutgoingSourceGroup *group)
 bool DTLSICETransport::AddIncomingSourceGroup(RTPIncomingSourceGroup *group)
 {
 	//RTX should only be enabled for video and if RTX codec has been negotiated
-	bool isRTXEnabled = group->type == MediaFrame::Video && sendMaps.rtp.HasCodec(VideoCodec::RTX);
+	bool isRTXEnabled = group->type == MediaFrame::Video && sendProfile.HasCodec(VideoCodec::RTX);
 
 	//Log
 	Log("-DTLSICETransport::AddIncomingSourceGroup() [mid:'%s',rid:'%s',ssrc:%u,rtx:%u,isRTXEnabled:%d,disableREMB:%d]\n",group->mid.c_str(),group->rid.c_str(),group->media.ssrc,group->rtx.ssrc,isRTXEnabled, disableREMB);
@@ -1798,7 +1831,7 @@ bool DTLSICETransport::AddIncomingSourceGroup(RTPIncomingSourceGroup *group)
 		return Warning("-DTLSICETransport::AddIncomingSourceGroup() Could not add incoming source\n");
 		
 	//If it is video and the transport wide cc is not enabled enable and not overriding the bitrate estimation
-	bool remb = group->type == MediaFrame::Video && sendMaps.ext.GetTypeForCodec(RTPHeaderExtension::TransportWideCC)==RTPMap::NotFound && !overrideBWE && !disableREMB;
+	bool remb = group->type == MediaFrame::Video && !sendProfile.HasExtension(RTPHeaderExtension::TransportWideCC) && !overrideBWE && !disableREMB;
 
 	//Start distpaching
 	group->Start(remb);
@@ -1875,8 +1908,8 @@ int DTLSICETransport::Send(const RTCPCompoundPacket::shared &rtcp)
 		//Log 
 		return Debug("-DTLSICETransport::Send() | We don't have an DTLS setup yet\n");
 	
-	//Pick one packet buffer from the pool
-	Packet buffer = packetPool.pick();
+	//Pick one packet buffer from the pool big enough for the compound and the srtcp trailer
+	Packet buffer = packetPool.pick(rtcp->GetSize() + SRTP_MAX_TRAILER_LEN);
 	BYTE* 	data = buffer.GetData();
 	DWORD	size = buffer.GetCapacity();
 	
@@ -1894,13 +1927,42 @@ int DTLSICETransport::Send(const RTCPCompoundPacket::shared &rtcp)
 		return Error("-DTLSICETransport::Send() | Error serializing RTCP packet [len:%d,size:%d]\n",len,size);
 	}
 	
+	//Send it
+	return SendRTCP(std::move(buffer),len);
+}
+
+int DTLSICETransport::SendRTCP(Packet&& buffer,DWORD len)
+{
+	TRACE_EVENT("rtp","DTLSICETransport::SendRTCP");
+	
+	//Check we have something to send
+	if (!len)
+	{
+		//Return packet to pool
+		packetPool.release(std::move(buffer));
+		//Error
+		return Error("-DTLSICETransport::SendRTCP() | Empty RTCP packet\n");
+	}
+	
+	//Check if we have an active DTLS connection yet
+	if (!send.IsSetup())
+	{
+		//Return packet to pool
+		packetPool.release(std::move(buffer));
+		//Log 
+		return Debug("-DTLSICETransport::SendRTCP() | We don't have an DTLS setup yet\n");
+	}
+	
+	//Get data
+	BYTE* data = buffer.GetData();
+	
 	//If we don't have an active candidate yet
 	if (!active)
 	{
 		//Return packet to pool
 		packetPool.release(std::move(buffer));
 		//Log
-		return Debug("-DTLSICETransport::Send() | We don't have an active candidate yet\n");
+		return Debug("-DTLSICETransport::SendRTCP() | We don't have an active candidate yet\n");
 	}
 
 	//Get current time
@@ -1920,7 +1982,7 @@ int DTLSICETransport::Send(const RTCPCompoundPacket::shared &rtcp)
 		//Return packet to pool
 		packetPool.release(std::move(buffer));
 		//Error
-		return Error("-DTLSICETransport::Send() | Error protecting RTCP packet [%s]\n",send.GetLastError());
+		return Error("-DTLSICETransport::SendRTCP() | Error protecting RTCP packet [%s]\n",send.GetLastError());
 	}
 
 	//Store active candidate1889
@@ -1944,7 +2006,7 @@ int DTLSICETransport::SendPLI(DWORD ssrc)
 	Debug("-DTLSICETransport::SendPLI() | [ssrc:%u]\n",ssrc);
 	
 	//Execute on the event loop thread and do not wait
-	timeService.Async([=](auto now){
+	timeService.Post([=](auto now){
 		//Get group
 		RTPIncomingSourceGroup *group = GetIncomingSourceGroup(ssrc);
 
@@ -1962,14 +2024,15 @@ int DTLSICETransport::SendPLI(DWORD ssrc)
 		//And number of requested plis
 		group->media.totalPLIs++;
 
-		//Create rtcp sender retpor
-		auto rtcp = RTCPCompoundPacket::Create();
+		//Pick one packet buffer from the pool
+		Packet buffer = packetPool.pick();
 
-		//Add to rtcp
-		rtcp->CreatePacket<RTCPPayloadFeedback>(RTCPPayloadFeedback::PictureLossIndication,mainSSRC,ssrc);
+		//Write PLI directly on it
+		RTCPCompoundBuilder rtcp(buffer.GetData(),buffer.GetCapacity()-SRTP_MAX_TRAILER_LEN);
+		rtcp.AddPLI(mainSSRC,ssrc);
 
 		//Send packet
-		Send(rtcp);
+		SendRTCP(std::move(buffer),rtcp.GetSize());
 	});
 	
 	return 1;
@@ -1981,7 +2044,7 @@ int DTLSICETransport::Reset(DWORD ssrc)
 	Debug("-DTLSICETransport::Reset() | [ssrc:%u]\n", ssrc);
 
 	//Execute on the event loop thread and do not wait
-	timeService.Async([=](auto now) {
+	timeService.Post([=](auto now) {
 		//Get group
 		RTPIncomingSourceGroup* group = GetIncomingSourceGroup(ssrc);
 
@@ -2021,6 +2084,94 @@ int DTLSICETransport::Send(RTPPacket::shared&& packet)
 		//Error
 		return Error("-DTLSICETransport::Send() | Error null packet\n");
 	
+	//If not pacing
+	if (!IsPacing())
+		//Send it now
+		return SendNow(std::move(packet));
+	
+	//Get outgoing group
+	RTPOutgoingSourceGroup* group = GetOutgoingSourceGroup(packet->GetSSRC());
+	
+	//If not found
+	if (!group)
+		//Error
+		return Warning("-DTLSICETransport::Send() | Outgoind source not registered for ssrc:%u\n",packet->GetSSRC());
+	
+	//Get time
+	auto now = getTime();
+	
+	//Queue it
+	pacer.Enqueue(group->type==MediaFrame::Audio ? Pacer::Audio : Pacer::Video,packet,now);
+	
+	//Send what we can now
+	Pace(now);
+	
+	return 1;
+}
+
+bool DTLSICETransport::IsPacing()
+{
+	//Pace to the target bitrate if we are using transport wide cc
+	if (senderSideEstimationEnabled && sendProfile.HasExtension(RTPHeaderExtension::TransportWideCC))
+		pacer.SetBitrate(senderSideBandwidthEstimator->GetTargetBitrate());
+	else
+		pacer.SetBitrate(0);
+	
+	//Keep pacing while there are packets queued so they are not reordered
+	return pacerTimer && (pacer.IsEnabled() || !pacer.IsEmpty());
+}
+
+void DTLSICETransport::Pace(QWORD now)
+{
+	TRACE_EVENT("transport", "DTLSICETransport::Pace", "queued", pacer.GetQueuedPackets());
+	
+	Pacer::Class type;
+	
+	//Send all packets allowed by the budget
+	while (auto packet = pacer.Dequeue(now,type))
+	{
+		//Check if it is a retransmission
+		if (type==Pacer::Retransmission)
+		{
+			//Get group
+			RTPOutgoingSourceGroup* group = GetOutgoingSourceGroup(packet->GetSSRC());
+			//If still there
+			if (group)
+				//Resend it
+				ReSendPacketNow(group,packet);
+		} else {
+			//Send it
+			SendNow(std::move(packet));
+		}
+		//Update time
+		now = getTime();
+	}
+	
+	//If there is nothing queued, fill the gap with probing padding
+	if (probingActive && pacer.IsEmpty() && now/1000>=lastProbe+ProbingInterval.count())
+		//Do probe
+		Probe(now/1000);
+	
+	//If already stopped
+	if (!pacerTimer)
+		//Done
+		return;
+	
+	//Get time until next packet can be sent
+	QWORD wait = pacer.GetWaitTime(now);
+	
+	//If we have packets queued
+	if (wait!=(QWORD)-1)
+		//Wake up when we can send them
+		pacerTimer->Again(std::chrono::microseconds(wait));
+	//If we have to keep probing
+	else if (probingActive && !pacerTimer->IsScheduled())
+		//Wait for next probe
+		pacerTimer->Again(ProbingInterval);
+}
+
+int DTLSICETransport::SendNow(RTPPacket::shared&& packet)
+{
 	//Check if we have an active DTLS connection yet
 	if (!send.IsSetup())
 		//Error
@@ -2049,12 +2200,12 @@ int DTLSICETransport::Send(RTPPacket::shared&& packet)
         packet->SetExtSeqNum(source.CorrectExtSeqNum(packet->GetExtSeqNum()));
         packet->SetSSRC(source.ssrc);
         
-	packet->SetPayloadType(sendMaps.rtp.GetTypeForCodec(packet->GetCodec()));
+	packet->SetPayloadType(sendProfile.GetPayloadType(packet->GetCodec()));
 	//No padding
 	packet->SetPadding(0);
 
 	//Add transport wide cc on video
-	if (group->type == MediaFrame::Video && sendMaps.ext.GetTypeForCodec(RTPHeaderExtension::TransportWideCC)!=RTPMap::NotFound)
+	if (group->type == MediaFrame::Video && sendProfile.HasExtension(RTPHeaderExtension::TransportWideCC))
 		//Set transport wide seq num
 		packet->SetTransportSeqNum(++transportSeqNum);
 	else
@@ -2065,7 +2216,7 @@ int DTLSICETransport::Send(RTPPacket::shared&& packet)
 	auto now = getTime();
 	
 	//If we are using abs send time for sending
-	if (sendMaps.ext.GetTypeForCodec(RTPHeaderExtension::AbsoluteSendTime)!=RTPMap::NotFound)
+	if (sendProfile.HasExtension(RTPHeaderExtension::AbsoluteSendTime))
 		//Set abs send time
 		packet->SetAbsSentTime(now/1000);
 	else
@@ -2095,7 +2246,7 @@ int DTLSICETransport::Send(RTPPacket::shared&& packet)
 	DWORD	size = buffer.GetCapacity();
 	
 	//Serialize data
-	int len = packet->Serialize(data,size,sendMaps.ext);
+	int len = packet->Serialize(data,size,sendProfile.GetExtensionIds());
 	
 	//IF failed
 	if (!len)
@@ -2107,7 +2258,7 @@ int DTLSICETransport::Send(RTPPacket::shared&& packet)
 	}
 
 	//Add packet for RTX
-	group->AddPacket(packet);
+	group->AddPacket(packet,data,len,now/1000);
 	
 	//If we don't have an active candidate yet
 	if (!active)
@@ -2172,6 +2323,8 @@ int DTLSICETransport::Send(RTPPacket::shared&& packet)
 	now = getTime();
 	//Update bitrate
 	outgoingBitrate.Update(now/1000,len);
+	//Consume pacing budget
+	pacer.OnSent(now,len);
 	
 	DWORD bitrate   = 0;
 	DWORD estimated = 0;
@@ -2191,7 +2344,7 @@ int DTLSICETransport::Send(RTPPacket::shared&& packet)
 		Send(RTCPCompoundPacket::Create(group->media.CreateSenderReport(now)));
 	
 	//Check if this packets support rtx
-	bool rtx = group->rtx.ssrc && sendMaps.apt.GetTypeForCodec(packet->GetPayloadType())!=RTPMap::NotFound;
+	bool rtx = group->rtx.ssrc && sendProfile.GetRTXPayloadType(packet->GetPayloadType())!=RTPMap::NotFound;
 	
 	//Do we need to send probing as inline media?
 	if (!rtx && probe && group->type == MediaFrame::Video && packet->GetMark() && estimated>bitrate && probing<maxProbingBitrate)
@@ -2226,30 +2379,35 @@ int DTLSICETransport::Send(RTPPacket::shared&& packet)
 	return (len>=0);
 }
 
-void DTLSICETransport::onRTCP(const RTCPCompoundPacket::shared& rtcp)
+void DTLSICETransport::onRTCP(const RTCPCompoundView& rtcp)
 {
-	TRACE_EVENT("rtp", "DTLSICETransport::onRTCP", "size", rtcp->GetSize());
+	TRACE_EVENT("rtp", "DTLSICETransport::onRTCP", "size", rtcp.GetSize());
 
 	//Get current time
 	uint64_t now = getTime();
 	
 	//For each packet
-	for (DWORD i = 0; i<rtcp->GetPacketCount();i++)
+	for (const auto& packet : rtcp)
 	{
-		//Get pacekt
-		auto packet = rtcp->GetPacket(i);
 		//Check packet type
-		switch (packet->GetType())
+		switch (packet.GetType())
 		{
 			case RTCPPacket::SenderReport:
 			{
 				//Get sender report
-				auto sr = std::static_pointer_cast<RTCPSenderReport>(packet);
+				RTCPSenderReportView sr(packet);
+				
+				//Check size
+				if (!sr.IsValid())
+				{
+					Warning("-DTLSICETransport::onRTCP() | Wrong RTCP SR size [size:%u,count:%u]\n",sr.GetSize(),sr.GetCount());
+					continue;
+				}
 				
 				//Get ssrc
-				DWORD ssrc = sr->GetSSRC();
+				DWORD ssrc = sr.GetSSRC();
 
-				TRACE_EVENT("rtp", "DTLSICETransport::onRTCP::SR", "size", sr->GetSize(), "ssrc", ssrc);
+				TRACE_EVENT("rtp", "DTLSICETransport::onRTCP::SR", "size", sr.GetSize(), "ssrc", ssrc);
 
 				//Get source
 				RTPIncomingSource* source = GetIncomingSource(ssrc);
@@ -2258,7 +2416,7 @@ void DTLSICETransport::onRTCP(const RTCPCompoundPacket::shared& rtcp)
 				if (!source)
 				{
 					Warning("-DTLSICETransport::onRTCP() | Could not find incoming source for RTCP SR [ssrc:%u]\n",ssrc);
-					rtcp->Dump();
+					rtcp.Dump();
 					continue;
 				}
 				
@@ -2266,12 +2424,12 @@ void DTLSICETransport::onRTCP(const RTCPCompoundPacket::shared& rtcp)
 				source->Process(now, sr);
 				
 				//Process all the Sender Reports
-				for (DWORD j=0;j<sr->GetCount();j++)
+				for (DWORD j=0;j<sr.GetCount();j++)
 				{
 					//Get report
-					auto report = sr->GetReport(j);
+					auto report = sr.GetReport(j);
 					//Check ssrc
-					DWORD ssrc = report->GetSSRC();
+					DWORD ssrc = report.GetSSRC();
 					
 					//Get group
 					RTPOutgoingSourceGroup* group = GetOutgoingSourceGroup(ssrc);
@@ -2280,18 +2438,13 @@ void DTLSICETransport::onRTCP(const RTCPCompoundPacket::shared& rtcp)
 					{
 						//Get media
 						RTPOutgoingSource* source = group->GetSource(ssrc);
-						//Check ssrc
+						//Check we have it
 						if (source)
 						{
-							RTPOutgoingSource* source = group->GetSource(ssrc);
-							//Check we have it
-							if (source)
-							{
-								//Process report
-								if (source->ProcessReceiverReport(now/1000, report))
-									//We need to update rtt
-									SetRTT(source->rtt, now);
-							}
+							//Process report
+							if (source->ProcessReceiverReport(now/1000, report))
+								//We need to update rtt
+								SetRTT(source->rtt, now);
 						}
 					}
 				}
@@ -2300,17 +2453,24 @@ void DTLSICETransport::onRTCP(const RTCPCompoundPacket::shared& rtcp)
 			case RTCPPacket::ReceiverReport:
 			{
 				//Get receiver report
-				auto rr = std::static_pointer_cast<RTCPReceiverReport>(packet);
+				RTCPReceiverReportView rr(packet);
+				
+				//Check size
+				if (!rr.IsValid())
+				{
+					Warning("-DTLSICETransport::onRTCP() | Wrong RTCP RR size [size:%u,count:%u]\n",rr.GetSize(),rr.GetCount());
+					continue;
+				}
 
-				TRACE_EVENT("rtp", "DTLSICETransport::onRTCP::RR", "size", rr->GetSize(), "count", rr->GetCount());
+				TRACE_EVENT("rtp", "DTLSICETransport::onRTCP::RR", "size", rr.GetSize(), "count", rr.GetCount());
 
 				//Process all the receiver Reports
-				for (DWORD j=0;j<rr->GetCount();j++)
+				for (DWORD j=0;j<rr.GetCount();j++)
 				{
 					//Get report
-					auto report = rr->GetReport(j);
+					auto report = rr.GetReport(j);
 					//Check ssrc
-					DWORD ssrc = report->GetSSRC();
+					DWORD ssrc = report.GetSSRC();
 					
 					//Get group
 					RTPOutgoingSourceGroup* group = GetOutgoingSourceGroup(ssrc);
@@ -2319,18 +2479,13 @@ void DTLSICETransport::onRTCP(const RTCPCompoundPacket::shared& rtcp)
 					{
 						//Get media
 						RTPOutgoingSource* source = group->GetSource(ssrc);
-						//Check ssrc
+						//Check we have it
 						if (source)
 						{
-							RTPOutgoingSource* source = group->GetSource(ssrc);
-							//Check we have it
-							if (source)
-							{
-								//Process report
-								if (source->ProcessReceiverReport(now/1000, report))
-									//We need to update rtt
-									SetRTT(source->rtt,now);
-							}
+							//Process report
+							if (source->ProcessReceiverReport(now/1000, report))
+								//We need to update rtt
+								SetRTT(source->rtt,now);
 						}
 					}
 				}
@@ -2343,10 +2498,18 @@ void DTLSICETransport::onRTCP(const RTCPCompoundPacket::shared& rtcp)
 			case RTCPPacket::Bye:
 			{
 				//Get bye
-				auto bye = std::static_pointer_cast<RTCPBye>(packet);
+				RTCPByeView bye(packet);
+				
+				//Check size
+				if (!bye.IsValid())
+					continue;
+				
 				//For each ssrc
-				for (auto& ssrc : bye->GetSSRCs())
+				for (BYTE j=0;j<bye.GetCount();j++)
 				{
+					//Get ssrc
+					DWORD ssrc = bye.GetSSRC(j);
+					
 					//Get media
 					RTPIncomingSourceGroup* group = GetIncomingSourceGroup(ssrc);
 
@@ -2365,14 +2528,19 @@ void DTLSICETransport::onRTCP(const RTCPCompoundPacket::shared& rtcp)
 			case RTCPPacket::RTPFeedback:
 			{
 				//Get feedback packet
-				auto fb = std::static_pointer_cast<RTCPRTPFeedback>(packet);
+				RTCPFeedbackView fb(packet);
+				
+				//Check size
+				if (!fb.IsValid())
+					continue;
+				
 				//Get SSRC for media
-				DWORD ssrc = fb->GetMediaSSRC();
+				DWORD ssrc = fb.GetMediaSSRC();
 
-				TRACE_EVENT("rtp", "DTLSICETransport::onRTCP::FB", "size", fb->GetSize(), "ssrc", ssrc);
+				TRACE_EVENT("rtp", "DTLSICETransport::onRTCP::FB", "size", fb.GetSize(), "ssrc", ssrc);
 
 				//Check feedback type
-				switch(fb->GetFeedbackType())
+				switch(fb.GetFeedbackType())
 				{
 					case RTCPRTPFeedback::NACK:
 					{
@@ -2382,25 +2550,25 @@ void DTLSICETransport::onRTCP(const RTCPCompoundPacket::shared& rtcp)
 						if (!group)
 						{
 							//Dump
-							fb->Dump();
+							fb.Dump();
 							//Debug
 							Warning("-DTLSICETransport::onRTCP() | Got NACK feedback message for unknown media  [ssrc:%u]\n", ssrc);
 							//Ups! Skip
 							break;
 						}
-						for (DWORD i = 0; i < fb->GetFieldCount(); i++)
+						for (DWORD i = 0; i < fb.GetNACKCount(); i++)
 						{
 							//Get field
-							auto field = fb->GetField<RTCPRTPFeedback::NACKField>(i);
+							auto field = fb.GetNACK(i);
 
 							//Resent it
-							ReSendPacket(group, field->pid);
+							ReSendPacket(group, field.pid);
 							//Check each bit of the mask
 							for (BYTE i = 0; i < 16; i++)
 								//Check it bit is present to rtx the packets
-								if ((field->blp >> i) & 1)
+								if ((field.blp >> i) & 1)
 									//Resent it
-									ReSendPacket(group, field->pid + i + 1);
+									ReSendPacket(group, field.pid + i + 1);
 						}
 						break;
 					}
@@ -2413,14 +2581,23 @@ void DTLSICETransport::onRTCP(const RTCPCompoundPacket::shared& rtcp)
 					case RTCPRTPFeedback::TransportWideFeedbackMessage:
 						//If sender side estimation is enabled
 						if (senderSideEstimationEnabled)
-							//Get each fiedl
-							for (DWORD i=0;i<fb->GetFieldCount();i++)
+						{
+							DWORD len = 0;
+							//Get each field
+							while (len<fb.GetFCISize())
 							{
-								//Get field
-								auto field = fb->GetField<RTCPRTPFeedback::TransportWideFeedbackMessageField>(i);
+								RTCPRTPFeedback::TransportWideFeedbackMessageField field;
+								//Parse it
+								DWORD parsed = field.Parse(fb.GetFCI()+len,fb.GetFCISize()-len);
+								//If not parsed
+								if (!parsed)
+									break;
 								//Pass it to the estimator
-								senderSideBandwidthEstimator->ReceivedFeedback(field->feedbackPacketCount,field->packets,now);
+								senderSideBandwidthEstimator->ReceivedFeedback(field.feedbackPacketCount,field.packets,now);
+								//Next
+								len += parsed;
 							}
+						}
 						break;
 				}
 				break;
@@ -2428,14 +2605,19 @@ void DTLSICETransport::onRTCP(const RTCPCompoundPacket::shared& rtcp)
 			case RTCPPacket::PayloadFeedback:
 			{
 				//Get feedback packet
-				auto fb = std::static_pointer_cast<RTCPPayloadFeedback>(packet);
+				RTCPFeedbackView fb(packet);
+				
+				//Check size
+				if (!fb.IsValid())
+					continue;
+				
 				//Get SSRC for media
-				DWORD ssrc = fb->GetMediaSSRC();
+				DWORD ssrc = fb.GetMediaSSRC();
 
-				TRACE_EVENT("rtp", "DTLSICETransport::onRTCP::PFB", "size", fb->GetSize(), "ssrc", ssrc);
+				TRACE_EVENT("rtp", "DTLSICETransport::onRTCP::PFB", "size", fb.GetSize(), "ssrc", ssrc);
 
 				//Check feedback type
-				switch(fb->GetFeedbackType())
+				switch(fb.GetFeedbackType())
 				{
 					case RTCPPayloadFeedback::PictureLossIndication:
 					case RTCPPayloadFeedback::FullIntraRequest:
@@ -2450,7 +2632,7 @@ void DTLSICETransport::onRTCP(const RTCPCompoundPacket::shared& rtcp)
 						if (!group)
 						{
 							//Dump
-							fb->Dump();
+							fb.Dump();
 							//Debug
 							Warning("-Got feedback message for unknown media  [ssrc:%u]\n",ssrc);
 							//Ups! Skip
@@ -2476,46 +2658,26 @@ void DTLSICETransport::onRTCP(const RTCPCompoundPacket::shared& rtcp)
 						Debug("-DTLSICETransport::onRTCP() | VideoBackChannelMessage\n");
 						break;
 					case RTCPPayloadFeedback::ApplicationLayerFeeedbackMessage:
-						//For all message fields
-						for (DWORD i=0;i<fb->GetFieldCount();i++)
+						//Check if it is a REMB
+						if (fb.IsREMB())
 						{
-							//Get feedback
-							auto msg = fb->GetField<RTCPPayloadFeedback::ApplicationLayerFeeedbackField>(i);
-							//Get size and payload
-							DWORD len		= msg->GetLength();
-							const BYTE* payload	= msg->GetPayload();
-							//Check if it is a REMB
-							if (len>8 && payload[0]=='R' && payload[1]=='E' && payload[2]=='M' && payload[3]=='B')
+							//Get bitrate
+							DWORD bitrate = fb.GetREMBBitrate();
+							//For each
+							for (BYTE i=0;i<fb.GetREMBSSRCCount();++i)
 							{
-								//Get SSRC count
-								BYTE num = payload[4];
-								//GEt exponent
-								BYTE exp = payload[5] >> 2;
-								DWORD mantisa = payload[5] & 0x03;
-								mantisa = mantisa << 8 | payload[6];
-								mantisa = mantisa << 8 | payload[7];
-								//Get bitrate
-								DWORD bitrate = mantisa << exp;
-								//For each
-								for (DWORD i=0;i<num;++i)
-								{
-									//Check length
-									if (len<8+4*i+4)
-										//wrong format
-										break;
-									//Get ssrc
-									DWORD target = get4(payload,8+4*i);
-									//Get media
-									RTPOutgoingSourceGroup* group = GetOutgoingSourceGroup(target);
-
-									//Debug
-									Debug("-DTLSICETransport::onRTCP() | REMB received [bitrate:%d,target:%u,group:%p,this:%p]\n", bitrate, target, group, this);
-									
-									//If found
-									if (group)
-										//Call listener
-										group->onREMB(target,bitrate);
-								}
+								//Get ssrc
+								DWORD target = fb.GetREMBSSRC(i);
+								//Get media
+								RTPOutgoingSourceGroup* group = GetOutgoingSourceGroup(target);
+
+								//Debug
+								Debug("-DTLSICETransport::onRTCP() | REMB received [bitrate:%d,target:%u,group:%p,this:%p]\n", bitrate, target, group, this);
+								
+								//If found
+								if (group)
+									//Call listener
+									group->onREMB(target,bitrate);
 							}
 						}
 						break;
@@ -2604,6 +2766,10 @@ void DTLSICETransport::SetRTT(DWORD rtt, QWORD now)
 	for (auto it : incoming)
 		//Update jitter
 		it.second->SetRTT(rtt,now/1000);
+	//Keep rtx history for a few rtts
+	for (auto it : outgoing)
+		//Update it
+		it.second->SetRTT(rtt);
 	//If sse is enabled
 	if (senderSideEstimationEnabled)
 		//Add estimation
@@ -2614,43 +2780,45 @@ void DTLSICETransport::SendTransportWideFeedbackMessage(DWORD ssrc)
 {
 	//Debug
 	//UltraDebug("-DTLSICETriansport::SendTransportWideFeedbackMessage() [ssrc:%d]\n", ssrc);
-	//RTCP packet
-	auto rtcp = RTCPCompoundPacket::Create();
-
-	//Create rtcp transport wide feedback
-	auto feedback = rtcp->CreatePacket<RTCPRTPFeedback>(RTCPRTPFeedback::TransportWideFeedbackMessage,mainSSRC,ssrc);
-
 	//Create trnasport field
-	auto field = feedback->CreateField<RTCPRTPFeedback::TransportWideFeedbackMessageField>(++feedbackPacketCount);
+	RTCPRTPFeedback::TransportWideFeedbackMessageField field(++feedbackPacketCount);
 
-	//Proccess and delete all elements
-	for (auto it =transportWideReceivedPacketsStats.cbegin();
-		  it!=transportWideReceivedPacketsStats.cend();
-		  it = transportWideReceivedPacketsStats.erase(it))
+	//If we have pending packets
+	if (transportWidePendingPackets)
 	{
-		//Get stat
-		auto stats = it->second;
-		//Get transport seq
-		DWORD transportExtSeqNum = it->first;
-		//Get relative time
-		QWORD time = stats->time - initTime;
-
-		//if not first and not out of order
-		if (lastFeedbackPacketExtSeqNum && transportExtSeqNum>lastFeedbackPacketExtSeqNum)
-			//For each lost
-			for (DWORD i = lastFeedbackPacketExtSeqNum+1; i<transportExtSeqNum; ++i)
-				//Add it
-				field->packets.insert(std::make_pair(i,0));
+		//Start after last reported one, packets arriving after being reported as lost are not reported again
+		QWORD first = lastFeedbackPacketExtSeqNum ? (QWORD)lastFeedbackPacketExtSeqNum + 1 : transportWideFirstPendingExtSeqNum;
+		QWORD last = transportWideReceivedPacketsStats.GetLastExtSeq();
+
+		//Older ones are not on the ring anymore
+		first = std::max(first, transportWideReceivedPacketsStats.GetFirstExtSeq());
+
+		//Proccess all of them
+		for (QWORD transportExtSeqNum = first; transportExtSeqNum<=last; ++transportExtSeqNum)
+		{
+			//Get receive time
+			auto received = transportWideReceivedPacketsStats.Get((WORD)transportExtSeqNum);
+			//Add it with relative time, or as lost
+			field.packets.emplace_hint(field.packets.end(), transportExtSeqNum, received ? *received - initTime : 0);
+		}
 
 		//Store last
-		lastFeedbackPacketExtSeqNum = transportExtSeqNum;
+		if (first<=last)
+			lastFeedbackPacketExtSeqNum = last;
 
-		//Add this one
-		field->packets.insert(std::make_pair(transportExtSeqNum,time));
+		//Nothing pending
+		transportWidePendingPackets = 0;
 	}
 
+	//Pick one packet buffer from the pool big enough for the feedback and the srtcp trailer
+	Packet buffer = packetPool.pick(12 + field.GetSize() + SRTP_MAX_TRAILER_LEN);
+
+	//Write rtcp transport wide feedback directly on it
+	RTCPCompoundBuilder rtcp(buffer.GetData(),buffer.GetCapacity()-SRTP_MAX_TRAILER_LEN);
+	rtcp.AddTransportWideFeedback(mainSSRC,ssrc,field);
+
 	//Send packet
-	Send(rtcp);
+	SendRTCP(std::move(buffer),rtcp.GetSize());
 }
 
 void DTLSICETransport::Start()
@@ -2674,13 +2842,13 @@ void DTLSICETransport::Start()
 	});
 	//Set name for debug
 	iceTimeoutTimer->SetName("DTLSICETransport - ice timeout");
-	//Create new probe timer
-	probingTimer = timeService.CreateTimer([this](std::chrono::milliseconds ms) {
-		//Do probe
-		Probe(ms.count());
+	//Create new pacer timer, which also sends the bwe probes
+	pacerTimer = timeService.CreateTimer([this](std::chrono::milliseconds ms) {
+		//Send queued packets and probes
+		Pace(getTime());
 		});
 	//Set name for debug
-	probingTimer->SetName("DTLSICETransport - bwe probe");
+	pacerTimer->SetName("DTLSICETransport - pacer");
 	//Create sse timer
 	sseTimer = timeService.CreateTimer([this](std::chrono::milliseconds ms) {
 		//Send feedback now
@@ -2703,14 +2871,17 @@ void DTLSICETransport::Stop()
 	TRACE_EVENT("transport", "DTLSICETransport::Stop");
 	Debug(">DTLSICETransport::Stop()\n");
 	
-	//Check probing timer
-	if (probingTimer)
+	//Check pacer timer
+	if (pacerTimer)
 	{
-		//Stop probing
-		probingTimer->Cancel();
+		//Stop pacing and probing
+		pacerTimer->Cancel();
 		//Remove timer
-		probingTimer.reset();
+		pacerTimer.reset();
 	}
+	
+	//Drop queued packets
+	pacer.Clear();
 
 	//Check sse timer
 	if (sseTimer)
@@ -2750,15 +2921,62 @@ int DTLSICETransport::Enqueue(const RTPPacket::shared& packet)
 		"ssrc", packet->GetSSRC(),
 		"seqNum", packet->GetSeqNum());
 
-	//Send async
-	timeService.Async([this,packet](auto now){
-		//Send
-		Send(packet->Clone());
-	});
+	//Clone it as caller keeps a reference
+	enqueued.enqueue(packet->Clone());
+	enqueuedPackets++;
+
+	//Send it on the loop
+	ScheduleEnqueued();
 	
 	return 1;
 }
 
+int DTLSICETransport::Enqueue(std::vector<RTPPacket::shared>&& packets)
+{
+	//Trace
+	TRACE_EVENT("rtp", "DTLSICETransport::Enqueue RTP batch",
+		"packets", packets.size());
+
+	//Check we have something
+	if (packets.empty())
+		return 0;
+
+	size_t num = packets.size();
+
+	//Add all of them at once, we own them so no need to clone
+	enqueued.enqueue_bulk(std::make_move_iterator(packets.begin()),num);
+	enqueuedPackets += num;
+	packets.clear();
+
+	//Send them on the loop
+	ScheduleEnqueued();
+
+	return num;
+}
+
+void DTLSICETransport::ScheduleEnqueued()
+{
+	//If there is already a wakeup pending it will send these too
+	if (enqueuedScheduled.exchange(true))
+		return;
+
+	//One more
+	enqueueWakeups++;
+
+	//Send async
+	timeService.Post([this](auto now){
+		//Allow new wakeups before dequeuing so packets enqueued meanwhile are not missed
+		enqueuedScheduled = false;
+
+		RTPPacket::shared packets[MaxEnqueuedBatch];
+		size_t num;
+		//Send all pending packets
+		while ((num = enqueued.try_dequeue_bulk(packets,MaxEnqueuedBatch)))
+			for (size_t i=0;i<num;++i)
+				Send(std::move(packets[i]));
+	});
+}
+
 int DTLSICETransport::Enqueue(const RTPPacket::shared& packet,std::function<RTPPacket::shared(const RTPPacket::shared&)> modifier)
 {
 	//Trace
@@ -2767,7 +2985,7 @@ int DTLSICETransport::Enqueue(const RTPPacket::shared& packet,std::function<RTPP
 		"seqNum", packet->GetSeqNum());
 
 	//Send async
-	timeService.Async([this,packet,modifier](auto now){
+	timeService.Post([this,packet,modifier](auto now){
 		//Send
 		Send(modifier(packet));
 	});
@@ -2780,13 +2998,13 @@ void DTLSICETransport::Probe(QWORD now)
 	TRACE_EVENT("transport", "DTLSICETransport::Probe", "now", now);
 
 	//Ensure that transport wide cc is enabled
-	if (senderSideEstimationEnabled && probe && sendMaps.ext.GetTypeForCodec(RTPHeaderExtension::TransportWideCC)!=RTPMap::NotFound)
+	if (senderSideEstimationEnabled && probe && sendProfile.HasExtension(RTPHeaderExtension::TransportWideCC))
 	{
 		//Update bitrates
 		outgoingBitrate.Update(now);
 		probingBitrate.Update(now);
 		//Calculate sleep time
-		uint64_t sleep = lastProbe ? std::min<uint64_t>(now - lastProbe, probingTimer->GetRepeat().count()) : probingTimer->GetRepeat().count();
+		uint64_t sleep = lastProbe ? std::min<uint64_t>(now - lastProbe, ProbingInterval.count()) : ProbingInterval.count();
 		
 		//Get bitrates
 		DWORD bitrate		= static_cast<DWORD>(outgoingBitrate.GetInstantAvg()*8);
@@ -2984,10 +3202,10 @@ void DTLSICETransport::EnableSenderSideEstimation(bool enabled)
 
 void DTLSICETransport::CheckProbeTimer()
 {
-	Debug("-DTLSICETransport::CheckProbeTimer() | [probingTimer:%d]\n",!!probingTimer);
+	Debug("-DTLSICETransport::CheckProbeTimer() | [pacerTimer:%d]\n",!!pacerTimer);
 
 	//If we don't have timer anumore
-	if (!probingTimer)
+	if (!pacerTimer)
 		//Do nothing
 		return;
 	//No video
@@ -3004,15 +3222,19 @@ void DTLSICETransport::CheckProbeTimer()
 		}
 	}
 	
-	//Check if we have to start if
-	if (this->senderSideEstimationEnabled && this->probe && video && state == DTLSState::Connected)
+	//Check if we have to probe
+	probingActive = this->senderSideEstimationEnabled && this->probe && video && state == DTLSState::Connected;
+	
+	//If probing
+	if (probingActive)
 	{
 		//If not already started
-		if (!probingTimer->IsScheduled())
-			//Start probing timer again
-			probingTimer->Repeat(ProbingInterval);
-	}else {
-		//Stop probing
-		probingTimer->Cancel();
+		if (!pacerTimer->IsScheduled())
+			//Start probing again
+			pacerTimer->Again(ProbingInterval);
+	//If there is nothing to pace either
+	} else if (pacer.IsEmpty()) {
+		//Stop timer
+		pacerTimer->Cancel();
 	}
 }
\ No newline at end of file
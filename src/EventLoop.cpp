@@ -6,6 +6,7 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <sys/poll.h>
+#include <netinet/udp.h>
 
 #include <errno.h>
 #include <unistd.h>
@@ -14,11 +15,19 @@
 #include <sched.h>
 #include <pthread.h>
 #include <cmath>
+#include <algorithm>
 
 #include "log.h"
+#include "IoUring.h"
 
 const size_t EventLoop::MaxSendingQueueSize = 64*1024;
 const size_t EventLoop::PacketPoolSize = 1024;
+const size_t EventLoop::UringBufferCount = 1024;
+const std::chrono::microseconds EventLoop::WheelResolution = 100us;
+const size_t EventLoop::MaxGSOSegments = 64;
+const size_t EventLoop::MaxGSOSize = 65000;
+const size_t EventLoop::MaxMultipleGROMessages = 32;
+const size_t EventLoop::MaxGROSize = 64*1024;
 
 
 #if __APPLE__
@@ -221,7 +230,7 @@ bool EventLoop::Start(std::function<void(void)> loop)
 	return true;
 }
 
-bool EventLoop::Start(int fd)
+bool EventLoop::Start(int fd, Backend backend)
 {
 	//If already started
 	if (running)
@@ -230,7 +239,18 @@ bool EventLoop::Start(int fd)
 	
 	//Log
 	TRACE_EVENT("eventloop", "EventLoop::Start(fd)");
-	Debug("-EventLoop::Start() [fd:%d,this:%p]\n",fd,this);
+	Debug("-EventLoop::Start() [fd:%d,backend:%s,this:%p]\n",fd,backend==Backend::IoUring ? "io_uring" : "poll",this);
+
+#ifndef HAVE_IO_URING
+	//Check if supported
+	if (backend==Backend::IoUring)
+	{
+		//Log
+		Warning("-EventLoop::Start() | io_uring not supported, using poll\n");
+		//Fallback
+		backend = Backend::Poll;
+	}
+#endif
 	
 #if __APPLE__
 	//Create pipe
@@ -252,6 +272,9 @@ bool EventLoop::Start(int fd)
 	
 	//Store socket
 	this->fd = fd;
+
+	//Store backend
+	this->backend = backend;
 	
 	//Running
 	running = true;
@@ -351,27 +374,26 @@ std::future<void> EventLoop::Async(std::function<void(std::chrono::milliseconds)
 {
 	//UltraDebug(">EventLoop::Async()\n");
 	
-	//Create task
+	//Create promise
 	std::promise<void> promise;
-	auto task = std::make_pair(std::move(promise),std::move(func));
 	
 	//Get future before moving the promise
-	auto future = task.first.get_future();
+	auto future = promise.get_future();
 	
 	//If not in the same thread
 	if (std::this_thread::get_id()!=thread.get_id())
 	{
 		//Add to pending taks
-		tasks.enqueue(std::move(task));
+		tasks.enqueue({std::move(func),std::move(promise),NowMicros()});
 
 		//Signal the thread this will cause the poll call to exit
 		Signal();
 	} else {
 		//Call now otherwise
-		task.second(GetNow());
+		func(GetNow());
 		
 		//Resolve the promise
-		task.first.set_value();
+		promise.set_value();
 	}
 	
 	//UltraDebug("<EventLoop::Async()\n");
@@ -380,6 +402,22 @@ std::future<void> EventLoop::Async(std::function<void(std::chrono::milliseconds)
 	return future;
 }
 
+void EventLoop::Post(Task&& task)
+{
+	//If not in the same thread
+	if (std::this_thread::get_id()!=thread.get_id())
+	{
+		//Add to pending taks, without promise
+		tasks.enqueue({std::move(task),std::nullopt,NowMicros()});
+
+		//Signal the thread this will cause the poll call to exit
+		Signal();
+	} else {
+		//Call now otherwise
+		task(GetNow());
+	}
+}
+
 Timer::shared EventLoop::CreateTimer(std::function<void(std::chrono::milliseconds)> callback)
 {
 	//Create timer without scheduling it
@@ -402,16 +440,18 @@ Timer::shared EventLoop::CreateTimer(const std::chrono::milliseconds& ms, const
 	auto timer = std::make_shared<TimerImpl>(*this,repeat,callback);
 	
 	//Get next
-	auto next = this->Now() + ms;
+	auto next = NowMicros() + ms;
 	
-	//Add it async
-	Async([this,timer,next](auto now){
-		//Set next tick
-		timer->next = next;
-
-		//Add to timer list
-		timers.emplace(next, timer);
-	});
+	//If we are on the loop thread
+	if (IsLoopThread())
+		//Add to the wheel without going through Async
+		ScheduleTimer(timer, next);
+	else
+		//Add it async
+		Post([this,timer,next](auto now){
+			//Add to the wheel
+			ScheduleTimer(timer, next);
+		});
 	
 	//Done
 	return std::static_pointer_cast<Timer>(timer);
@@ -419,8 +459,13 @@ Timer::shared EventLoop::CreateTimer(const std::chrono::milliseconds& ms, const
 
 void EventLoop::TimerImpl::Cancel()
 {
+	//If we are on the loop thread
+	if (loop.IsLoopThread())
+		//Remove us now
+		return loop.CancelTimer(shared_from_this());
+
 	//Add it async
-	loop.Async([timer = shared_from_this()](auto now){
+	loop.Post([timer = shared_from_this()](auto now){
 		//Remove us
 		timer->loop.CancelTimer(timer);
 	});
@@ -428,21 +473,31 @@ void EventLoop::TimerImpl::Cancel()
 
 void EventLoop::TimerImpl::Again(const std::chrono::milliseconds& ms)
 {
-	//UltraDebug(">EventLoop::Again() | Again triggered in %u\n",ms.count());
+	Again(std::chrono::duration_cast<std::chrono::microseconds>(ms));
+}
+
+void EventLoop::TimerImpl::Again(const std::chrono::microseconds& us)
+{
+	//UltraDebug(">EventLoop::Again() | Again triggered in %u\n",us.count());
 	
 	//Get next
-	auto next = loop.Now() + ms;
+	auto next = EventLoop::NowMicros() + us;
+
+	//If we are on the loop thread
+	if (loop.IsLoopThread())
+	{
+		//Remove us
+		loop.CancelTimer(shared_from_this());
+		//Add to the wheel
+		return loop.ScheduleTimer(shared_from_this(), next);
+	}
 	
 	//Reschedule it async
-	loop.Async([timer = shared_from_this(),next](auto now){
+	loop.Post([timer = shared_from_this(),next](auto now){
 		//Remove us
 		timer->loop.CancelTimer(timer);
-
-		//Set next tick
-		timer->next = next;
-		
-		//Add to timer list
-		timer->loop.timers.emplace(next, timer);
+		//Add to the wheel
+		timer->loop.ScheduleTimer(timer, next);
 	});
 	
 	//UltraDebug("<EventLoop::Again() | timer triggered at %llu\n",next.count());
@@ -458,20 +513,27 @@ void EventLoop::TimerImpl::Reschedule(const std::chrono::milliseconds& ms, const
 	//UltraDebug(">EventLoop::TimerImpl::Reschedule() | in %u repeat %u\n", ms.count(), repeat.count());
 
 	//Get next
-	auto next = loop.Now() + ms;
+	auto next = EventLoop::NowMicros() + ms;
+
+	//If we are on the loop thread
+	if (loop.IsLoopThread())
+	{
+		//Remove us
+		loop.CancelTimer(shared_from_this());
+		//Update repeat interval
+		this->repeat = repeat;
+		//Add to the wheel
+		return loop.ScheduleTimer(shared_from_this(), next);
+	}
 
 	//Reschedule it async
-	loop.Async([timer = shared_from_this(), next, repeat](auto now){
+	loop.Post([timer = shared_from_this(), next, repeat](auto now){
 		//Remove us
 		timer->loop.CancelTimer(timer);
-
-		//Set next tick
-		timer->next = next;
 		//Update repeat interval
 		timer->repeat = repeat;
-		
-		//Add to timer list
-		timer->loop.timers.emplace(next, timer);
+		//Add to the wheel
+		timer->loop.ScheduleTimer(timer, next);
 	});
 }
 
@@ -483,30 +545,189 @@ void EventLoop::CancelTimer(TimerImpl::shared timer)
 	//We don't have to repeat this
 	timer->repeat = 0ms;
 	
-	//If not scheduled
-	if (!timer->next.count())
-		//Nothing
-		return;
-	
-	//Get all timers at that tick
-	auto result = timers.equal_range(timer->next);
-	
 	//Reset next tick
 	timer->next = 0ms;
 
-	// Iterate over the range
-	for (auto it = result.first; it != result.second; ++it)
+	//If it is on the wheel
+	if (timer->scheduled)
+		//Remove it
+		UnlinkTimer(timer.get());
+
+	//UltraDebug("<EventLoop::CancelTimer() \n");
+}
+
+void EventLoop::ScheduleTimer(const TimerImpl::shared& timer, const std::chrono::microseconds& when)
+{
+	//If it is already on the wheel
+	if (timer->scheduled)
+		//Remove it first
+		UnlinkTimer(timer.get());
+
+	//If the wheel is empty, move it to current time so we don't have to walk all the ticks since last timer
+	if (std::all_of(wheelCount, wheelCount + WheelLevels, [](size_t count){ return !count; }))
+		wheelTick = std::max<uint64_t>(wheelTick, NowMicros() / WheelResolution);
+
+	//Set next tick
+	timer->when = when;
+	timer->next = std::max(std::chrono::duration_cast<std::chrono::milliseconds>(when), 1ms);
+	timer->tick = std::max<uint64_t>(when / WheelResolution, wheelTick);
+	
+	//Keep a reference while it is on the wheel
+	timer->scheduled = timer;
+
+	//Add to wheel
+	LinkTimer(timer.get());
+}
+
+void EventLoop::LinkTimer(TimerImpl* timer)
+{
+	//Get the level where it fits
+	uint64_t delta = timer->tick - wheelTick;
+	size_t level = 0;
+	while (level < WheelLevels - 1 && delta >= (1ull << (8 * (level + 1))))
+		level++;
+
+	//If it is beyond the last level, park it at the farthest slot, it will be cascaded again
+	uint64_t tick = std::min<uint64_t>(timer->tick, wheelTick + (1ull << (8 * WheelLevels)) - 1);
+
+	//Get slot
+	size_t slot = (tick >> (8 * level)) & (WheelSlots - 1);
+	auto& head = wheel[level][slot];
+
+	//Add at the head of the slot list
+	timer->level		= level;
+	timer->slot		= slot;
+	timer->prev		= nullptr;
+	timer->following	= head;
+	if (head)
+		head->prev = timer;
+	head = timer;
+
+	//One more
+	wheelCount[level]++;
+}
+
+void EventLoop::UnlinkTimer(TimerImpl* timer)
+{
+	//Remove from slot list
+	if (timer->prev)
+		timer->prev->following = timer->following;
+	else
+		wheel[timer->level][timer->slot] = timer->following;
+	if (timer->following)
+		timer->following->prev = timer->prev;
+
+	//One less
+	wheelCount[timer->level]--;
+
+	//Clean
+	timer->prev = nullptr;
+	timer->following = nullptr;
+
+	//Release wheel reference, may delete the timer
+	auto scheduled = std::move(timer->scheduled);
+}
+
+void EventLoop::AdvanceTimers(const std::chrono::microseconds& now, std::vector<TimerImpl::shared>& triggered)
+{
+	//Get current tick
+	uint64_t target = now / WheelResolution;
+
+	//Process all ticks up to now
+	while (wheelTick <= target)
 	{
-		//If it is the same impl
-		if (it->second.get()==timer.get())
+		//Check if there is any timer at all
+		size_t total = 0;
+		for (size_t level = 0; level < WheelLevels; ++level)
+			total += wheelCount[level];
+
+		//Nothing to do, just move forward
+		if (!total)
 		{
-			//Remove this one
-			timers.erase(it);
-			//Found
+			wheelTick = target + 1;
 			break;
 		}
+
+		//When starting a new round on a level, cascade down the timers of the slot on the level above
+		for (size_t level = 1; level < WheelLevels && !(wheelTick & ((1ull << (8 * level)) - 1)); ++level)
+		{
+			//Get slot
+			auto& head = wheel[level][(wheelTick >> (8 * level)) & (WheelSlots - 1)];
+			//Detach list
+			TimerImpl* timer = head;
+			head = nullptr;
+			//Re-add them on the lower levels
+			while (timer)
+			{
+				TimerImpl* following = timer->following;
+				wheelCount[level]--;
+				LinkTimer(timer);
+				timer = following;
+			}
+		}
+
+		//If level 0 is empty, skip to next round
+		if (!wheelCount[0])
+		{
+			wheelTick = std::min(target + 1, (wheelTick | (WheelSlots - 1)) + 1);
+			continue;
+		}
+
+		//Get expired timers on current tick
+		auto& head = wheel[0][wheelTick & (WheelSlots - 1)];
+		size_t first = triggered.size();
+		while (head)
+		{
+			//Keep reference
+			triggered.push_back(head->scheduled);
+			//Remove from wheel
+			UnlinkTimer(head);
+		}
+		//Fire in insertion order
+		std::reverse(triggered.begin() + first, triggered.end());
+
+		//Next
+		wheelTick++;
 	}
-	//UltraDebug("<EventLoop::CancelTimer() \n");
+}
+
+std::optional<uint64_t> EventLoop::GetNextTimerTick() const
+{
+	std::optional<uint64_t> next;
+
+	//Find first non empty slot on level 0
+	if (wheelCount[0])
+		for (uint64_t tick = wheelTick; tick < wheelTick + WheelSlots; ++tick)
+			if (wheel[0][tick & (WheelSlots - 1)])
+			{
+				next = tick;
+				break;
+			}
+
+	//For upper levels, wake up when the first non empty slot is cascaded, it may be before the level 0 one if it is on the next round
+	for (size_t level = 1; level < WheelLevels; ++level)
+	{
+		//Skip empty levels
+		if (!wheelCount[level])
+			continue;
+		//Current round at this level
+		uint64_t round = wheelTick >> (8 * level);
+		//Find next non empty slot
+		for (uint64_t i = 1; i <= WheelSlots; ++i)
+		{
+			if (wheel[level][(round + i) & (WheelSlots - 1)])
+			{
+				//Get when it will be cascaded
+				uint64_t tick = (round + i) << (8 * level);
+				//Keep the earliest
+				if (!next || tick < *next)
+					next = tick;
+				break;
+			}
+		}
+	}
+
+	return next;
 }
 
 const std::chrono::milliseconds EventLoop::Now()
@@ -515,6 +736,11 @@ const std::chrono::milliseconds EventLoop::Now()
 	return now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
 }
 
+std::chrono::microseconds EventLoop::NowMicros()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch());
+}
+
 void EventLoop::Signal()
 {
 	TRACE_EVENT("eventloop", "EventLoop::Signal");
@@ -538,6 +764,14 @@ void EventLoop::Signal()
 void EventLoop::Run(const std::chrono::milliseconds &duration)
 {
 	//Log(">EventLoop::Run() | [%p,running:%d,duration:%llu]\n",this,running,duration.count());
+
+	//Packets are picked and released without locking from this thread
+	packetPool.SetOwner(std::this_thread::get_id());
+
+	//Use io_uring if requested, fallback to poll if it can't be initialized
+	if (backend==Backend::IoUring && RunUring(duration))
+		//Done
+		return;
 	
 	//Recv data
 	uint8_t datas[MaxMultipleReceivingMessages][MTU] ZEROALIGNEDTO32;
@@ -560,6 +794,24 @@ void EventLoop::Run(const std::chrono::milliseconds &duration)
 	fsflags |= O_NONBLOCK;
 	fcntl(fd,F_SETFL,fsflags);
 
+	//Check if we can coalesce packets to same destination on send
+	bool gso = false;
+#ifdef UDP_SEGMENT
+	int offload = 0;
+	socklen_t offloadLen = sizeof(offload);
+	gso = fd!=FD_INVALID && !getsockopt(fd, SOL_UDP, UDP_SEGMENT, &offload, &offloadLen);
+#endif
+	//Check if the kernel can coalesce received datagrams
+	bool gro = false;
+#ifdef UDP_GRO
+	int enable = 1;
+	gro = fd!=FD_INVALID && !setsockopt(fd, SOL_UDP, UDP_GRO, &enable, sizeof(enable));
+#endif
+	//Coalesced datagrams don't fit in MTU sized buffers
+	std::vector<uint8_t> groBuffer(gro ? MaxMultipleGROMessages * MaxGROSize : 0);
+
+	Debug("-EventLoop::Run() | UDP offload [gso:%d,gro:%d]\n",gso,gro);
+
 
 	//Catch all IO errors and do nothing
 	signal(SIGIO,[](int){});
@@ -581,14 +833,20 @@ void EventLoop::Run(const std::chrono::milliseconds &duration)
 		ufds[1].revents = 0;
 		
 		//Until signaled or one each 10 seconds to prevent deadlocks
-		int timeout = GetNextTimeout(10E3, until);
+		auto timeout = GetNextTimeout(10s, until);
 
-		//UltraDebug(">EventLoop::Run() | poll timeout:%d timers:%d tasks:%d size:%d\n",timeout,timers.size(),tasks.size_approx(), sizeof(ufds) / sizeof(pollfd));
+		//UltraDebug(">EventLoop::Run() | poll timeout:%lld tasks:%d size:%d\n",timeout.count(),tasks.size_approx(), sizeof(ufds) / sizeof(pollfd));
 		
 		//Wait for events
 		{
-			//TRACE_EVENT("eventloop", "poll", "timeout", timeout);
-			poll(ufds,sizeof(ufds)/sizeof(pollfd),timeout);
+			//TRACE_EVENT("eventloop", "poll", "timeout", timeout.count());
+#if __APPLE__
+			poll(ufds,sizeof(ufds)/sizeof(pollfd),(timeout.count() + 999) / 1000);
+#else
+			//Use ppoll for sub millisecond timeouts
+			timespec ts = { (time_t)(timeout.count() / 1000000), (long)(timeout.count() % 1000000) * 1000 };
+			ppoll(ufds,sizeof(ufds)/sizeof(pollfd),&ts,nullptr);
+#endif
 		}
 		
 		//Update now
@@ -611,6 +869,7 @@ void EventLoop::Run(const std::chrono::milliseconds &duration)
 			struct sockaddr_in froms[MaxMultipleReceivingMessages] = {};
 			struct mmsghdr messages[MaxMultipleReceivingMessages] = {};
 			struct iovec iovs[MaxMultipleReceivingMessages][1] = {};
+			uint8_t controls[MaxMultipleReceivingMessages][CMSG_SPACE(sizeof(int))] = {};
 
 			TRACE_EVENT("eventloop", "EventLoop::Run::ProcessIn");
 			//UltraDebug("-EventLoop::Run() | ufds[0].revents & POLLIN\n");
@@ -618,13 +877,16 @@ void EventLoop::Run(const std::chrono::milliseconds &duration)
 			//Reserve space
 			items.reserve(MaxMultipleSendingMessages);
 
+			//With GRO, less but bigger messages so coalesced datagrams fit
+			size_t count = gro ? MaxMultipleGROMessages : MaxMultipleReceivingMessages;
+
 			//For each msg
-			for (size_t i = 0; i < MaxMultipleReceivingMessages; i++)
+			for (size_t i = 0; i < count; i++)
 			{	
 				//IO buffer
 				auto& iov = iovs[i];
-				iov[0].iov_base = datas[i];
-				iov[0].iov_len = size;
+				iov[0].iov_base = gro ? groBuffer.data() + i * MaxGROSize : datas[i];
+				iov[0].iov_len = gro ? MaxGROSize : size;
 
 				//Recv address
 				sockaddr_in& from = froms[i];
@@ -635,21 +897,53 @@ void EventLoop::Run(const std::chrono::milliseconds &duration)
 				message.msg_namelen = sizeof(from);
 				message.msg_iov = iov;
 				message.msg_iovlen = 1;
-				message.msg_control = 0;
-				message.msg_controllen = 0;
+				message.msg_control = gro ? controls[i] : 0;
+				message.msg_controllen = gro ? sizeof(controls[i]) : 0;
 			}
 
 			//Read from socket
-			int len = recvmmsg(fd, messages, MaxMultipleReceivingMessages, flags, nullptr);
+			int len = recvmmsg(fd, messages, count, flags, nullptr);
+
+			//Update stats
+			if (len>0)
+			{
+				stats.recvCalls++;
+				stats.recvDatagrams += len;
+			}
 
 			//If we got listener
 			if (listener)
 				//for each one
-				for (int i = 0; i < len && i < MaxMultipleReceivingMessages; i++)
+				for (int i = 0; i < len && i < (int)count; i++)
+				{
 					//double check
-					if (messages[i].msg_len)
+					if (!messages[i].msg_len)
+						continue;
+
+					//Get data and sender
+					auto data = (const uint8_t*)iovs[i][0].iov_base;
+					uint32_t total = messages[i].msg_len;
+					uint32_t ipAddr = ntohl(froms[i].sin_addr.s_addr);
+					uint16_t port = ntohs(froms[i].sin_port);
+
+					//By default it is a single datagram
+					uint32_t segment = total;
+#ifdef UDP_GRO
+					//Check if the kernel coalesced several datagrams
+					for (cmsghdr* cmsg = CMSG_FIRSTHDR(&messages[i].msg_hdr); gro && cmsg; cmsg = CMSG_NXTHDR(&messages[i].msg_hdr, cmsg))
+						if (cmsg->cmsg_level==SOL_UDP && cmsg->cmsg_type==UDP_GRO)
+							//Get segment size
+							segment = *(int*)CMSG_DATA(cmsg);
+#endif
+					//Split them back
+					for (uint32_t pos = 0; pos < total; pos += segment)
+					{
 						//Run callback
-						listener->OnRead(ufds[0].fd, datas[i], messages[i].msg_len, ntohl(froms[i].sin_addr.s_addr), ntohs(froms[i].sin_port));
+						listener->OnRead(ufds[0].fd, data + pos, std::min(segment, total - pos), ipAddr, port);
+						//Update stats
+						stats.recvPackets++;
+					}
+				}
 		}
 		
 		//Check read is possible
@@ -658,7 +952,10 @@ void EventLoop::Run(const std::chrono::milliseconds &duration)
 			//Multiple messages struct
 			struct mmsghdr messages[MaxMultipleSendingMessages] = {};
 			struct sockaddr_in tos[MaxMultipleSendingMessages] = {};
-			struct iovec iovs[MaxMultipleSendingMessages][1] = {};
+			struct iovec iovs[MaxMultipleSendingMessages] = {};
+			uint8_t controls[MaxMultipleSendingMessages][CMSG_SPACE(sizeof(uint16_t))] = {};
+			//Number of packets on each message
+			uint32_t packets[MaxMultipleSendingMessages] = {};
 
 			TRACE_EVENT("eventloop", "EventLoop::Run::ProcessOut");
 			//UltraDebug("-EventLoop::Run() | ufds[0].revents & POLLOUT\n");
@@ -682,10 +979,12 @@ void EventLoop::Run(const std::chrono::milliseconds &duration)
 			uint32_t len = 0;
 			
 			//For each item
-			for (auto& item : items)
+			for (size_t i = 0; i < items.size(); )
 			{
-				//IO buffer
-				auto& iov		= iovs[len];
+				auto& item = items[i];
+
+				//IO buffers for all the packets in this message
+				auto iov		= &iovs[i];
 
 				//Message
 				msghdr& message		= messages[len].msg_hdr;
@@ -715,12 +1014,51 @@ void EventLoop::Run(const std::chrono::milliseconds &duration)
 				//Set packet data
 				iov[0].iov_base		= item.packet.GetData();
 				iov[0].iov_len		= item.packet.GetSize();
+
+				//One packet so far
+				uint32_t count = 1;
+				size_t total = item.packet.GetSize();
+#ifdef UDP_SEGMENT
+				//Segment size is the size of the first packet
+				size_t segment = item.packet.GetSize();
+
+				//Coalesce following packets to same destination while they have same size, last one can be smaller
+				while (gso && !this->rawTx && i + count < items.size() && count < MaxGSOSegments)
+				{
+					auto& next = items[i + count];
+					//Check destination, size and that previous one was not the smaller last one
+					if (next.ipAddr!=item.ipAddr || next.port!=item.port || next.packet.GetSize()>segment || iov[count-1].iov_len!=segment || total + next.packet.GetSize() > MaxGSOSize)
+						break;
+					//Add it to the message
+					iov[count].iov_base	= next.packet.GetData();
+					iov[count].iov_len	= next.packet.GetSize();
+					total += next.packet.GetSize();
+					count++;
+				}
+
+				//If we have coalesced packets
+				if (count>1)
+				{
+					//Set segment size
+					message.msg_iovlen	= count;
+					message.msg_control	= controls[len];
+					message.msg_controllen	= CMSG_SPACE(sizeof(uint16_t));
+					cmsghdr* cmsg		= CMSG_FIRSTHDR(&message);
+					cmsg->cmsg_level	= SOL_UDP;
+					cmsg->cmsg_type		= UDP_SEGMENT;
+					cmsg->cmsg_len		= CMSG_LEN(sizeof(uint16_t));
+					*(uint16_t*)CMSG_DATA(cmsg) = segment;
+				}
+#endif
+				//Store number of packets
+				packets[len]		= count;
 				
 				//Reset message len
 				messages[len].msg_len	= 0;
 				
 				//Next
 				len++;
+				i += count;
 			}
 			
 			//Send them
@@ -729,6 +1067,19 @@ void EventLoop::Run(const std::chrono::milliseconds &duration)
 				TRACE_EVENT("eventloop", "sendmmsg", "fd", fd, "vlen", len);
 				sendmmsg(sendFd, messages, len, flags);
 			}
+
+			//If segmentation is not supported by the device
+			if (gso && !messages[0].msg_len && packets[0]>1 && (errno==EIO || errno==EINVAL))
+			{
+				//Log
+				Warning("-EventLoop::Run() | UDP segmentation offload failed, disabling it [errno:%d]\n",errno);
+				//Disable it
+				gso = false;
+			}
+
+			//Update stats
+			if (len)
+				stats.sendCalls++;
 			
 			//Update now
 			now = Now();
@@ -738,20 +1089,31 @@ void EventLoop::Run(const std::chrono::milliseconds &duration)
 			//Retry
 			std::vector<SendBuffer> retry;
 			//check each mesasge
-			for (uint32_t i = 0; i<len && it!=items.end(); ++i, ++it)
+			for (uint32_t i = 0; i<len && it!=items.end(); ++i)
 			{
-				//If we are in normal state and we can retry a failed message
-				if (!messages[i].msg_len && state==State::Normal && (errno==EAGAIN || errno==EWOULDBLOCK))
+				//If sent
+				if (messages[i].msg_len)
 				{
-					//Retry it
-					retry.emplace_back(std::move(*it));
-				} else {
-					//Move packet buffer back to the pool
-					packetPool.release(std::move(it->packet));
-					//If we had a callback
-					if (it->callback)
-						//Set sending time
-						it->callback.value()(now);
+					//Update stats
+					stats.sentDatagrams++;
+					stats.sentPackets += packets[i];
+				}
+				//For each packet on the message
+				for (uint32_t j = 0; j<packets[i] && it!=items.end(); ++j, ++it)
+				{
+					//If we are in normal state and we can retry a failed message
+					if (!messages[i].msg_len && state==State::Normal && (errno==EAGAIN || errno==EWOULDBLOCK || (!gso && packets[i]>1)))
+					{
+						//Retry it
+						retry.emplace_back(std::move(*it));
+					} else {
+						//Move packet buffer back to the pool
+						packetPool.release(std::move(it->packet));
+						//If we had a callback
+						if (it->callback)
+							//Set sending time
+							it->callback.value()(now);
+					}
 				}
 			}
 			//Clear items
@@ -781,32 +1143,316 @@ void EventLoop::Run(const std::chrono::milliseconds &duration)
 	//Log("<EventLoop::Run()\n");
 }
 
-int EventLoop::GetNextTimeout(int defaultTimeout, const std::chrono::milliseconds& until) const
+#ifndef HAVE_IO_URING
+bool EventLoop::RunUring(const std::chrono::milliseconds &duration)
+{
+	return false;
+}
+#else
+bool EventLoop::RunUring(const std::chrono::milliseconds &duration)
+{
+	//Completion tags, sends carry the in flight slot on the upper bits
+	enum Tag : uint64_t
+	{
+		Recv	= 1,
+		Wakeup	= 2,
+		Cancel	= 3,
+		Sent	= 4
+	};
+
+	//In flight send, must be kept alive until completion
+	struct Sending
+	{
+		SendBuffer	item;
+		msghdr		message;
+		iovec		iov;
+		sockaddr_in	to;
+	};
+
+	IoUring uring;
+
+	//Create ring, with room for the multishot receive completions
+	if (!uring.Init(MaxMultipleSendingMessages*2, UringBufferCount*2))
+		return Warning("-EventLoop::RunUring() | could not create io_uring, using poll\n");
+
+	//Each buffer holds the recvmsg header, the source address and the payload
+	const uint32_t bufferSize = (sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in) + MTU + 31) & ~31;
+
+	//Register receiving buffers
+	if (fd!=FD_INVALID && !uring.RegisterBufferRing(0, UringBufferCount, bufferSize))
+		return Warning("-EventLoop::RunUring() | could not register buffer ring, using poll\n");
+
+	//Let io_uring wait for the socket instead of failing with EAGAIN
+	if (fd!=FD_INVALID)
+		fcntl(fd,F_SETFL,fcntl(fd,F_GETFL,0) & ~O_NONBLOCK);
+
+	//Catch all IO errors and do nothing
+	signal(SIGIO,[](int){});
+
+	//Only name and control lengths are used on multishot recvmsg
+	msghdr header = {};
+	header.msg_namelen = sizeof(sockaddr_in);
+
+	//In flight sends and free slots
+	std::vector<Sending> inflight(MaxMultipleSendingMessages);
+	std::vector<uint64_t> available;
+	for (uint64_t i = 0; i<MaxMultipleSendingMessages; ++i)
+		available.push_back(MaxMultipleSendingMessages - i - 1);
+
+	bool receiving = false;
+	bool waking = false;
+	bool closed = false;
+	bool unsupported = false;
+
+	auto onCompletion = [&](const io_uring_cqe& cqe) {
+		switch (cqe.user_data & 0xFF)
+		{
+			case Tag::Recv:
+			{
+				//If we got a buffer
+				if (cqe.flags & IORING_CQE_F_BUFFER)
+				{
+					//Get buffer id
+					uint16_t id = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+					//Get message
+					auto out = (io_uring_recvmsg_out*)uring.GetBuffer(id);
+					auto from = (sockaddr_in*)(out + 1);
+					auto payload = (uint8_t*)(out + 1) + header.msg_namelen + header.msg_controllen;
+					//If it is valid
+					if (cqe.res>0 && listener && out->payloadlen && !(out->flags & MSG_TRUNC))
+						//Run callback
+						listener->OnRead(fd, payload, out->payloadlen, ntohl(from->sin_addr.s_addr), ntohs(from->sin_port));
+					//Give it back
+					uring.RecycleBuffer(id);
+				}
+				//If the socket has been closed
+				if (cqe.res==-EBADF)
+				{
+					//Error
+					Log("-EventLoop::RunUring() | socket closed [res:%d]\n",cqe.res);
+					//Exit
+					closed = true;
+				//If the kernel can't do multishot recvmsg
+				} else if (cqe.res==-EINVAL || cqe.res==-EOPNOTSUPP) {
+					//Error
+					Warning("-EventLoop::RunUring() | recvmsg not supported, using poll [res:%d]\n",cqe.res);
+					//Exit and fallback
+					unsupported = true;
+				//If we run out of buffers or it was canceled it will be armed again silently
+				} else if (cqe.res<0 && cqe.res!=-ENOBUFS && cqe.res!=-ECANCELED) {
+					//Error, like on poll it is not fatal and it will be armed again
+					Log("-EventLoop::RunUring() | recvmsg error [res:%d]\n",cqe.res);
+				}
+				//Check if it needs to be armed again
+				if (!(cqe.flags & IORING_CQE_F_MORE))
+					receiving = false;
+				break;
+			}
+			case Tag::Wakeup:
+				//Clear signal flag
+				ClearSignal();
+				//Check if it needs to be armed again
+				if (!(cqe.flags & IORING_CQE_F_MORE))
+					waking = false;
+				break;
+			case Tag::Sent:
+			{
+				//Get slot
+				uint64_t slot = cqe.user_data >> 8;
+				auto& sent = inflight[slot];
+				//Move packet buffer back to the pool
+				packetPool.release(std::move(sent.item.packet));
+				//If we had a callback
+				if (sent.item.callback)
+					//Set sending time
+					sent.item.callback.value()(now);
+				//Reset it
+				sent.item = {};
+				//Free slot
+				available.push_back(slot);
+				break;
+			}
+		}
+	};
+
+	//Get now
+	auto now = Now();
+
+	//calculate until when
+	auto until = duration < std::chrono::milliseconds::max() ? now + duration : std::chrono::milliseconds::max();
+
+	//Run until ended
+	while(running && now<=until && !closed && !unsupported)
+	{
+		//Arm multishot receive
+		if (!receiving && fd!=FD_INVALID)
+		{
+			io_uring_sqe* sqe = uring.GetSQE();
+			sqe->opcode	= IORING_OP_RECVMSG;
+			sqe->fd		= fd;
+			sqe->addr	= (uint64_t)(uintptr_t)&header;
+			sqe->len	= 1;
+			sqe->flags	= IOSQE_BUFFER_SELECT;
+			sqe->buf_group	= 0;
+			sqe->ioprio	= IORING_RECV_MULTISHOT;
+			sqe->user_data	= Tag::Recv;
+			receiving = true;
+		}
+
+		//Arm multishot poll on the signal eventfd
+		if (!waking)
+		{
+			io_uring_sqe* sqe = uring.GetSQE();
+			sqe->opcode		= IORING_OP_POLL_ADD;
+			sqe->fd			= pipe[0];
+			sqe->poll32_events	= POLLIN;
+			sqe->len		= IORING_POLL_ADD_MULTI;
+			sqe->user_data		= Tag::Wakeup;
+			waking = true;
+		}
+
+		//Queue as many sends as free slots
+		while (available.size())
+		{
+			//Get next item
+			SendBuffer item;
+			if (!sending.try_dequeue(item))
+				break;
+
+			//Get free slot
+			uint64_t slot = available.back();
+			available.pop_back();
+
+			auto& send = inflight[slot];
+			send.item = std::move(item);
+
+			//Message
+			send.message		= {};
+			send.message.msg_iov	= &send.iov;
+			send.message.msg_iovlen	= 1;
+
+			if (!this->rawTx) {
+				//Send address
+				send.to			= {};
+				send.to.sin_family	= AF_INET;
+				send.to.sin_addr.s_addr	= htonl(send.item.ipAddr);
+				send.to.sin_port	= htons(send.item.port);
+
+				send.message.msg_name	= (sockaddr*) &send.to;
+				send.message.msg_namelen= sizeof(send.to);
+			} else {
+				//Packet header
+				auto& candidateData = send.item.rawTxData ? *send.item.rawTxData : this->rawTx->defaultRoute;
+				PacketHeader::PrepareHeader(this->rawTx->header, send.item.ipAddr, send.item.port, candidateData, send.item.packet);
+				send.item.packet.PrefixData((uint8_t*) &this->rawTx->header, sizeof(this->rawTx->header));
+			}
+
+			//Set packet data
+			send.iov.iov_base	= send.item.packet.GetData();
+			send.iov.iov_len	= send.item.packet.GetSize();
+
+			//Send it
+			io_uring_sqe* sqe = uring.GetSQE();
+			sqe->opcode	= IORING_OP_SENDMSG;
+			sqe->fd		= this->rawTx ? (int)this->rawTx->fd : fd;
+			sqe->addr	= (uint64_t)(uintptr_t)&send.message;
+			sqe->len	= 1;
+			sqe->user_data	= Tag::Sent | slot << 8;
+		}
+
+		//Until signaled or one each 10 seconds to prevent deadlocks
+		auto timeout = GetNextTimeout(10s, until);
+
+		//Submit and wait for events
+		{
+			//TRACE_EVENT("eventloop", "io_uring_enter", "timeout", timeout.count());
+			uring.SubmitAndWait(1, timeout.count());
+		}
+
+		//Update now
+		now = Now();
+
+		//Process completions
+		{
+			TRACE_EVENT("eventloop", "EventLoop::RunUring::ProcessCompletions");
+			uring.ForEachCQE(onCompletion);
+		}
+
+		//Return receiving buffers to the kernel
+		uring.CommitBuffers();
+
+		//Process pendint tasks
+		ProcessTasks(now);
+
+		//Timers triggered
+		ProcessTriggers(now);
+
+		//Update now
+		now = Now();
+	}
+
+	//Cancel all pending requests
+	io_uring_sqe* sqe = uring.GetSQE();
+	sqe->opcode		= IORING_OP_ASYNC_CANCEL;
+	sqe->cancel_flags	= IORING_ASYNC_CANCEL_ANY;
+	sqe->user_data		= Tag::Cancel;
+
+	//Wait for them, so in flight buffers are not used after being freed
+	for (int i = 0; i<100 && (receiving || waking || available.size()<MaxMultipleSendingMessages); ++i)
+	{
+		//Wait
+		uring.SubmitAndWait(1, 10000);
+		//Process completions
+		uring.ForEachCQE([&](const io_uring_cqe& cqe) {
+			//Drop received data
+			if ((cqe.user_data & 0xFF)==Tag::Recv)
+				receiving &= (cqe.flags & IORING_CQE_F_MORE)!=0;
+			else
+				onCompletion(cqe);
+		});
+	}
+
+	//If we have to continue with poll
+	if (unsupported)
+		//Tasks and timers are processed there
+		return false;
+
+	//Run queued tasks before exiting
+	ProcessTasks(now);
+
+	//Done
+	return true;
+}
+#endif
+
+std::chrono::microseconds EventLoop::GetNextTimeout(const std::chrono::microseconds& defaultTimeout, const std::chrono::milliseconds& until) const
 {
-	int timeout = defaultTimeout;
+	auto timeout = defaultTimeout;
 
 	//Check if we have any pending task to wait or exit poll inmediatelly
 	if (tasks.size_approx())
-	{
 		//No wait
-		timeout = 0;
-	}
-	//If we have any timer or a timeout
-	else if (timers.size())
+		return 0us;
+
+	//Get current time
+	auto now = NowMicros();
+
+	//If we have any timer
+	if (auto tick = GetNextTimerTick())
 	{
-		//Get first timer in  queue
-		auto next = std::min(timers.cbegin()->first, until);
+		//Get when it is due
+		auto next = std::chrono::microseconds(*tick * WheelResolution.count());
 		//Override timeout
-		timeout = next > now ? std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count() : 0;
+		timeout = std::min(timeout, next > now ? next - now : 0us);
 	}
 	//If we have a maximum duration
-	else if (until != std::chrono::milliseconds::max())
+	if (until != std::chrono::milliseconds::max())
 	{
 		//Override timeout
-		timeout = until > now ? std::chrono::duration_cast<std::chrono::milliseconds>(until - now).count() : 0;
+		timeout = std::min<std::chrono::microseconds>(timeout, until > now ? until - now : 0us);
 	}
 
-	return std::min(timeout, defaultTimeout);
+	return timeout;
 }
 
 void EventLoop::ClearSignal()
@@ -825,15 +1471,20 @@ void EventLoop::ProcessTasks(const std::chrono::milliseconds& now)
 {
 	//Run queued task
 	TRACE_EVENT_BEGIN("eventloop", "EventLoop::ProcessTasks");
-	std::pair<std::promise<void>, std::function<void(std::chrono::milliseconds)>> task;
+	//Queue depth of this loop
+	TRACE_COUNTER("eventloop", perfetto::CounterTrack("EventLoop::QueuedTasks", perfetto::ThreadTrack::Current()), tasks.size_approx());
+	QueuedTask task;
 	//Get all pending taks
 	while (tasks.try_dequeue(task))
 	{
+		//Time since it was queued
+		TRACE_COUNTER("eventloop", perfetto::CounterTrack("EventLoop::TaskLatency", perfetto::ThreadTrack::Current()).set_unit_name("us"), (NowMicros()-task.queued).count());
 		//UltraDebug(">EventLoop::Run() | task pending\n");
 		//Execute it
-		task.second(now);
+		task.task(now);
 		//Resolce promise
-		task.first.set_value();
+		if (task.promise)
+			task.promise->set_value();
 		//UltraDebug("<EventLoop::Run() | task run\n");
 	}
 	TRACE_EVENT_END("eventloop");
@@ -845,23 +1496,13 @@ void EventLoop::ProcessTriggers(const std::chrono::milliseconds& now)
 	TRACE_EVENT_BEGIN("eventloop", "EventLoop::ProcessTimers");
 	std::vector<TimerImpl::shared> triggered;
 	//Get all timers to process in this lop
-	for (auto it = timers.begin(); it != timers.end(); )
-	{
-		//Check it we are still on the time
-		if (it->first > now)
-			//It is yet to come
-			break;
-		//Get timer
-		triggered.push_back(std::move(it->second));
-		//Remove from the list
-		it = timers.erase(it);
-	}
+	AdvanceTimers(NowMicros(), triggered);
 
 	//Now process all timers triggered
 	for (auto timer : triggered)
 	{
 		//Get scheduled time
-		auto scheduled = timer->next;
+		auto scheduled = timer->when;
 
 		//UltraDebug(">EventLoop::Run() | timer [%s] triggered at ll%u scheduled at %lld\n",timer->GetName().c_str(),now.count(),scheduled.count());
 	
@@ -882,13 +1523,13 @@ void EventLoop::ProcessTriggers(const std::chrono::milliseconds& now)
 		{
 			//UltraDebug("-EventLoop::Run() | timer rescheduled\n");
 			//Set next
-			timer->next = scheduled + timer->repeat;
+			std::chrono::microseconds next = scheduled + timer->repeat;
 			//If the event loop has frozen and the next one is still in the past
-			if (timer->next<now)
+			if (next<now)
 				//Set it to the next one in the future
-				timer->next = timer->next + std::chrono::duration_cast<std::chrono::milliseconds>(std::ceil((now - timer->next) / timer->repeat) * timer->repeat);
+				next += ((now - next) / timer->repeat + 1) * timer->repeat;
 			//Schedule
-			timers.emplace(timer->next, timer);
+			ScheduleTimer(timer, next);
 		}
 		//UltraDebug("<EventLoop::Run() | timer run \n");
 	}
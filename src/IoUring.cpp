@@ -0,0 +1,224 @@
+#include "IoUring.h"
+
+#ifdef HAVE_IO_URING
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <algorithm>
+
+#include "log.h"
+
+static int io_uring_setup(uint32_t entries, io_uring_params* params)
+{
+	return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int fd, uint32_t submit, uint32_t wait, uint32_t flags, void* arg, size_t size)
+{
+	return syscall(__NR_io_uring_enter, fd, submit, wait, flags, arg, size);
+}
+
+static int io_uring_register(int fd, uint32_t opcode, void* arg, uint32_t args)
+{
+	return syscall(__NR_io_uring_register, fd, opcode, arg, args);
+}
+
+IoUring::~IoUring()
+{
+	//Free provided buffers, the registration is dropped with the ring
+	if (bufferRing)
+		munmap(bufferRing, bufferRingSize);
+	if (buffers)
+		munmap(buffers, buffersSize);
+	//Unmap rings
+	if (sqes)
+		munmap(sqes, sqesSize);
+	if (cqRing && cqRing!=sqRing)
+		munmap(cqRing, cqRingSize);
+	if (sqRing)
+		munmap(sqRing, sqRingSize);
+	//Close ring, which cancels any pending request
+	if (fd!=-1)
+		close(fd);
+}
+
+bool IoUring::Init(uint32_t entries, uint32_t cqEntries)
+{
+	io_uring_params params = {};
+
+	//Completion queue size for multishot receiving
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = cqEntries;
+
+	//Create ring
+	fd = io_uring_setup(entries, &params);
+
+	//Check
+	if (fd<0)
+		return Warning("-IoUring::Init() | io_uring_setup failed [errno:%d,'%s']\n",errno,strerror(errno));
+
+	//Check we can use the extended wait arguments
+	if (!(params.features & IORING_FEAT_EXT_ARG))
+		return Warning("-IoUring::Init() | extended arguments not supported\n");
+
+	//Get ring sizes
+	sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+	cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+	//If both can be mapped at once
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+	//Map submission queue
+	sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (sqRing==MAP_FAILED)
+		return Warning("-IoUring::Init() | could not map submission ring [errno:%d]\n",errno);
+
+	//Map completion queue
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		cqRing = sqRing;
+	else
+		cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+	if (cqRing==MAP_FAILED)
+		return Warning("-IoUring::Init() | could not map completion ring [errno:%d]\n",errno);
+
+	//Map sqes
+	sqes = (io_uring_sqe*)mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (sqes==MAP_FAILED)
+	{
+		sqes = nullptr;
+		return Warning("-IoUring::Init() | could not map sqes [errno:%d]\n",errno);
+	}
+
+	//Get pointers
+	auto sq = (uint8_t*)sqRing;
+	auto cq = (uint8_t*)cqRing;
+	sqHead	= (uint32_t*)(sq + params.sq_off.head);
+	sqTail	= (uint32_t*)(sq + params.sq_off.tail);
+	sqMask	= (uint32_t*)(sq + params.sq_off.ring_mask);
+	sqArray	= (uint32_t*)(sq + params.sq_off.array);
+	cqHead	= (uint32_t*)(cq + params.cq_off.head);
+	cqTail	= (uint32_t*)(cq + params.cq_off.tail);
+	cqMask	= (uint32_t*)(cq + params.cq_off.ring_mask);
+	cqes	= (io_uring_cqe*)(cq + params.cq_off.cqes);
+	sqEntries = params.sq_entries;
+
+	//Use an identity mapping on the sqe index array
+	for (uint32_t i = 0; i<sqEntries; ++i)
+		sqArray[i] = i;
+
+	//Done
+	return true;
+}
+
+bool IoUring::RegisterBufferRing(uint16_t group, uint16_t count, uint32_t size)
+{
+	//Map memory for the ring
+	bufferRingSize = count * sizeof(io_uring_buf);
+	void* ring = mmap(nullptr, bufferRingSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (ring==MAP_FAILED)
+		return Warning("-IoUring::RegisterBufferRing() | could not map buffer ring [errno:%d]\n",errno);
+
+	bufferRing = (io_uring_buf_ring*)ring;
+
+	//Register it
+	io_uring_buf_reg reg = {};
+	reg.ring_addr		= (uint64_t)(uintptr_t)bufferRing;
+	reg.ring_entries	= count;
+	reg.bgid		= group;
+
+	if (io_uring_register(fd, IORING_REGISTER_PBUF_RING, &reg, 1)<0)
+		return Warning("-IoUring::RegisterBufferRing() | could not register buffer ring [errno:%d,'%s']\n",errno,strerror(errno));
+
+	//Allocate page aligned buffers
+	buffersSize	= (size_t)count * size;
+	void* memory	= mmap(nullptr, buffersSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (memory==MAP_FAILED)
+		return Warning("-IoUring::RegisterBufferRing() | could not allocate buffers [errno:%d]\n",errno);
+	buffers		= (uint8_t*)memory;
+	bufferSize	= size;
+	bufferCount	= count;
+	bufferTail	= 0;
+
+	//Provide all of them
+	for (uint16_t i = 0; i<count; ++i)
+		RecycleBuffer(i);
+	CommitBuffers();
+
+	return true;
+}
+
+void IoUring::RecycleBuffer(uint16_t id)
+{
+	//Add it at the end of the ring, don't use bufs member as the flex array is not at offset 0 in C++
+	io_uring_buf& buf = ((io_uring_buf*)bufferRing)[bufferTail & (bufferCount - 1)];
+	buf.addr	= (uint64_t)(uintptr_t)GetBuffer(id);
+	buf.len		= bufferSize;
+	buf.bid		= id;
+	bufferTail++;
+}
+
+void IoUring::CommitBuffers()
+{
+	//Make them visible to the kernel
+	__atomic_store_n(&bufferRing->tail, bufferTail, __ATOMIC_RELEASE);
+}
+
+io_uring_sqe* IoUring::GetSQE()
+{
+	uint32_t head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+	uint32_t tail = *sqTail + pending;
+
+	//Check if full
+	if (tail - head >= sqEntries)
+		return nullptr;
+
+	//Get it and clear it
+	io_uring_sqe* sqe = &sqes[tail & *sqMask];
+	memset(sqe, 0, sizeof(io_uring_sqe));
+
+	//One more pending
+	pending++;
+
+	return sqe;
+}
+
+int IoUring::SubmitAndWait(uint32_t wait, int64_t timeout)
+{
+	//Publish pending sqes
+	uint32_t submit = pending;
+	__atomic_store_n(sqTail, *sqTail + pending, __ATOMIC_RELEASE);
+	pending = 0;
+
+	//Nothing to do
+	if (!submit && !wait)
+		return 0;
+
+	uint32_t flags = wait ? IORING_ENTER_GETEVENTS : 0;
+
+	__kernel_timespec ts = {};
+	io_uring_getevents_arg arg = {};
+
+	//If we have a timeout
+	if (wait && timeout>=0)
+	{
+		ts.tv_sec	= timeout / 1000000;
+		ts.tv_nsec	= (timeout % 1000000) * 1000;
+		arg.ts		= (uint64_t)(uintptr_t)&ts;
+	}
+
+	//Submit and wait
+	int ret = io_uring_enter(fd, submit, wait, flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+
+	//Timeouts and signals are not errors
+	if (ret<0 && (errno==ETIME || errno==EINTR))
+		return 0;
+
+	return ret<0 ? -errno : ret;
+}
+
+#endif
@@ -80,7 +80,7 @@ void MediaFrameListenerBridge::Stop()
 void MediaFrameListenerBridge::AddListener(RTPIncomingMediaStream::Listener* listener)
 {
 	Debug("-MediaFrameListenerBridge::AddListener() [this:%p,listener:%p]\n", this, listener);
-	timeService.Async([=](auto now){
+	timeService.Post([=](auto now){
 		listeners.insert(listener);
 	});
 }
@@ -95,7 +95,7 @@ void MediaFrameListenerBridge::RemoveListener(RTPIncomingMediaStream::Listener*
 
 void MediaFrameListenerBridge::onMediaFrame(const MediaFrame& frame)
 {
-	timeService.Async([=, frame = std::shared_ptr<MediaFrame>(frame.Clone())] (auto now){
+	timeService.Post([=, frame = std::shared_ptr<MediaFrame>(frame.Clone())] (auto now){
 		
 		//Multiplex
 		for (auto& listener : mediaFrameListeners)
@@ -301,7 +301,7 @@ void MediaFrameListenerBridge::Dispatch(const std::vector<RTPPacket::shared>& pa
 
 void MediaFrameListenerBridge::Reset()
 {
-	timeService.Async([=](auto now){
+	timeService.Post([=](auto now){
 		reset = true;
 	});
 }
@@ -335,7 +335,7 @@ void MediaFrameListenerBridge::AddMediaListener(const MediaFrame::Listener::shar
 {
 	Debug("-MediaFrameListenerBridge::AddMediaListener() [this:%p,listener:%p]\n", this, listener.get());
 
-	timeService.Async([=](auto now){
+	timeService.Post([=](auto now){
 		//Add to set
 		mediaFrameListeners.insert(listener);
 	});
@@ -0,0 +1,153 @@
+#include "Pacer.h"
+
+#include <algorithm>
+
+const double Pacer::PacingFactor = 2.5;
+const QWORD Pacer::MaxQueueTime = 500000;	// 500ms
+const QWORD Pacer::MaxBurstTime = 5000;		// 5ms
+//Approximate RTP header, extensions and SRTP trailer size
+const DWORD Pacer::PacketOverhead = 48;
+
+void Pacer::Enqueue(Class type, const RTPPacket::shared& packet, QWORD now)
+{
+	//Get size
+	DWORD size = packet->GetMediaLength() + PacketOverhead;
+	//Add to its queue
+	queues[type].push_back({packet, now, size});
+	queuedPackets++;
+	queuedBytes += size;
+}
+
+RTPPacket::shared Pacer::Dequeue(QWORD now, Class& type)
+{
+	//Refill budget
+	Update(now);
+
+	//By priority
+	for (size_t i = 0; i<NumClasses; ++i)
+	{
+		auto& queue = queues[i];
+		//Skip empty queues
+		if (queue.empty())
+			continue;
+		//If we can't send it now, lower priorities can't either
+		if (i!=Audio && bitrate && budget<=0)
+			return nullptr;
+		//Get first
+		auto packet = std::move(queue.front().packet);
+		queuedBytes -= queue.front().size;
+		queuedPackets--;
+		queue.pop_front();
+		//Got it
+		type = (Class)i;
+		return packet;
+	}
+	//Nothing queued
+	return nullptr;
+}
+
+void Pacer::OnSent(QWORD now, DWORD size)
+{
+	//Refill budget
+	Update(now);
+	//Consume it if pacing
+	if (bitrate)
+		budget -= size;
+}
+
+QWORD Pacer::GetWaitTime(QWORD now)
+{
+	//If empty
+	if (!queuedPackets)
+		//Forever
+		return (QWORD)-1;
+
+	//Refill budget
+	Update(now);
+
+	//If we can send now
+	if (!queues[Audio].empty() || !bitrate || budget>0)
+		return 0;
+
+	//Get rate
+	QWORD rate = GetRate(now);
+	//Time until we have at least one byte of budget
+	QWORD needed = (-budget+1)*8*1000000 - remainder;
+	return (needed + rate - 1) / rate;
+}
+
+void Pacer::Clear()
+{
+	//Remove all
+	for (auto& queue : queues)
+		queue.clear();
+	queuedPackets = 0;
+	queuedBytes = 0;
+}
+
+QWORD Pacer::GetQueueTime(QWORD now) const
+{
+	QWORD oldest = now;
+	//Get oldest on any queue
+	for (auto& queue : queues)
+		if (!queue.empty())
+			oldest = std::min(oldest, queue.front().time);
+	return now - oldest;
+}
+
+QWORD Pacer::GetRate(QWORD now) const
+{
+	//Target rate
+	QWORD rate = bitrate * PacingFactor;
+	//If we have queued packets
+	if (queuedPackets)
+	{
+		//Get how much time we have left to send the oldest one
+		QWORD elapsed = GetQueueTime(now);
+		QWORD left = elapsed<MaxQueueTime ? MaxQueueTime - elapsed : 1000;
+		//Increase rate to drain the queue in time
+		rate = std::max(rate, queuedBytes*8*1000000/left);
+	}
+	return std::max<QWORD>(rate, 1);
+}
+
+void Pacer::Update(QWORD now)
+{
+	//If first time or going back in time
+	if (!last || now<=last)
+	{
+		//Start counting from now
+		last = std::max(last, now);
+		return;
+	}
+
+	//Get elapsed time
+	QWORD elapsed = now - last;
+	last = now;
+
+	//If not pacing
+	if (!bitrate)
+	{
+		//No debt
+		budget = 0;
+		remainder = 0;
+		return;
+	}
+
+	//Get current rate
+	QWORD rate = GetRate(now);
+
+	//Refill budget, keeping the fraction of byte not used
+	QWORD bits = elapsed * rate + remainder;
+	budget += bits / 8000000;
+	remainder = bits % 8000000;
+
+	//Don't allow bursts bigger than a few ms of data or one packet
+	int64_t max = std::max<int64_t>(MaxBurstTime * rate / 8 / 1000000, MTU);
+	if (budget>=max)
+	{
+		//Cap it
+		budget = max;
+		remainder = 0;
+	}
+}
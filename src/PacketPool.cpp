@@ -0,0 +1,188 @@
+#include "PacketPool.h"
+
+#include <iterator>
+
+const size_t PacketPool::RTCPPacketSize = 512;
+const size_t PacketPool::JumboPacketSize = 64*1024;
+const size_t PacketPool::MagazineSize = 32;
+
+PacketPool::PacketPool(size_t size) :
+	size(size)
+{
+	//Preallocate RTP packets on the depot, so they can be picked from any thread
+	std::vector<Packet> packets;
+	packets.reserve(size);
+	for (size_t i = 0; i<size; ++i)
+		packets.emplace_back(GetCapacity(RTP));
+	slabs[RTP].depot.enqueue_bulk(std::make_move_iterator(packets.begin()), packets.size());
+
+	//Reserve magazines so they don't reallocate
+	for (auto& slab : slabs)
+		slab.magazine.reserve(MagazineSize * 2);
+}
+
+size_t PacketPool::GetCapacity(SizeClass sizeClass)
+{
+	switch (sizeClass)
+	{
+		case RTCP:
+			return RTCPPacketSize;
+		case RTP:
+			return MTU;
+		default:
+			return JumboPacketSize;
+	}
+}
+
+PacketPool::SizeClass PacketPool::GetSizeClass(size_t size)
+{
+	if (size<=RTCPPacketSize)
+		return RTCP;
+	if (size<=MTU)
+		return RTP;
+	return Jumbo;
+}
+
+size_t PacketPool::GetLimit(SizeClass sizeClass) const
+{
+	//Don't keep too many big ones
+	return sizeClass==Jumbo ? MagazineSize : size;
+}
+
+Packet PacketPool::pick(size_t size)
+{
+	//Get class
+	SizeClass sizeClass = GetSizeClass(size);
+	auto& slab = slabs[sizeClass];
+
+	//If it is too big for any class
+	if (size>JumboPacketSize)
+	{
+		//Not pooled
+		slab.misses.fetch_add(1, std::memory_order_relaxed);
+		//Allocate it
+		return Packet(size);
+	}
+
+	//Empty packet without buffer
+	Packet packet(0);
+	bool found = false;
+
+	//If we are on the owner thread
+	if (IsOwner())
+	{
+		//If magazine is empty
+		if (slab.magazine.empty())
+			//Refill it from the depot
+			slab.depot.try_dequeue_bulk(std::back_inserter(slab.magazine), MagazineSize);
+		//If we have any
+		if (!slab.magazine.empty())
+		{
+			//Get last one
+			packet = std::move(slab.magazine.back());
+			slab.magazine.pop_back();
+			found = true;
+		}
+	} else {
+		//Get it from the depot
+		found = slab.depot.try_dequeue(packet);
+	}
+
+	//Update stats
+	if (found)
+		slab.hits.fetch_add(1, std::memory_order_relaxed);
+	else
+		slab.misses.fetch_add(1, std::memory_order_relaxed);
+
+	//Update usage and high water mark
+	int64_t inUse = slab.inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+	int64_t highWater = slab.highWater.load(std::memory_order_relaxed);
+	while (inUse>highWater && !slab.highWater.compare_exchange_weak(highWater, inUse, std::memory_order_relaxed))
+	{
+		//Retry
+	}
+
+	//If not found
+	if (!found)
+		//Allocate new one
+		return Packet(GetCapacity(sizeClass));
+
+	return packet;
+}
+
+void PacketPool::release(Packet&& packet)
+{
+	//Get capacity
+	size_t capacity = packet.GetCapacity();
+
+	//If it is smaller than our smallest class
+	if (capacity<RTCPPacketSize)
+		//Just free it
+		return;
+
+	//Get the biggest class that it can serve
+	SizeClass sizeClass = capacity>=JumboPacketSize ? Jumbo : capacity>=MTU ? RTP : RTCP;
+	auto& slab = slabs[sizeClass];
+
+	//Not in use anymore
+	slab.inUse.fetch_sub(1, std::memory_order_relaxed);
+	slab.released.fetch_add(1, std::memory_order_relaxed);
+
+	//Reset object
+	packet.Reset();
+
+	//If we are on the owner thread
+	if (IsOwner())
+	{
+		//If magazine is full
+		if (slab.magazine.size()>=MagazineSize * 2)
+		{
+			//Flush half of it to the depot if there is room
+			if (slab.depot.size_approx()<GetLimit(sizeClass))
+				slab.depot.enqueue_bulk(std::make_move_iterator(slab.magazine.end() - MagazineSize), MagazineSize);
+			else
+				slab.dropped.fetch_add(MagazineSize, std::memory_order_relaxed);
+			//Remove them
+			slab.magazine.erase(slab.magazine.end() - MagazineSize, slab.magazine.end());
+		}
+		//Add to magazine
+		slab.magazine.push_back(std::move(packet));
+	//If there is room on the depot
+	} else if (slab.depot.size_approx()<GetLimit(sizeClass)) {
+		//Add it
+		slab.depot.enqueue(std::move(packet));
+	} else {
+		//Drop it
+		slab.dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+PacketPool::Stats PacketPool::GetStats(SizeClass sizeClass) const
+{
+	Stats stats;
+	auto& slab = slabs[sizeClass];
+	stats.hits	= slab.hits.load(std::memory_order_relaxed);
+	stats.misses	= slab.misses.load(std::memory_order_relaxed);
+	stats.released	= slab.released.load(std::memory_order_relaxed);
+	stats.dropped	= slab.dropped.load(std::memory_order_relaxed);
+	stats.inUse	= slab.inUse.load(std::memory_order_relaxed);
+	stats.highWater	= slab.highWater.load(std::memory_order_relaxed);
+	return stats;
+}
+
+PacketPool::Stats PacketPool::GetStats() const
+{
+	Stats total;
+	//Sum all classes
+	for (size_t i = 0; i<NumSizeClasses; ++i)
+	{
+		Stats stats = GetStats((SizeClass)i);
+		total.hits	+= stats.hits;
+		total.misses	+= stats.misses;
+		total.released	+= stats.released;
+		total.dropped	+= stats.dropped;
+		total.inUse	+= stats.inUse;
+		total.highWater	+= stats.highWater;
+	}
+	return total;
+}
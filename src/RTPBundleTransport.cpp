@@ -80,7 +80,12 @@ void RTPBundleTransport::SetRawTx(int32_t ifindex, unsigned int sndbuf, bool ski
 	if (skipQdisc && setsockopt(fd, SOL_PACKET, PACKET_QDISC_BYPASS, &skipQdiscInt, sizeof(skipQdiscInt)) < 0)
 		throw std::system_error(std::error_code(errno, std::system_category()), "failed setting QDISC_BYPASS");
 
-	loop.Async([=, fd = std::move(fd)](std::chrono::milliseconds) {
+	//Each shard sends on its own raw socket
+	if (main==this)
+		for (auto& shard : shards)
+			shard->SetRawTx(ifindex, sndbuf, skipQdisc, selfLladdr, defaultSelfAddr, defaultDstLladdr, port);
+
+	loop.Post([=, fd = std::move(fd)](std::chrono::milliseconds) {
 		loop.SetRawTx(fd, header, defaultRoute);
 	});
 }
@@ -88,7 +93,12 @@ void RTPBundleTransport::SetRawTx(int32_t ifindex, unsigned int sndbuf, bool ski
 
 void RTPBundleTransport::RTPBundleTransport::ClearRawTx()
 {
-	loop.Async([this](std::chrono::milliseconds) { 
+	//Clear it on all shards
+	if (main==this)
+		for (auto& shard : shards)
+			shard->ClearRawTx();
+
+	loop.Post([this](std::chrono::milliseconds) { 
 		loop.ClearRawTx(); 
 	}); 
 }
@@ -97,8 +107,28 @@ void RTPBundleTransport::RTPBundleTransport::ClearRawTx()
 * RTPBundleTransport
 * 	Constructro
 **************************/
-RTPBundleTransport::RTPBundleTransport() : 
+RTPBundleTransport::RTPBundleTransport(uint32_t shards) : 
 	loop(this)
+{
+	//Init values
+	socket = FD_INVALID;
+	port = 0;
+	
+	//If running multi threaded
+	if (shards>1)
+	{
+		//We are the main one and shard 0
+		main = this;
+		//Create the rest of shards
+		for (uint32_t i=1; i<shards; ++i)
+			this->shards.emplace_back(new RTPBundleTransport(this,i));
+	}
+}
+
+RTPBundleTransport::RTPBundleTransport(RTPBundleTransport* main, uint32_t index) : 
+	loop(this),
+	main(main),
+	index(index)
 {
 	//Init values
 	socket = FD_INVALID;
@@ -118,7 +148,13 @@ RTPBundleTransport::~RTPBundleTransport()
 RTPBundleTransport::Connection::shared RTPBundleTransport::AddICETransport(const std::string &username,const Properties& properties)
 {
 	TRACE_EVENT("transport", "RTPBundleTransport::AddICETransport", "username", username);
-	Log("-RTPBundleTransport::AddICETransport() | [%s]\n",username.c_str());
+	
+	//If running multi threaded, add it to the less loaded shard
+	if (main==this)
+		if (auto shard = GetLeastLoadedShard(); shard!=this)
+			return shard->AddICETransport(username,properties);
+	
+	Log("-RTPBundleTransport::AddICETransport() | [%s,shard:%u]\n",username.c_str(),index);
 	
 	Properties ice;
 	Properties dtls;
@@ -168,8 +204,16 @@ RTPBundleTransport::Connection::shared RTPBundleTransport::AddICETransport(const
 	//Create connection
 	auto connection = std::make_shared<Connection>(username,transport,properties.GetProperty("disableSTUNKeepAlive", false));
 	
+	//If sharded
+	if (main)
+		//Route stun requests for this username to us
+		main->AddRoute(username,this);
+	
+	//Increase load
+	load++;
+	
 	//Synchronized
-	loop.Async([=](auto now){
+	loop.Post([=](auto now){
 		//Add it
 		connections[username] = connection;
 		//Start it
@@ -183,10 +227,16 @@ RTPBundleTransport::Connection::shared RTPBundleTransport::AddICETransport(const
 int RTPBundleTransport::RemoveICETransport(const std::string &username)
 {
 	TRACE_EVENT("transport", "RTPBundleTransport::RemoveICETransport", "username", username);
+	
+	//If running multi threaded, remove it from the shard owning it
+	if (main==this)
+		if (auto shard = FindShard(username); shard && shard!=this)
+			return shard->RemoveICETransport(username);
+	
 	Log("-RTPBundleTransport::RemoveICETransport() [username:%s]\n",username.c_str());
   
 	//Synchronized
-	loop.Async([this,username](auto now){
+	loop.Post([this,username](auto now){
 
 		//Get transport
 		auto connectionIterator = connections.find(username);
@@ -209,11 +259,23 @@ int RTPBundleTransport::RemoveICETransport(const std::string &username)
 		//REmove connection
 		connections.erase(connectionIterator);
 
+		//Decrease load
+		load--;
+
+		//Remove routes to us
+		if (main)
+			main->RemoveRoute(username);
+
 		//Get all candidates
 		for( auto candidatesIterator=connection->candidates.begin(); candidatesIterator!=connection->candidates.end(); ++candidatesIterator)
 		{
 			//Get candidate object
 			ICERemoteCandidate* candidate = *candidatesIterator;
+			//Remove route before deleting it
+			if (main)
+				main->RemoveRoute(candidate->GetIPAddress(),candidate->GetPort());
+			//Remove from remote address index
+			remotes.Remove(candidate->GetIPAddress(),candidate->GetPort());
 			//Remove from all candidates list
 			candidates.erase(candidate->GetRemoteAddress());
 		}
@@ -226,6 +288,12 @@ int RTPBundleTransport::RemoveICETransport(const std::string &username)
 bool RTPBundleTransport::RestartICETransport(const std::string& username, const std::string& restarted, const Properties& properties)
 {
 	TRACE_EVENT("transport", "RTPBundleTransport::RestartICETransport", "username", username);
+	
+	//If running multi threaded, restart it on the shard owning it
+	if (main==this)
+		if (auto shard = FindShard(username); shard && shard!=this)
+			return shard->RestartICETransport(username,restarted,properties);
+	
 	Log("-RTPBundleTransport::RestartICETransport() [username:%s,restarted:%s]\n", username.c_str(), restarted.c_str());
 
 	Properties ice;
@@ -244,7 +312,7 @@ bool RTPBundleTransport::RestartICETransport(const std::string& username, const
 	}
 
 	//Synchronized
-	loop.Async([this, username, restarted, ice](auto now) {
+	loop.Post([this, username, restarted, ice](auto now) {
 
 		//Get transport
 		auto connectionIterator = connections.find(username);
@@ -271,6 +339,13 @@ bool RTPBundleTransport::RestartICETransport(const std::string& username, const
 		//Add it with new username
 		connection->username = restarted;
 		connections[restarted] = connection;
+
+		//Update routes
+		if (main)
+		{
+			main->RemoveRoute(username);
+			main->AddRoute(restarted,this);
+		}
 	});
 
 	//DOne
@@ -306,12 +381,29 @@ int RTPBundleTransport::Init()
 			socket = FD_INVALID;
 		}
 
-		//Create new sockets
-		socket = ::socket(PF_INET,SOCK_DGRAM,0);
 		//Get random
 		port = (RTPTransport::GetMinPort()+(RTPTransport::GetMaxPort()-RTPTransport::GetMinPort())*double(rand()/double(RAND_MAX)));
 		//Try to bind to port
 		recAddr.sin_port = htons(port);
+		//If sharded
+		if (main && port)
+		{
+			//Check port is free with a non reusable socket first, so we don't join the reuseport group of another process
+			FileDescriptor probe(::socket(PF_INET,SOCK_DGRAM,0));
+			//Bind it
+			if (bind(probe,(struct sockaddr *)&recAddr,sizeof(struct sockaddr_in))!=0)
+				//Try again
+				continue;
+		}
+		//Create new sockets
+		socket = ::socket(PF_INET,SOCK_DGRAM,0);
+		//If sharded
+		if (main)
+		{
+			//All shards will bind to same port
+			int reuse = 1;
+			setsockopt(socket, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse));
+		}
 		//Bind the rtp socket
 		if(bind(socket,(struct sockaddr *)&recAddr,sizeof(struct sockaddr_in))!=0)
 		{
@@ -353,6 +445,10 @@ int RTPBundleTransport::Init()
 		iceTimer = loop.CreateTimer([=](std::chrono::milliseconds now){ this->onTimer(now); });
 		//Set name for debug
 		iceTimer->SetName("RTPBundleTransport - ice");
+		//Start the rest of shards on same port
+		if (main==this && !StartShards())
+			//Error
+			return Error("-RTPBundleTransport::Init() | could not start shards\n");
 		//Done
 		Log("<RTPBundleTransport::Init()\n");
 		//Opened
@@ -395,6 +491,13 @@ int RTPBundleTransport::Init(int port)
 
 	//Create new sockets
 	socket = ::socket(PF_INET,SOCK_DGRAM,0);
+	//If sharded
+	if (main)
+	{
+		//All shards will bind to same port
+		int reuse = 1;
+		setsockopt(socket, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse));
+	}
 	//Try to bind to port
 	recAddr.sin_port = htons(port);
 	//Bind the rtp socket
@@ -428,6 +531,11 @@ int RTPBundleTransport::Init(int port)
 	//Set name for debug
 	iceTimer->SetName("RTPBundleTransport - ice");
 
+	//Start the rest of shards on same port
+	if (main==this && !StartShards())
+		//Error
+		return Error("-RTPBundleTransport::Init() | could not start shards\n");
+
 	//Done
 	Log("<RTPBundleTransport::Init()\n");
 	//Opened
@@ -447,6 +555,11 @@ int RTPBundleTransport::End()
 	TRACE_EVENT("transport", "RTPBundleTransport::End");
 	Log(">RTPBundleTransport::End()\n");
 	
+	//End all shards
+	if (main==this)
+		for (auto& shard : shards)
+			shard->End();
+	
 	//Stop timer
 	if (iceTimer)
 		//Cancel it
@@ -479,10 +592,7 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 {
 	TRACE_EVENT("transport", "RTPBundleTransport::OnRead", "ip", ip, "port", port, "size", size);
 
-	//Get remote ip:port address
-	std::string remote = ICERemoteCandidate::GetRemoteAddress(ip,port);
-	
-	//UltraDebug("-RTPBundleTransport::OnRead() | [remote:%s,size:%u]\n",remote.c_str(),size);
+	//UltraDebug("-RTPBundleTransport::OnRead() | [ip:%u,port:%u,size:%u]\n",ip,port,size);
 			
 	//Check if it looks like a STUN message
 	if (STUNMessage::IsSTUN(data,size))
@@ -532,6 +642,10 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 			//If not found
 			if (it==connections.end())
 			{
+				//If it belongs to another shard, process it there
+				if (main && Forward(this,main->FindShard(username),data,size,ip,port))
+					//Done
+					return;
 				//TODO: Reject
 				//Error
 				Debug("-RTPBundleTransport::Read() | ICE username not found [%s}\n",username.c_str());
@@ -570,6 +684,9 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 			//Get prio
 			DWORD prio = priority ? get4(priority->attr,0) : 0;
 			
+			//Get remote ip:port address
+			std::string remote = ICERemoteCandidate::GetRemoteAddress(ip,port);
+			
 			//Find candidate or try to create one if not present
 			auto [itc, inserted] = candidates.try_emplace(remote,ip,port,transport);
 			
@@ -582,6 +699,11 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 				Log("-RTPBundleTransport::Read() | Got new remote ICE candidate [remote:%s]\n",remote.c_str());
 				//Add it to the connection
 				connection->candidates.insert(candidate);
+				//Index it by remote address
+				remotes.Set(ip,port,candidate);
+				//Steer its traffic to us
+				if (main)
+					main->AddRoute(ip,port,this);
 				//Send back an ice request
 				SendBindingRequest(connection, candidate);
 			}
@@ -624,6 +746,10 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 			//If not found
 			if (transactionIterator==transactions.end())
 			{
+				//It may be a response to a request sent by another shard
+				if (main && Forward(this,main->FindShard(ip,port),data,size,ip,port))
+					//Done
+					return;
 				//Error
 				Debug("-RTPBundleTransport::Read() | transaction not found [id:%u,ts:%llu]",id,ts);
 				//Done
@@ -652,18 +778,15 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 			auto transport = connection->transport;
 			
 			//Find candidate
-			auto candidateIterator = candidates.find(remote);
+			ICERemoteCandidate* candidate = remotes.Find(ip,port);
 			
 			//Check we have it
-			if (candidateIterator==candidates.end())
+			if (!candidate)
 			{
 				//Error
-				Debug("-RTPBundleTransport::Read() | remote candidate not found for response [remote:%s]}\n",remote.c_str());
+				Debug("-RTPBundleTransport::Read() | remote candidate not found for response [remote:%s]}\n",ICERemoteCandidate::GetRemoteAddress(ip,port).c_str());
 				return;
 			}
-		
-			//Get it
-			ICERemoteCandidate* candidate = &candidateIterator->second;
 			
 			//Authenticate request with remote username
 			if (!stun->CheckAuthenticatedFingerPrint(data,size,transport->GetRemotePwd()))
@@ -695,26 +818,35 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 		return;
 	}
 	
-	//Find candidate
-	auto it = candidates.find(remote);
+	//Find candidate without allocating
+	ICERemoteCandidate* candidate = remotes.Find(ip,port);
 	
 	//Check if it was not registered
-	if (it==candidates.end())
+	if (!candidate)
 	{
+		//If it belongs to another shard, process it there
+		if (main && Forward(this,main->FindShard(ip,port),data,size,ip,port))
+			//Done
+			return;
 		//Error
-		Debug("-RTPBundleTransport::Read() | No registered ICE candidate for [%s]\n",remote.c_str());
+		Debug("-RTPBundleTransport::Read() | No registered ICE candidate for [%s]\n",ICERemoteCandidate::GetRemoteAddress(ip,port).c_str());
 		//DOne
 		return;
 	}
 	
 	//Send data on ice transport
-	it->second.onData(data,size);
+	candidate->onData(data,size);
 }
 
 void RTPBundleTransport::SetCandidateRawTxData(const std::string& ip, uint16_t port, uint32_t selfAddr, const std::string& dstLladdr)
 {
+	//If running multi threaded, set it on the shard owning the candidate
+	if (main==this)
+		if (auto shard = FindShard(ntohl(inet_addr(ip.c_str())),port); shard && shard!=this)
+			return shard->SetCandidateRawTxData(ip,port,selfAddr,dstLladdr);
+
 	PacketHeader::FlowRoutingInfo rawTxData = { selfAddr, MacAddress::Parse(dstLladdr) };
-	loop.Async([=](auto now){
+	loop.Post([=](auto now){
 		std::string remote = ip + ":" + std::to_string(port);
 
 		auto it = candidates.find(remote);
@@ -732,6 +864,12 @@ void RTPBundleTransport::SetCandidateRawTxData(const std::string& ip, uint16_t p
 int RTPBundleTransport::AddRemoteCandidate(const std::string& username,const char* host, WORD port)
 {
 	TRACE_EVENT("transport", "RTPBundleTransport::AddRemoteCandidate", "username", username, "host", host, "port", port);
+	
+	//If running multi threaded, add it on the shard owning the transport
+	if (main==this)
+		if (auto shard = FindShard(username); shard && shard!=this)
+			return shard->AddRemoteCandidate(username,host,port);
+	
 	Log("-RTPBundleTransport::AddRemoteCandidate() [username:%s,candidate:%s:%u}\n",username.c_str(),host,port);
 	
 	//Copy ip 
@@ -766,8 +904,15 @@ int RTPBundleTransport::AddRemoteCandidate(const std::string& username,const cha
 	
 		//If it was new
 		if (inserted)
+		{
 			//Add candidate and add it to the connection
 			connection->candidates.insert(candidate);
+			//Index it by remote address
+			remotes.Set(candidate->GetIPAddress(),candidate->GetPort(),candidate);
+			//Steer its traffic to us
+			if (main)
+				main->AddRoute(candidate->GetIPAddress(),candidate->GetPort(),this);
+		}
 
 		//Send binding request in any case
 		SendBindingRequest(connection,candidate);
@@ -914,3 +1059,153 @@ void RTPBundleTransport::onTimer(std::chrono::milliseconds now)
 			SendBindingRequest(connection, active);
 	}
 }
+
+void RTPBundleTransport::SetIceTimeout(uint32_t timeout)
+{
+	//Set it on all shards
+	if (main==this)
+		for (auto& shard : shards)
+			shard->SetIceTimeout(timeout);
+
+	iceTimeout = std::chrono::milliseconds(timeout);
+}
+
+bool RTPBundleTransport::SetAffinity(int cpu)
+{
+	//Pin each shard to its own core
+	if (main==this)
+		for (auto& shard : shards)
+			if (!shard->SetAffinity(cpu>=0 ? cpu + shard->index : cpu))
+				return false;
+
+	return loop.SetAffinity(cpu);
+}
+
+bool RTPBundleTransport::SetThreadName(const std::string& name)
+{
+	//Name each shard thread after its index
+	if (main==this)
+		for (auto& shard : shards)
+			if (!shard->SetThreadName(name + "-" + std::to_string(shard->index)))
+				return false;
+
+	return loop.SetThreadName(name);
+}
+
+bool RTPBundleTransport::SetPriority(int priority)
+{
+	//Set it on all shards
+	if (main==this)
+		for (auto& shard : shards)
+			if (!shard->SetPriority(priority))
+				return false;
+
+	return loop.SetPriority(priority);
+}
+
+bool RTPBundleTransport::StartShards()
+{
+	Log("-RTPBundleTransport::StartShards() [port:%d,shards:%u]\n",port,GetShards());
+
+	//Bind all shards to our port, they join the reuseport group in index order
+	for (auto& shard : shards)
+		if (!shard->Init(port))
+			return false;
+
+	//Steer known remote addresses to the shard owning them, if not available kernel hashing will be used and packets forwarded between shards
+	if (!steering.Attach(socket))
+		Warning("-RTPBundleTransport::StartShards() | reuseport steering not available, forwarding packets between shards\n");
+
+	return true;
+}
+
+RTPBundleTransport* RTPBundleTransport::GetLeastLoadedShard()
+{
+	RTPBundleTransport* selected = this;
+
+	//Find shard with less ice transports
+	for (auto& shard : shards)
+		if (shard->load < selected->load)
+			selected = shard.get();
+
+	return selected;
+}
+
+RTPBundleTransport* RTPBundleTransport::FindShard(const std::string& username)
+{
+	std::lock_guard<std::mutex> lock(routesMutex);
+
+	//Find owner
+	auto it = usernameRoutes.find(username);
+
+	//Check we have it
+	return it!=usernameRoutes.end() ? it->second : nullptr;
+}
+
+RTPBundleTransport* RTPBundleTransport::FindShard(uint32_t ip, uint16_t port)
+{
+	std::lock_guard<std::mutex> lock(routesMutex);
+
+	//Find owner
+	auto it = remoteRoutes.find(((uint64_t)ip)<<16 | port);
+
+	//Check we have it
+	return it!=remoteRoutes.end() ? it->second : nullptr;
+}
+
+void RTPBundleTransport::AddRoute(const std::string& username, RTPBundleTransport* shard)
+{
+	std::lock_guard<std::mutex> lock(routesMutex);
+
+	//Set owner
+	usernameRoutes[username] = shard;
+}
+
+void RTPBundleTransport::RemoveRoute(const std::string& username)
+{
+	std::lock_guard<std::mutex> lock(routesMutex);
+
+	//Remove owner
+	usernameRoutes.erase(username);
+}
+
+void RTPBundleTransport::AddRoute(uint32_t ip, uint16_t port, RTPBundleTransport* shard)
+{
+	std::lock_guard<std::mutex> lock(routesMutex);
+
+	//Set owner
+	remoteRoutes[((uint64_t)ip)<<16 | port] = shard;
+
+	//Steer incoming packets to the shard socket
+	steering.Set(ip,port,shard->index);
+}
+
+void RTPBundleTransport::RemoveRoute(uint32_t ip, uint16_t port)
+{
+	std::lock_guard<std::mutex> lock(routesMutex);
+
+	//Remove owner
+	remoteRoutes.erase(((uint64_t)ip)<<16 | port);
+
+	//Back to kernel hashing
+	steering.Remove(ip,port);
+}
+
+bool RTPBundleTransport::Forward(RTPBundleTransport* from, RTPBundleTransport* shard, const uint8_t* data, const size_t size, const uint32_t ip, const uint16_t port)
+{
+	//Check it is owned by a different shard
+	if (!shard || shard==from)
+		return false;
+
+	UltraDebug("-RTPBundleTransport::Forward() [from:%u,to:%u,size:%u]\n",from->index,shard->index,size);
+
+	//Copy it, as the receiving buffer will be reused
+	std::vector<uint8_t> datagram(data,data+size);
+
+	//Process it on the owner thread
+	shard->loop.Post([shard,datagram = std::move(datagram),ip,port](auto now){
+		shard->OnRead(shard->socket,datagram.data(),datagram.size(),ip,port);
+	});
+
+	return true;
+}
@@ -0,0 +1,213 @@
+#include "ReusePortSteering.h"
+
+#include "log.h"
+
+#if !defined(__linux__)
+
+bool ReusePortSteering::Attach(int fd, uint32_t maxEntries)
+{
+	return Warning("-ReusePortSteering::Attach() | reuseport steering is only supported in Linux\n");
+}
+
+bool ReusePortSteering::Set(uint32_t ip, uint16_t port, uint32_t index)
+{
+	return false;
+}
+
+bool ReusePortSteering::Remove(uint32_t ip, uint16_t port)
+{
+	return false;
+}
+
+#else
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <arpa/inet.h>
+#include <linux/bpf.h>
+
+#ifndef SO_ATTACH_REUSEPORT_EBPF
+#define SO_ATTACH_REUSEPORT_EBPF 52
+#endif
+
+namespace
+{
+
+//Remote address as loaded from the ip and udp headers, so in network order
+struct SteeringKey
+{
+	uint32_t ip;
+	uint16_t port;
+	uint16_t padding;
+};
+
+int bpf(int cmd, union bpf_attr& attr)
+{
+	return syscall(__NR_bpf, cmd, &attr, sizeof(attr));
+}
+
+constexpr bpf_insn Insn(uint8_t code, uint8_t dst, uint8_t src, int16_t off, int32_t imm)
+{
+	return bpf_insn{code, dst, src, off, imm};
+}
+
+constexpr bpf_insn Mov64Reg(uint8_t dst, uint8_t src)		{ return Insn(BPF_ALU64 | BPF_MOV | BPF_X, dst, src, 0, 0);	}
+constexpr bpf_insn Mov64Imm(uint8_t dst, int32_t imm)		{ return Insn(BPF_ALU64 | BPF_MOV | BPF_K, dst, 0, 0, imm);	}
+constexpr bpf_insn Mov32Imm(uint8_t dst, int32_t imm)		{ return Insn(BPF_ALU | BPF_MOV | BPF_K, dst, 0, 0, imm);	}
+constexpr bpf_insn Add64Imm(uint8_t dst, int32_t imm)		{ return Insn(BPF_ALU64 | BPF_ADD | BPF_K, dst, 0, 0, imm);	}
+constexpr bpf_insn And64Imm(uint8_t dst, int32_t imm)		{ return Insn(BPF_ALU64 | BPF_AND | BPF_K, dst, 0, 0, imm);	}
+constexpr bpf_insn Lsh64Imm(uint8_t dst, int32_t imm)		{ return Insn(BPF_ALU64 | BPF_LSH | BPF_K, dst, 0, 0, imm);	}
+constexpr bpf_insn LoadB(uint8_t dst, uint8_t src, int16_t off)	{ return Insn(BPF_LDX | BPF_MEM | BPF_B, dst, src, off, 0);	}
+constexpr bpf_insn LoadW(uint8_t dst, uint8_t src, int16_t off)	{ return Insn(BPF_LDX | BPF_MEM | BPF_W, dst, src, off, 0);	}
+constexpr bpf_insn StoreDWImm(uint8_t dst, int16_t off, int32_t imm)	{ return Insn(BPF_ST | BPF_MEM | BPF_DW, dst, 0, off, imm);	}
+constexpr bpf_insn JumpNeImm(uint8_t dst, int32_t imm, int16_t off)	{ return Insn(BPF_JMP | BPF_JNE | BPF_K, dst, 0, off, imm);	}
+constexpr bpf_insn JumpEqImm(uint8_t dst, int32_t imm, int16_t off)	{ return Insn(BPF_JMP | BPF_JEQ | BPF_K, dst, 0, off, imm);	}
+constexpr bpf_insn Call(int32_t func)				{ return Insn(BPF_JMP | BPF_CALL, 0, 0, 0, func);		}
+constexpr bpf_insn Exit()					{ return Insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);			}
+
+}
+
+bool ReusePortSteering::Attach(int fd, uint32_t maxEntries)
+{
+	Debug("-ReusePortSteering::Attach() [fd:%d,maxEntries:%u]\n",fd,maxEntries);
+
+	union bpf_attr attr = {};
+
+	//Create the remote address to socket index map
+	attr.map_type		= BPF_MAP_TYPE_HASH;
+	attr.key_size		= sizeof(SteeringKey);
+	attr.value_size		= sizeof(uint32_t);
+	attr.max_entries	= maxEntries;
+
+	FileDescriptor created(bpf(BPF_MAP_CREATE, attr));
+	swap(map, created);
+
+	//Check
+	if (!map.isValid())
+		return Warning("-ReusePortSteering::Attach() | could not create steering map [errno:%d,'%s']\n",errno,strerror(errno));
+
+	//Registers
+	constexpr uint8_t r0 = 0, r1 = 1, r2 = 2, r3 = 3, r4 = 4, r5 = 5, r6 = 6, r7 = 7, fp = 10;
+
+	//When run from the reuseport group the skb data points to the udp payload, so use header relative loads
+	const bpf_insn program[] = {
+		//Store context
+		Mov64Reg(r6, r1),
+		//Load first byte of ip header into fp-16
+		Mov64Reg(r1, r6),
+		Mov64Imm(r2, 0),
+		Mov64Reg(r3, fp),
+		Add64Imm(r3, -16),
+		Mov64Imm(r4, 1),
+		Mov64Imm(r5, BPF_HDR_START_NET),
+		Call(BPF_FUNC_skb_load_bytes_relative),
+		JumpNeImm(r0, 0, 28),
+		//Get ip header length
+		LoadB(r7, fp, -16),
+		And64Imm(r7, 0x0F),
+		Lsh64Imm(r7, 2),
+		//Clear key
+		StoreDWImm(fp, -8, 0),
+		//Load source ip into key
+		Mov64Reg(r1, r6),
+		Mov64Imm(r2, 12),
+		Mov64Reg(r3, fp),
+		Add64Imm(r3, -8),
+		Mov64Imm(r4, 4),
+		Mov64Imm(r5, BPF_HDR_START_NET),
+		Call(BPF_FUNC_skb_load_bytes_relative),
+		JumpNeImm(r0, 0, 16),
+		//Load udp source port into key, just after the ip header
+		Mov64Reg(r1, r6),
+		Mov64Reg(r2, r7),
+		Mov64Reg(r3, fp),
+		Add64Imm(r3, -4),
+		Mov64Imm(r4, 2),
+		Mov64Imm(r5, BPF_HDR_START_NET),
+		Call(BPF_FUNC_skb_load_bytes_relative),
+		JumpNeImm(r0, 0, 8),
+		//Lookup key on map (ld_imm64 takes two instructions)
+		Insn(BPF_LD | BPF_DW | BPF_IMM, r1, BPF_PSEUDO_MAP_FD, 0, map),
+		Insn(0, 0, 0, 0, 0),
+		Mov64Reg(r2, fp),
+		Add64Imm(r2, -8),
+		Call(BPF_FUNC_map_lookup_elem),
+		JumpEqImm(r0, 0, 2),
+		//Return stored index
+		LoadW(r0, r0, 0),
+		Exit(),
+		//Not found, let the kernel use default hashing by returning an out of range index
+		Mov32Imm(r0, -1),
+		Exit(),
+	};
+
+	char license[] = "GPL";
+	char log[4096] = {};
+
+	//Load program
+	attr = {};
+	attr.prog_type	= BPF_PROG_TYPE_SOCKET_FILTER;
+	attr.insns	= (uint64_t)(uintptr_t)program;
+	attr.insn_cnt	= sizeof(program)/sizeof(bpf_insn);
+	attr.license	= (uint64_t)(uintptr_t)license;
+	attr.log_buf	= (uint64_t)(uintptr_t)log;
+	attr.log_size	= sizeof(log);
+	attr.log_level	= 1;
+
+	FileDescriptor loaded(bpf(BPF_PROG_LOAD, attr));
+	swap(prog, loaded);
+
+	//Check
+	if (!prog.isValid())
+		return Warning("-ReusePortSteering::Attach() | could not load steering program [errno:%d,'%s']\n%s\n",errno,strerror(errno),log);
+
+	//Attach it to the reuseport group
+	int progFd = prog;
+	if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_EBPF, &progFd, sizeof(progFd))<0)
+		return Warning("-ReusePortSteering::Attach() | could not attach steering program [errno:%d,'%s']\n",errno,strerror(errno));
+
+	//Done
+	return attached = true;
+}
+
+bool ReusePortSteering::Set(uint32_t ip, uint16_t port, uint32_t index)
+{
+	//Check we have it
+	if (!attached)
+		return false;
+
+	SteeringKey key = { htonl(ip), htons(port), 0 };
+
+	union bpf_attr attr = {};
+	attr.map_fd	= map;
+	attr.key	= (uint64_t)(uintptr_t)&key;
+	attr.value	= (uint64_t)(uintptr_t)&index;
+	attr.flags	= BPF_ANY;
+
+	//Update
+	if (bpf(BPF_MAP_UPDATE_ELEM, attr)<0)
+		return Warning("-ReusePortSteering::Set() | could not update steering map [errno:%d,'%s']\n",errno,strerror(errno));
+
+	return true;
+}
+
+bool ReusePortSteering::Remove(uint32_t ip, uint16_t port)
+{
+	//Check we have it
+	if (!attached)
+		return false;
+
+	SteeringKey key = { htonl(ip), htons(port), 0 };
+
+	union bpf_attr attr = {};
+	attr.map_fd	= map;
+	attr.key	= (uint64_t)(uintptr_t)&key;
+
+	//Delete, not found is ok
+	return bpf(BPF_MAP_DELETE_ELEM, attr)==0;
+}
+
+#endif
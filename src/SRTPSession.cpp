@@ -178,4 +178,56 @@ size_t SRTPSession::UnprotectRTCP(uint8_t* data, size_t size)
 	return err == Status::OK && len > 0 ? static_cast<size_t>(len) : 0;
 }
 
+template <typename Function>
+size_t SRTPSession::Process(Function&& function, iovec* packets, size_t count)
+{
+	size_t processed = 0;
+	Status last = Status::OK;
+	
+	//Process all packets back to back so the cipher context stays hot on cache
+	for (size_t i = 0; i<count; ++i)
+	{
+		int len = packets[i].iov_len;
+		//Protect or unprotect it
+		err = (Status)function(srtp,(uint8_t*)packets[i].iov_base,&len);
+		//Check result
+		if (err==Status::OK && len>0)
+		{
+			//Update size
+			packets[i].iov_len = len;
+			processed++;
+		} else {
+			//Mark as failed and keep error
+			packets[i].iov_len = 0;
+			last = err;
+		}
+	}
+	//Report last error if any
+	err = last;
+	
+	return processed;
+}
+
+size_t SRTPSession::ProtectRTP(iovec* packets, size_t count)
+{
+	TRACE_EVENT("srtp", "SRTPSession::ProtectRTP", "count", count);
+	return Process(srtp_protect, packets, count);
+}
 
+size_t SRTPSession::ProtectRTCP(iovec* packets, size_t count)
+{
+	TRACE_EVENT("srtp", "SRTPSession::ProtectRTCP", "count", count);
+	return Process(srtp_protect_rtcp, packets, count);
+}
+
+size_t SRTPSession::UnprotectRTP(iovec* packets, size_t count)
+{
+	TRACE_EVENT("srtp", "SRTPSession::UnprotectRTP", "count", count);
+	return Process(srtp_unprotect, packets, count);
+}
+
+size_t SRTPSession::UnprotectRTCP(iovec* packets, size_t count)
+{
+	TRACE_EVENT("srtp", "SRTPSession::UnprotectRTCP", "count", count);
+	return Process(srtp_unprotect_rtcp, packets, count);
+}
@@ -0,0 +1,77 @@
+#include "ScaledFrameCache.h"
+#include "log.h"
+
+#include <algorithm>
+#include <limits>
+
+//Entry with nothing resized yet
+constexpr QWORD NoFrame = std::numeric_limits<QWORD>::max();
+
+BYTE* ScaledFrameCache::Get(QWORD frameNum, BYTE* frame, DWORD width, DWORD height, DWORD dstWidth, DWORD dstHeight, bool keepAspectRatio)
+{
+	//Check sizes
+	if (!frame || !width || !height || !dstWidth || !dstHeight)
+		return nullptr;
+
+	//If it is a newer frame
+	if (frameNum>current)
+	{
+		//Remove sizes that were not requested for the previous frame
+		entries.erase(std::remove_if(entries.begin(), entries.end(), [&](const auto& entry) {
+			return entry->frameNum<previous;
+		}), entries.end());
+		//Move on
+		previous = current;
+		current = frameNum;
+	}
+
+	//Find size
+	auto it = std::find_if(entries.begin(), entries.end(), [&](const auto& entry) {
+		return entry->width==dstWidth && entry->height==dstHeight && entry->keepAspectRatio==keepAspectRatio;
+	});
+
+	//If not found
+	if (it==entries.end())
+	{
+		//Create new one
+		auto entry = std::make_unique<Entry>();
+		entry->width		= dstWidth;
+		entry->height		= dstHeight;
+		entry->keepAspectRatio	= keepAspectRatio;
+		entry->frameNum		= NoFrame;
+		entry->buffer.resize(dstWidth*dstHeight*3/2);
+		//Add it
+		it = entries.insert(entries.end(), std::move(entry));
+	}
+
+	auto& entry = *it;
+	//If already resized
+	if (entry->frameNum==frameNum)
+	{
+		//Reuse it
+		hits++;
+		return entry->buffer.data();
+	}
+
+	//Resize it
+	if (!entry->scaler.Resize(frame, width, height, entry->buffer.data(), dstWidth, dstHeight, keepAspectRatio))
+	{
+		//Don't keep it
+		entries.erase(it);
+		//Error
+		return nullptr;
+	}
+
+	//Done
+	entry->frameNum = frameNum;
+	misses++;
+	return entry->buffer.data();
+}
+
+void ScaledFrameCache::Clear()
+{
+	//Remove all
+	entries.clear();
+	current = 0;
+	previous = 0;
+}
@@ -0,0 +1,215 @@
+#include "VideoEncoderGroup.h"
+#include "videomixer.h"
+#include "log.h"
+
+#include <algorithm>
+
+VideoEncoderGroup::VideoEncoderGroup(VideoMixer& mixer, int mosaicId, const std::vector<int>& bitrates, int intraPeriod, const Properties& properties) :
+	mixer(mixer),
+	mosaicId(mosaicId),
+	bitrates(bitrates),
+	intraPeriod(intraPeriod),
+	properties(properties)
+{
+	//Keep tiers ordered
+	std::sort(this->bitrates.begin(),this->bitrates.end());
+}
+
+VideoEncoderGroup::~VideoEncoderGroup()
+{
+	//Stop all encoders
+	End();
+}
+
+int VideoEncoderGroup::GetTierBitrate(int bitrate) const
+{
+	//If there are no tiers
+	if (bitrates.empty())
+		//Use requested one
+		return bitrate;
+	//Get first tier bigger than the requested bitrate
+	auto it = std::upper_bound(bitrates.begin(),bitrates.end(),bitrate);
+	//If all of them are bigger use the lowest one, otherwise the previous one
+	return it==bitrates.begin() ? *it : *std::prev(it);
+}
+
+bool VideoEncoderGroup::AddListener(const MediaFrame::Listener::shared& listener, VideoCodec::Type codec, int width, int height, int fps, int bitrate)
+{
+	//Check
+	if (!listener)
+		return false;
+
+	//Get tier
+	Tier tier = {codec,width,height,fps,GetTierBitrate(bitrate)};
+
+	Debug("-VideoEncoderGroup::AddListener() [mosaic:%d,codec:%s,width:%d,height:%d,fps:%d,bitrate:%d,tier:%d]\n",mosaicId,VideoCodec::GetNameFor(codec),width,height,fps,bitrate,tier.bitrate);
+
+	//Lock
+	ScopedLock lock(mutex);
+
+	//If it was already added
+	if (tiers.find(listener)!=tiers.end())
+		return Warning("-VideoEncoderGroup::AddListener() | Listener already added [mosaic:%d]\n",mosaicId);
+
+	//Find encoder for tier
+	auto it = encoders.find(tier);
+
+	//If not found
+	if (it==encoders.end())
+	{
+		//Create new encoder
+		auto encoder = std::make_unique<Encoder>();
+		//Init input
+		encoder->input.Init();
+
+		//Get mosaic frames on it
+		if (!mixer.AddMosaicInput(mosaicId,&encoder->input))
+		{
+			//Clean it
+			encoder->input.End();
+			return Error("-VideoEncoderGroup::AddListener() | Could not add mosaic input [mosaic:%d]\n",mosaicId);
+		}
+
+		//Set it up
+		encoder->worker.Init(&encoder->input);
+		encoder->worker.SetVideoCodec(codec,width,height,fps,tier.bitrate,intraPeriod,properties);
+
+		//Start encoding
+		if (!encoder->worker.Start())
+		{
+			//Clean it
+			Release(*encoder);
+			return Error("-VideoEncoderGroup::AddListener() | Could not start encoder [mosaic:%d]\n",mosaicId);
+		}
+
+		//Add it
+		it = encoders.emplace(tier,std::move(encoder)).first;
+	} else {
+		//Request an intra frame so the new listener can start decoding
+		it->second->worker.SendFPU();
+	}
+
+	//Add listener
+	it->second->listeners.insert(listener);
+	it->second->worker.AddListener(listener);
+	tiers[listener] = tier;
+
+	//Done
+	return true;
+}
+
+bool VideoEncoderGroup::RemoveListener(const MediaFrame::Listener::shared& listener)
+{
+	//Lock
+	ScopedLock lock(mutex);
+
+	//Find tier of listener
+	auto it = tiers.find(listener);
+	//If not found
+	if (it==tiers.end())
+		return false;
+
+	//Find encoder
+	auto encoder = encoders.find(it->second);
+	//Remove listener
+	tiers.erase(it);
+
+	//Should not happen
+	if (encoder==encoders.end())
+		return false;
+
+	//Remove from encoder
+	encoder->second->worker.RemoveListener(listener);
+	encoder->second->listeners.erase(listener);
+
+	//If it was the last one
+	if (encoder->second->listeners.empty())
+	{
+		Debug("-VideoEncoderGroup::RemoveListener() | Stopping encoder with no listeners [mosaic:%d,bitrate:%d]\n",mosaicId,encoder->first.bitrate);
+		//Stop it
+		Release(*encoder->second);
+		//Remove it
+		encoders.erase(encoder);
+	}
+
+	//Done
+	return true;
+}
+
+void VideoEncoderGroup::SendFPU(const MediaFrame::Listener::shared& listener)
+{
+	//Lock
+	ScopedLock lock(mutex);
+
+	//Find tier of listener
+	auto it = tiers.find(listener);
+	//If not found
+	if (it==tiers.end())
+		return;
+
+	//Find encoder
+	auto encoder = encoders.find(it->second);
+	//If found
+	if (encoder!=encoders.end())
+		//Request it, all the requests of the tier are coalesced by the worker
+		encoder->second->worker.SendFPU();
+}
+
+bool VideoEncoderGroup::GetTier(const MediaFrame::Listener::shared& listener, Tier& tier)
+{
+	//Lock
+	ScopedLock lock(mutex);
+
+	//Find tier of listener
+	auto it = tiers.find(listener);
+	//If not found
+	if (it==tiers.end())
+		return false;
+
+	//Copy it
+	tier = it->second;
+
+	//Found
+	return true;
+}
+
+DWORD VideoEncoderGroup::GetNumEncoders()
+{
+	//Lock
+	ScopedLock lock(mutex);
+	//Number of tiers in use
+	return encoders.size();
+}
+
+DWORD VideoEncoderGroup::GetNumListeners()
+{
+	//Lock
+	ScopedLock lock(mutex);
+	//Number of viewers
+	return tiers.size();
+}
+
+void VideoEncoderGroup::End()
+{
+	//Lock
+	ScopedLock lock(mutex);
+
+	//For each encoder
+	for (auto& [tier,encoder] : encoders)
+		//Stop it
+		Release(*encoder);
+
+	//Clean all
+	encoders.clear();
+	tiers.clear();
+}
+
+void VideoEncoderGroup::Release(Encoder& encoder)
+{
+	//Stop getting frames from the mixer, it may have been already removed with the mosaic
+	mixer.RemoveMosaicInput(mosaicId,&encoder.input);
+	//Stop encoding, cancels the grab on the input
+	encoder.worker.End();
+	//End input
+	encoder.input.End();
+}
@@ -10,6 +10,30 @@
 #include "tools.h"
 #include "acumulator.h"
 #include "VideoCodecFactory.h"
+#include "framescaler.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <memory>
+
+//Min time between intra frames requested by the listeners, in ms
+constexpr QWORD MinFPUInterval = 100;
+
+//Encoder state of each rendition
+struct RenditionOutput
+{
+	RenditionOutput(const VideoEncoderWorker::Rendition& rendition) : rendition(rendition) {}
+
+	VideoEncoderWorker::Rendition rendition;
+	std::unique_ptr<VideoEncoder> encoder;
+	//Current target bitrate
+	int current = 0;
+	Acumulator<> bitrateAcu{1000};
+	FrameScaler scaler;
+	std::vector<BYTE> buffer;
+	//Last encoded frame, owned by the encoder
+	VideoFrame* frame = nullptr;
+};
 
 VideoEncoderWorker::VideoEncoderWorker() 
 {
@@ -49,6 +73,7 @@ int VideoEncoderWorker::SetVideoCodec(VideoCodec::Type codec, int width, int hei
 		return Error("Wrong size\n");
 	
 	//Store parameters
+	this->renditions.clear();
 	this->codec	  = codec;
 	this->width	  = width;
 	this->height	  = height;
@@ -65,6 +90,40 @@ int VideoEncoderWorker::SetVideoCodec(VideoCodec::Type codec, int width, int hei
 	return 1;
 }
 
+int VideoEncoderWorker::SetVideoCodec(VideoCodec::Type codec, const Renditions& renditions, int fps,int intraPeriod, const Properties& properties)
+{
+	//Check
+	if (renditions.empty())
+		//Error
+		return Error("-VideoEncoderWorker::SetVideoCodec() | No renditions\n");
+
+	//Capture at the biggest size so the others are only downscaled
+	auto biggest = std::max_element(renditions.begin(),renditions.end(),[](const auto& a, const auto& b){
+		return a.width*a.height < b.width*b.height;
+	});
+
+	//For each rendition
+	for (const auto& rendition : renditions)
+	{
+		Log("-VideoEncoderWorker::SetVideoCodec() | Rendition [id:%u,width:%d,height:%d,bitrate:%d]\n",rendition.id,rendition.width,rendition.height,rendition.bitrate);
+		//Check size, must be even so the scaled I420 picture is width*height*3/2
+		if (!rendition.width || !rendition.height || !rendition.bitrate || rendition.width%2 || rendition.height%2)
+			//Error
+			return Error("Wrong rendition [id:%u]\n",rendition.id);
+	}
+
+	//Set common parameters for the biggest one
+	if (!SetVideoCodec(codec,biggest->width,biggest->height,fps,biggest->bitrate,intraPeriod,properties))
+		//Error
+		return 0;
+
+	//Store them
+	this->renditions = renditions;
+
+	//Good
+	return 1;
+}
+
 int VideoEncoderWorker::Start()
 {
 	Log("-VideoEncoderWorker::Start()\n");
@@ -149,39 +208,131 @@ int VideoEncoderWorker::Encode()
 	DWORD num = 0;
 	QWORD overslept = 0;
 
-	Acumulator bitrateAcu(1000);
 	Acumulator fpsAcu(1000);
 
-	Log(">VideoEncoderWorker::Encode() [width:%d,size:%d,bitrate:%d,fps:%d,intra:%d]\n",width,height,bitrate,fps,intraPeriod);
-
-	//Creamos el encoder
-	VideoEncoder* videoEncoder = VideoCodecFactory::CreateEncoder(codec,properties);
-
-	//Comprobamos que se haya creado correctamente
-	if (videoEncoder == NULL)
-		//error
-		return Error("Can't create video encoder\n");
+	Log(">VideoEncoderWorker::Encode() [width:%d,size:%d,bitrate:%d,fps:%d,intra:%d,renditions:%d]\n",width,height,bitrate,fps,intraPeriod,(int)renditions.size());
 
 	//Comrpobamos que tengamos video de entrada
 	if (input == NULL)
 		return Error("No video input");
 
+	//If not encoding renditions, encode grabbed frames as they are
+	bool scale = !renditions.empty();
+	//Total bitrate for sharing the temporal limits
+	DWORD totalBitrate = 0;
+
+	//One output for each rendition
+	std::vector<std::unique_ptr<RenditionOutput>> outputs;
+	//If none
+	if (!scale)
+		//Only one
+		outputs.push_back(std::make_unique<RenditionOutput>(Rendition{0,width,height,(int)bitrate}));
+	else
+		//Create them
+		for (const auto& rendition : renditions)
+			outputs.push_back(std::make_unique<RenditionOutput>(rendition));
+
+	//For each one
+	for (auto& output : outputs)
+	{
+		//Creamos el encoder
+		output->encoder.reset(VideoCodecFactory::CreateEncoder(codec,properties));
+
+		//Comprobamos que se haya creado correctamente
+		if (!output->encoder)
+			//error
+			return Error("Can't create video encoder\n");
+
+		//Start at 80%
+		output->current = output->rendition.bitrate*0.8;
+
+		//Send at higher bitrate first frame, but skip frames after that so sending bitrate is kept
+		output->encoder->SetFrameRate(fps,output->current*5,intraPeriod);
+
+		//Iniciamos el tamama�o del encoder
+		output->encoder->SetSize(output->rendition.width,output->rendition.height);
+
+		//Add bitrate
+		totalBitrate += output->rendition.bitrate;
+	}
+
 	//Iniciamos el tama�o del video
 	if (!input->StartVideoCapture(width,height,fps))
 		return Error("Couldn't set video capture\n");
 
-	//Start at 80%
-	int current = bitrate*0.8;
-
-	//Send at higher bitrate first frame, but skip frames after that so sending bitrate is kept
-	videoEncoder->SetFrameRate(fps,current*5,intraPeriod);
-
 	//No wait for first
 	QWORD frameTime = 0;
 
-	//Iniciamos el tamama�o del encoder
- 	videoEncoder->SetSize(width,height);
+	//Grabbed picture
+	VideoBuffer pic;
 	
+	//Scale and encode each rendition
+	std::vector<WorkerPool::Task> tasks;
+	for (auto& output : outputs)
+		tasks.push_back([&,output=output.get()](){
+			//Calculate target bitrate
+			int target = output->current;
+
+			//Check temporal limits for estimations
+			if (output->bitrateAcu.IsInWindow())
+			{
+				//Get real sent bitrate during last second and convert to kbits
+				DWORD instant = output->bitrateAcu.GetInstantAvg()/1000;
+				//If we are in quarentine
+				if (bitrateLimitCount)
+					//Limit sending bitrate, sharing it between all the renditions
+					target = (QWORD)bitrateLimit*output->rendition.bitrate/totalBitrate;
+				//Check if sending below limits
+				else if (instant<(DWORD)output->rendition.bitrate)
+					//Increase a 8% each second or fps kbps
+					target += (DWORD)(target*0.08/fps)+1;
+			}
+
+			//Check target bitrate agains max conf bitrate
+			if (target>output->rendition.bitrate*1.2)
+				//Set limit to max bitrate allowing a 20% overflow so instant bitrate can get closer to target
+				target = output->rendition.bitrate*1.2;
+
+			//Check if we have a new bitrate
+			if (target && target!=output->current)
+			{
+				//Reset bitrate
+				output->encoder->SetFrameRate(fps,target,intraPeriod);
+				//Upate current
+				output->current = target;
+			}
+
+			//Get picture to encode
+			BYTE* buffer = pic.buffer;
+			DWORD size = pic.GetBufferSize();
+
+			//If it has to be scaled
+			if (scale && (pic.width!=(DWORD)output->rendition.width || pic.height!=(DWORD)output->rendition.height))
+			{
+				//Get scaled size
+				size = output->rendition.width*output->rendition.height*3/2;
+				//Ensure we have space for it
+				output->buffer.resize(size);
+				//Scale from the grabbed picture
+				if (!output->scaler.Resize(pic.buffer,pic.width,pic.height,output->buffer.data(),output->rendition.width,output->rendition.height))
+				{
+					//Nothing encoded
+					output->frame = nullptr;
+					return;
+				}
+				//Encode scaled one
+				buffer = output->buffer.data();
+			}
+
+			//Procesamos el frame
+			output->frame = output->encoder->EncodeFrame(buffer,size);
+		});
+
+	//Encode renditions in parallel, this thread runs one of them
+	std::unique_ptr<WorkerPool> pool;
+	if (tasks.size()>1)
+		pool = std::make_unique<WorkerPool>(tasks.size()-1);
+
 	//The time of the first one
 	gettimeofday(&first,NULL);
 
@@ -195,89 +346,55 @@ int VideoEncoderWorker::Encode()
 	while(encoding)
 	{
 		//Capture video frame buffer
-		auto pic = input->GrabFrame(frameTime/1000);
+		pic = input->GrabFrame(frameTime/1000);
 
 		//Check picture
 		if (!pic.buffer)
 			//Exit
 			continue;
 		
-		//Check size
-		if (pic.width!=width || pic.height!=height)
+		//Check size when encoding it as it is
+		if (!scale && (pic.width!=width || pic.height!=height))
 		{
-			//Check
-			if (videoEncoder)
-				//Borramos el encoder
-				delete videoEncoder;
+			auto& output = outputs.front();
 			//Update size
 			width	= pic.width;
 			height	= pic.height;
+			output->rendition.width  = width;
+			output->rendition.height = height;
 			//Create encoder again
-			videoEncoder = VideoCodecFactory::CreateEncoder(codec,properties);
+			output->encoder.reset(VideoCodecFactory::CreateEncoder(codec,properties));
 			//Reset bitrate
-			videoEncoder->SetFrameRate(fps,current,intraPeriod);
+			output->encoder->SetFrameRate(fps,output->current,intraPeriod);
 			//Set on the encoder
-			videoEncoder->SetSize(width,height);
+			output->encoder->SetSize(width,height);
 		}
 
-		//Check if we need to send intra
-		if (sendFPU)
+		//Check if we need to send intra, requests received before the min interval are kept pending and coalesced on a single one
+		if (sendFPU && getDifTime(&lastFPU)/1000>=MinFPUInterval)
 		{
 			//Do not send anymore
 			sendFPU = false;
-			//Do not send if just send one (100ms)
-			if (getDifTime(&lastFPU)/100>100)
-			{
-				//Set it
-				videoEncoder->FastPictureUpdate();
-				//Update last FPU
-				getUpdDifTime(&lastFPU);
-			}
+			//Set it on all renditions
+			for (auto& output : outputs)
+				output->encoder->FastPictureUpdate();
+			//Update last FPU
+			getUpdDifTime(&lastFPU);
 		}
-		//Calculate target bitrate
-		int target = current;
 
-		//Check temporal limits for estimations
-		if (bitrateAcu.IsInWindow())
-		{
-			//Get real sent bitrate during last second and convert to kbits
-			DWORD instant = bitrateAcu.GetInstantAvg()/1000;
-			//If we are in quarentine
-			if (bitrateLimitCount)
-				//Limit sending bitrate
-				target = bitrateLimit;
-			//Check if sending below limits
-			else if (instant<bitrate)
-				//Increase a 8% each second or fps kbps
-				target += (DWORD)(target*0.08/fps)+1;
-		}
-
-		//Check target bitrate agains max conf bitrate
-		if (target>bitrate*1.2)
-			//Set limit to max bitrate allowing a 20% overflow so instant bitrate can get closer to target
-			target = bitrate*1.2;
+		//Encode all renditions
+		if (pool)
+			pool->Run(tasks);
+		else
+			tasks.front()();
 
 		//Check limits counter
 		if (bitrateLimitCount>0)
 			//One frame less of limit
 			bitrateLimitCount--;
 
-		//Check if we have a new bitrate
-		if (target && target!=current)
-		{
-			//Reset bitrate
-			videoEncoder->SetFrameRate(fps,target,intraPeriod);
-			//Upate current
-			current = target;
-		}
-
-		
-
-		//Procesamos el frame
-		VideoFrame *videoFrame = videoEncoder->EncodeFrame(pic.buffer,pic.GetBufferSize());
-
-		//If was failed
-		if (!videoFrame)
+		//If all were failed
+		if (std::none_of(outputs.begin(),outputs.end(),[](const auto& output){ return output->frame; }))
 			//Next
 			continue;
 
@@ -326,24 +443,34 @@ int VideoEncoderWorker::Encode()
 			//Set frame time, slower
 			frameTime = 5*1E6/fps;
 			//Restore frame rate
-			videoEncoder->SetFrameRate(fps,current,intraPeriod);
+			for (auto& output : outputs)
+				output->encoder->SetFrameRate(fps,output->current,intraPeriod);
 		} else {
 			//Set frame time
 			frameTime = 1E6/fps;
 		}
 
-		//Add frame size in bits to bitrate calculator
-	        bitrateAcu.Update(getDifTime(&first)/1000,videoFrame->GetLength()*8);
-
-		//Set clock rate
-		videoFrame->SetClockRate(90000);
-		//Get now
+		//Get now, same for all renditions
 		auto now = getDifTime(&first)/1000;
-		//Set frame timestamp
-		videoFrame->SetTimestamp(now*90);
-		videoFrame->SetTime(now);
-		//Set dudation
-		videoFrame->SetDuration(frameTime*90000/1E6);
+
+		//For each encoded rendition
+		for (auto& output : outputs)
+		{
+			VideoFrame* videoFrame = output->frame;
+			//If was failed
+			if (!videoFrame)
+				//Next
+				continue;
+			//Add frame size in bits to bitrate calculator
+			output->bitrateAcu.Update(now,videoFrame->GetLength()*8);
+			//Set clock rate
+			videoFrame->SetClockRate(90000);
+			//Set frame timestamp
+			videoFrame->SetTimestamp(now*90);
+			videoFrame->SetTime(now);
+			//Set dudation
+			videoFrame->SetDuration(frameTime*90000/1E6);
+		}
 		
 		//Lock
 		pthread_mutex_lock(&mutex);
@@ -351,10 +478,23 @@ int VideoEncoderWorker::Encode()
 		//For each listener
 		for (auto &listener : listeners)
 		{
-			//If was not null
-			if (listener)
+			//If was null
+			if (!listener)
+				//Skip
+				continue;
+			//For each encoded rendition
+			for (auto& output : outputs)
+			{
+				//If was failed
+				if (!output->frame)
+					//Next
+					continue;
 				//Call listener
-				listener->onMediaFrame(*videoFrame);
+				if (scale)
+					listener->onMediaFrame(output->rendition.id,*output->frame);
+				else
+					listener->onMediaFrame(*output->frame);
+			}
 		}
 
 		//unlock
@@ -362,41 +502,23 @@ int VideoEncoderWorker::Encode()
 
 		//Set sending time of previous frame
 		getUpdDifTime(&prev);
-		
-		//Calculate sending times based on bitrate
-		DWORD sendingTime = videoFrame->GetLength()*8/current;
-
-		//Adjust to maximum time
-		if (sendingTime>frameTime/1000)
-			//Cap it
-			sendingTime = frameTime/1000;
-
-//                //If it was a I frame
-//                if (videoFrame->IsIntra())
-//			//Clean rtp rtx buffer
-//			FlushRTXPackets();
-//
-//		//Send it smoothly
-//		SmoothFrame(videoFrame,sendingTime);
 
 		//Dump statistics
 		if (num && ((num%fps*10)==0))
 		{
-			//Debug("-Send bitrate current=%d avg=%llf rate=[%llf,%llf] fps=[%llf,%llf] limit=%d\n",current,bitrateAcu.GetInstantAvg()/1000,bitrateAcu.GetMinAvg()/1000,bitrateAcu.GetMaxAvg()/1000,fpsAcu.GetMinAvg(),fpsAcu.GetMaxAvg(),bitrateLimit);
-			bitrateAcu.ResetMinMax();
+			for (auto& output : outputs)
+				output->bitrateAcu.ResetMinMax();
 			fpsAcu.ResetMinMax();
 		}
 		num++;
 	}
 
+	//Stop workers
+	pool.reset();
+
 	//Terminamos de capturar
 	input->StopVideoCapture();
 
-	//Check
-	if (videoEncoder)
-		//Borramos el encoder
-		delete videoEncoder;
-
 	//Salimos
 	Log("<VideoEncoderWorker::Encode()  [%d]\n",encoding);
 	
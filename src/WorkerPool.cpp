@@ -0,0 +1,84 @@
+#include "WorkerPool.h"
+#include "EventLoop.h"
+#include "log.h"
+
+WorkerPool::WorkerPool(DWORD numWorkers)
+{
+	//Start workers
+	for (DWORD i=0; i<numWorkers; ++i)
+	{
+		workers.emplace_back([this](){ Loop(); });
+		//Name it
+		EventLoop::SetThreadName(workers.back().native_handle(), "worker-" + std::to_string(i));
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		//Stop all
+		stopping = true;
+	}
+	//Wake up workers
+	pending.notify_all();
+	//Wait for them
+	for (auto& worker : workers)
+		worker.join();
+}
+
+void WorkerPool::Run(std::vector<Task>& tasks)
+{
+	//Nothing to do
+	if (tasks.empty())
+		return;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	//Set batch
+	this->tasks = &tasks;
+	next = 0;
+	remaining = tasks.size();
+	//Wake up workers
+	pending.notify_all();
+	//Help them
+	while (RunNext(lock))
+		;
+	//Wait for the ones still running on the workers
+	finished.wait(lock, [this](){ return !remaining; });
+	//Done
+	this->tasks = nullptr;
+}
+
+bool WorkerPool::RunNext(std::unique_lock<std::mutex>& lock)
+{
+	//Check if there is any task left
+	if (!tasks || next>=tasks->size())
+		return false;
+	//Get it
+	auto& task = (*tasks)[next++];
+	//Run it without the lock
+	lock.unlock();
+	task();
+	lock.lock();
+	//If it was the last one
+	if (!--remaining)
+		//Wake up caller
+		finished.notify_all();
+	return true;
+}
+
+void WorkerPool::Loop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		//Wait for tasks
+		pending.wait(lock, [this](){ return stopping || (tasks && next<tasks->size()); });
+		//If we are done
+		if (stopping)
+			break;
+		//Run all we can
+		while (RunNext(lock))
+			;
+	}
+}
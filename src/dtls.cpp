@@ -562,7 +562,7 @@ void DTLSConnection::Reset()
 	Log("-DTLSConnection::Reset()\n");
 
 	//Run in event loop thread
-	timeService.Async([this](auto now){
+	timeService.Post([this](auto now){
 		Stop();
 		connection = CONNECTION_NEW;
 	});
@@ -4,6 +4,7 @@
 #include "asymmetricmosaic.h"
 #include "pipmosaic.h"
 #include <stdexcept>
+#include <algorithm>
 #include <vector>
 #include <map>
 #include <string.h>
@@ -586,6 +587,18 @@ BYTE* Mosaic::GetFrame()
 	return overlay.GetOverlay();
 }
 
+void Mosaic::AddComposeStats(QWORD time,DWORD updated,DWORD skipped)
+{
+	//One more
+	stats.composed++;
+	//Update times
+	stats.composeTime = time;
+	stats.maxComposeTime = std::max(stats.maxComposeTime,time);
+	//Add slots
+	stats.updatedSlots += updated;
+	stats.skippedSlots += skipped;
+}
+
 void Mosaic::Reset()
 {
 	//Not changed anymore
@@ -706,7 +706,7 @@ bool MP4Recorder::Record(bool waitVideo, bool disableHints)
 	this->disableHints = disableHints;
 	
 	//Run in thread
-	loop.Async([=](auto now){
+	loop.Post([=](auto now){
 		//Recording
 		recording = true;
 
@@ -728,7 +728,7 @@ bool MP4Recorder::Stop()
 	Log("-MP4Recorder::Stop()\n");
 	
 	//Signal async	
-	loop.Async([=](auto now){
+	loop.Post([=](auto now){
 		//not recording anymore
 		recording = false;
 	});
@@ -804,7 +804,7 @@ void MP4Recorder::onMediaFrame(DWORD ssrc, const MediaFrame &frame)
 {
 	
 	//run async	
-	loop.Async([=,cloned = frame.Clone()](auto now){
+	loop.Post([=,cloned = frame.Clone()](auto now){
 		//Check we are recording
 		if (recording) 
 		{
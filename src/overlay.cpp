@@ -5,6 +5,10 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 extern "C" {
 #include <libswscale/swscale.h>
 #include <libavcodec/avcodec.h>
@@ -18,6 +22,85 @@ extern "C" {
 #endif
 #include "utf8.h"
 
+//Width in pixels of the overlay tiles checked for transparency
+constexpr DWORD TileSize = 16;
+
+static inline BYTE Blend(DWORD o, DWORD s, DWORD a)
+{
+	DWORD t = o*a + s*(255-a);
+	//Same as t/255 for t<=255*255
+	return (t + 1 + (t>>8)) >> 8;
+}
+
+#ifdef __SSE2__
+static inline __m128i Blend(__m128i o, __m128i s, __m128i a)
+{
+	//Same as the scalar one on 8 words
+	__m128i t = _mm_add_epi16(_mm_mullo_epi16(o,a),_mm_mullo_epi16(s,_mm_sub_epi16(_mm_set1_epi16(255),a)));
+	return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(t,_mm_set1_epi16(1)),_mm_srli_epi16(t,8)),8);
+}
+#endif
+
+static void BlendLuma(BYTE* dst, const BYTE* src, const BYTE* ovr, const BYTE* alpha, DWORD num)
+{
+	DWORD i = 0;
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+	//16 pixels at a time
+	for (; i+16<=num; i+=16)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i*)(src+i));
+		__m128i o = _mm_loadu_si128((const __m128i*)(ovr+i));
+		__m128i a = _mm_loadu_si128((const __m128i*)(alpha+i));
+		__m128i lo = Blend(_mm_unpacklo_epi8(o,zero),_mm_unpacklo_epi8(s,zero),_mm_unpacklo_epi8(a,zero));
+		__m128i hi = Blend(_mm_unpackhi_epi8(o,zero),_mm_unpackhi_epi8(s,zero),_mm_unpackhi_epi8(a,zero));
+		_mm_storeu_si128((__m128i*)(dst+i),_mm_packus_epi16(lo,hi));
+	}
+#endif
+	//Remaining ones
+	for (; i<num; ++i)
+		dst[i] = Blend(ovr[i],src[i],alpha[i]);
+}
+
+static void BlendChroma(BYTE* dstU, BYTE* dstV, const BYTE* srcU, const BYTE* srcV, const BYTE* ovrU, const BYTE* ovrV, const BYTE* alpha1, const BYTE* alpha2, DWORD num)
+{
+	DWORD i = 0;
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i mask = _mm_set1_epi16(0x00FF);
+	//8 pixels at a time, 16 alpha values on each line
+	for (; i+8<=num; i+=8)
+	{
+		__m128i a1 = _mm_loadu_si128((const __m128i*)(alpha1+i*2));
+		__m128i a2 = _mm_loadu_si128((const __m128i*)(alpha2+i*2));
+		//Average the 2x2 alpha values of each chroma pixel
+		__m128i sum = _mm_add_epi16(
+			_mm_add_epi16(_mm_and_si128(a1,mask),_mm_srli_epi16(a1,8)),
+			_mm_add_epi16(_mm_and_si128(a2,mask),_mm_srli_epi16(a2,8))
+		);
+		__m128i a = _mm_srli_epi16(_mm_add_epi16(sum,_mm_set1_epi16(2)),2);
+		__m128i u = Blend(
+			_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(ovrU+i)),zero),
+			_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(srcU+i)),zero),
+			a
+		);
+		__m128i v = Blend(
+			_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(ovrV+i)),zero),
+			_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(srcV+i)),zero),
+			a
+		);
+		_mm_storel_epi64((__m128i*)(dstU+i),_mm_packus_epi16(u,u));
+		_mm_storel_epi64((__m128i*)(dstV+i),_mm_packus_epi16(v,v));
+	}
+#endif
+	//Remaining ones
+	for (; i<num; ++i)
+	{
+		DWORD a = (alpha1[i*2]+alpha1[i*2+1]+alpha2[i*2]+alpha2[i*2+1]+2)>>2;
+		dstU[i] = Blend(ovrU[i],srcU[i],a);
+		dstV[i] = Blend(ovrV[i],srcV[i],a);
+	}
+}
 
 Canvas::Canvas(DWORD width,DWORD height)
 {
@@ -32,6 +115,8 @@ Canvas::Canvas(DWORD width,DWORD height)
 	memset(overlay,0,overlaySize);
 	//Do not display
 	display = false;
+	//Nothing to blend yet
+	spansNeedUpdate = true;
 }
 
 Overlay::Overlay(DWORD width,DWORD height) : Canvas(width,height)
@@ -206,6 +291,8 @@ int Canvas::LoadPNG(const char* filename)
 	
 	//Display it then
 	display = true;
+	//Overlay changed
+	spansNeedUpdate = true;
 end:
 	if (logo)
 		av_free(logo);
@@ -283,6 +370,8 @@ int Canvas::LoadSVG(const char* svg)
 		
 		//Done
 		display = true;
+		//Overlay changed
+		spansNeedUpdate = true;
 	} catch ( Magick::Exception &error ) {
 		display = false;
 		return Error("-Canvas: failed to load picture file %s: %s.\n", svg, error.what() );
@@ -444,6 +533,8 @@ int Canvas::RenderText(const std::string& utf8,DWORD x,DWORD y,DWORD width,DWORD
 		sws_freeContext(sws);
 		//OK
 		display = true;
+		//Overlay changed
+		spansNeedUpdate = true;
 	} catch ( Magick::Exception &error ) {
 		display = false;
 		return Error("-Canvas: failed to render text: %s: %s.\n", utf8.c_str(), error.what() );
@@ -470,157 +561,81 @@ void Canvas::Reset()
 {
 	//Clean overlay memory
 	memset(overlay,0,overlaySize);
+	//Overlay changed
+	spansNeedUpdate = true;
 }
 
-void Canvas::Draw(BYTE*image,BYTE* frame)
+void Canvas::UpdateSpans()
 {
-	//Get source
-	BYTE* srcY1 = frame;
-	BYTE* srcY2 = frame+width;
-	BYTE* srcU  = frame+width*height;
-	BYTE* srcV  = frame+width*height*5/4;
-	//Get overlay
-	BYTE* ovrY1 = overlay;
-	BYTE* ovrY2 = overlay+width;
-	BYTE* ovrU  = overlay+width*height;
-	BYTE* ovrV  = overlay+width*height*5/4;
-	BYTE* ovrA1 = overlay+width*height*3/2;
-	BYTE* ovrA2 = overlay+width*height*3/2+width;
-	//Get destingation
-	BYTE* dstY1 = image;
-	BYTE* dstY2 = image+width;
-	BYTE* dstU  = image+width*height;
-	BYTE* dstV  = image+width*height*5/4;
-
-	for (int j=0; j<height/2; ++j)
+	//Remove old ones
+	spans.clear();
+	
+	//Get alpha plane
+	const BYTE* alpha = overlay+width*height*3/2;
+	
+	//For each pair of luma lines
+	for (DWORD j=0; j<height/2; ++j)
 	{
-		for (int i=0; i<width/2; ++i)
+		const BYTE* a1 = alpha+j*2*width;
+		const BYTE* a2 = a1+width;
+		//For each tile
+		for (DWORD start=0; start<width; start+=TileSize)
 		{
-			//Get alpha values
-			BYTE a11 = *(ovrA1++);
-			BYTE a12 = *(ovrA1++);
-			BYTE a21 = *(ovrA2++);
-			BYTE a22 = *(ovrA2++);
-			//Check
-			if (a11==0)
-			{
-				//Set alpha
-				*(dstY1++) = *(srcY1++);
-				//Increase pointer
-				++ovrY1;
-			} else if (a11==255) {
-				//Set original image
-				*(dstY1++) = *(ovrY1++);
-				//Increase pointer
-				++srcY1;
-			} else {
-				DWORD n = 255-a11;
-				DWORD oY = *(ovrY1++);
-				DWORD sY = *(srcY1++);
-				*(dstY1++) = (oY*a11+sY*n)/255;
-				//Calculate and move pointer
-				//*(dstY1++) = (((DWORD)(*(ovrY1++)))*a11 + (((DWORD)(*(srcY1++)))*(~a11)))/255;
-			}
-			//Check
-			if (a12==0)
-			{
-				//Set alpha
-				*(dstY1++) = *(srcY1++);
-				//Increase pointer
-				++ovrY1;
-			} else if (a12==255) {
-				//Set original image
-				*(dstY1++) = *(ovrY1++);
-				//Increase pointer
-				++srcY1;
-			} else {
-				DWORD n = 255-a12;
-				DWORD oY = *(ovrY1++);
-				DWORD sY = *(srcY1++);
-				*(dstY1++) = (oY*a12+sY*n)/255;
-				//Calculate and move pointer
-				//*(dstY1++) = (((DWORD)(*(ovrY1++)))*a12 + (((DWORD)(*(srcY1++)))*(~a12)))/255;
-			}
-			//Check
-			if (a21==0)
-			{
-				//Set alpha
-				*(dstY2++) = *(srcY2++);
-				//Increase pointer
-				++ovrY2;
-			} else if (a21==255) {
-				//Set original image
-				*(dstY2++) = *(ovrY2++);
-				//Increase pointer
-				++srcY2;
-			} else {
-				DWORD n = 255-a21;
-				DWORD oY = *(ovrY2++);
-				DWORD sY = *(srcY2++);
-				*(dstY2++) = (oY*a21+sY*n)/255;
-				//Calculate and move pointer
-				//*(dstY2++) = (((DWORD)(*(ovrY2++)))*a21 + (((DWORD)(*(srcY2++)))*(~a21)))/255;
-			}
-			//Check
-			if (a22==0)
-			{
-				//Set alpha
-				*(dstY2++) = *(srcY2++);
-				//Increase pointer
-				++ovrY2;
-			} else if (a22==255) {
-				//Set original image
-				*(dstY2++) = *(ovrY2++);
-				//Increase pointer
-				++srcY2;
-			} else {
-				DWORD n = 255-a22;
-				DWORD oY = *(ovrY2++);
-				DWORD sY = *(srcY2++);
-				*(dstY2++) = (oY*a22+sY*n)/255;
-				//Calculate and move pointer
-				//*(dstY2++) = (((DWORD)(*(ovrY2++)))*a22 + (((DWORD)(*(srcY2++)))*(~a22)))/255;
-			}
-			//Summ all alphas
-			DWORD alpha = a11+a21+a21+a22;
-			//Check UV
-			if (alpha==0)
-			{
-				//Set UV
-				*(dstU++) = *(srcU++);
-				*(dstV++) = *(srcV++);
-				//Increase pointers
-				++ovrU;
-				++ovrV;
-			} else if (alpha == 1020) {
-				//Set UV
-				*(dstU++) = *(ovrU++);
-				*(dstV++) = *(ovrV++);
-				//Increase pointers
-				++srcU;
-				++srcV;
-			} else {
-				DWORD negalpha = 1020-alpha;
-				DWORD oU = *(ovrU++);
-				DWORD oV = *(ovrV++);
-				DWORD sU = *(srcU++);
-				DWORD sV = *(srcV++);
-				*(dstU++) = (oU*alpha+sU*negalpha)/1020;
-				*(dstV++) = (oV*alpha+sV*negalpha)/1020;
-				//Calculate and move pointer
-				//*(dstU++) = (((DWORD)(*(ovrU++)))*alpha + (((DWORD)(*(srcU++)))*negalpha))/1020;
-				//*(dstV++) = (((DWORD)(*(ovrV++)))*alpha + (((DWORD)(*(srcV++)))*negalpha))/1020;
-
-			}
+			DWORD end = std::min(start+TileSize,width);
+			//Check if any pixel is not transparent
+			bool visible = false;
+			for (DWORD i=start; i<end && !visible; ++i)
+				visible = a1[i] || a2[i];
+			//Skip transparent tiles
+			if (!visible)
+				continue;
+			//If it is next to the previous one
+			if (!spans.empty() && spans.back().line==j && spans.back().end==start)
+				//Extend it
+				spans.back().end = end;
+			else
+				//New span
+				spans.push_back({j,start,end});
 		}
-		//Skip Y line
-		srcY1 += width;
-		srcY2 += width;
-		dstY1 += width;
-		dstY2 += width;
-		ovrY1 += width;
-		ovrY2 += width;
-		ovrA1 += width;
-		ovrA2 += width;
+	}
+	
+	//Updated
+	spansNeedUpdate = false;
+}
+
+void Canvas::Draw(BYTE*image,BYTE* frame)
+{
+	//If overlay has changed
+	if (spansNeedUpdate)
+		//Get the tiles to blend again
+		UpdateSpans();
+	
+	DWORD numpixels = width*height;
+	
+	//Copy frame, transparent parts are left untouched
+	memcpy(image,frame,numpixels*3/2);
+	
+	//Get alpha plane
+	const BYTE* alpha = overlay+numpixels*3/2;
+	
+	//Blend only the visible parts
+	for (const auto& span : spans)
+	{
+		//Get positions on both luma lines and chroma line
+		DWORD y1 = span.line*2*width + span.start;
+		DWORD y2 = y1 + width;
+		DWORD c  = span.line*width/2 + span.start/2;
+		DWORD len = span.end - span.start;
+		//Blend luma
+		BlendLuma(image+y1,frame+y1,overlay+y1,alpha+y1,len);
+		BlendLuma(image+y2,frame+y2,overlay+y2,alpha+y2,len);
+		//Blend chroma
+		BlendChroma(
+			image+numpixels+c,	image+numpixels*5/4+c,
+			frame+numpixels+c,	frame+numpixels*5/4+c,
+			overlay+numpixels+c,	overlay+numpixels*5/4+c,
+			alpha+y1,		alpha+y2,
+			len/2
+		);
 	}
 }
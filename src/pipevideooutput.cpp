@@ -50,6 +50,8 @@ int PipeVideoOutput::NextFrame(BYTE *pic)
 
 	//Copiamos
 	memcpy(buffer,pic,bufferSize);
+	//New frame
+	frameNum++;
 	
 	//Release
 	Unlock();
@@ -81,6 +83,8 @@ void PipeVideoOutput::ClearFrame()
 	// paint the background in black for YUV
 	memset(buffer		, 0		, num);
 	memset(buffer+num	, (BYTE) -128	, num/2);
+	//New frame
+	frameNum++;
 	
 	//Release
 	Unlock();
@@ -120,6 +124,8 @@ int PipeVideoOutput::SetVideoSize(int width,int height)
 	bufferSize = (width*height*3)/2;
 	//Get memory
 	buffer = (BYTE*)malloc(bufferSize);
+	//Previous frames are not valid anymore
+	frameNum++;
 
 	//Release
 	Unlock();
@@ -0,0 +1,183 @@
+#include "rtp/RTCPCompoundView.h"
+#include "rtp/RTCPCompoundPacket.h"
+
+void RTCPPacketView::Dump() const
+{
+	//Parse a copy only for dumping it
+	auto rtcp = RTCPCompoundPacket::Parse(data,size);
+	//If parsed
+	if (rtcp)
+		rtcp->Dump();
+}
+
+QWORD RTCPSenderReportView::GetTimestamp() const
+{
+	//Convert to epcoh JAN_1970
+	QWORD ts = GetNTPSec() - 2208988800UL;
+	//convert to microseconds
+	ts *=1E6;
+	//Add fraction
+	ts += GetNTPFrac()/4294.967296;
+	//Return it
+	return ts;
+}
+
+bool RTCPFeedbackView::IsREMB() const
+{
+	//Check it is an application layer feedback with the REMB identifier and the bitrate
+	return GetType()==RTCPPacket::PayloadFeedback
+		&& GetFeedbackType()==RTCPPayloadFeedback::ApplicationLayerFeeedbackMessage
+		&& GetFCISize()>=8
+		&& data[12]=='R' && data[13]=='E' && data[14]=='M' && data[15]=='B';
+}
+
+DWORD RTCPFeedbackView::GetREMBBitrate() const
+{
+	//Get exponent
+	BYTE exp = data[17] >> 2;
+	//Get mantisa
+	DWORD mantisa = get3(data,17) & 0x3FFFF;
+	//Get bitrate
+	return mantisa << exp;
+}
+
+BYTE RTCPFeedbackView::GetREMBSSRCCount() const
+{
+	//Only the ones present
+	return std::min<DWORD>(data[16], (GetFCISize()-8)/4);
+}
+
+bool RTCPCompoundView::IsValid() const
+{
+	//Check if it is an RTCP valid header
+	if (!RTCPCompoundPacket::IsRTCP(data,size))
+		return false;
+
+	DWORD len = 0;
+	//Check all packets
+	while (len<size)
+	{
+		//Check header
+		if (size-len<4)
+			return Warning("-RTCPCompoundView::IsValid() | Wrong rtcp header\n");
+		//Get packet size
+		DWORD packetSize = (get2(data,len+2)+1)*4;
+		//Check len
+		if (packetSize>size-len)
+			return Warning("-RTCPCompoundView::IsValid() | Wrong rtcp packet size [headerLen:%d,bufferLen:%d]\n", packetSize, size-len);
+		//Next
+		len += packetSize;
+	}
+
+	//All good
+	return true;
+}
+
+void RTCPCompoundView::Dump() const
+{
+	//Parse a copy only for dumping it
+	auto rtcp = RTCPCompoundPacket::Parse(data,size);
+	//If parsed
+	if (rtcp)
+		rtcp->Dump();
+}
+
+BYTE* RTCPCompoundBuilder::AddFeedback(RTCPPacket::Type type, BYTE feedbackType, DWORD senderSSRC, DWORD mediaSSRC, DWORD fciSize)
+{
+	//Get packet size
+	DWORD packetSize = 12 + pad32(fciSize);
+	//Check size
+	if (size-len<packetSize)
+		return nullptr;
+
+	//RTCP common header
+	RTCPCommonHeader header;
+	header.count	  = feedbackType;
+	header.packetType = type;
+	header.padding	  = 0;
+	header.length	  = packetSize;
+
+	//Get packet start
+	BYTE* packet = data+len;
+	//Serialize
+	header.Serialize(packet,packetSize);
+	//Set ssrcs
+	set4(packet,4,senderSSRC);
+	set4(packet,8,mediaSSRC);
+	//Clear padding
+	memset(packet+12+fciSize,0,packetSize-12-fciSize);
+	//Add it
+	len += packetSize;
+	//Return fci
+	return packet+12;
+}
+
+bool RTCPCompoundBuilder::AddNACK(DWORD senderSSRC, DWORD mediaSSRC, const RTCPRTPFeedback::NACKField* fields, DWORD num)
+{
+	//Write header
+	BYTE* fci = AddFeedback(RTCPPacket::RTPFeedback,RTCPRTPFeedback::NACK,senderSSRC,mediaSSRC,num*4);
+	//Check size
+	if (!fci)
+		return false;
+	//Write each field
+	for (DWORD i=0;i<num;++i)
+	{
+		set2(fci,i*4,fields[i].pid);
+		set2(fci,i*4+2,fields[i].blp);
+	}
+	return true;
+}
+
+bool RTCPCompoundBuilder::AddPLI(DWORD senderSSRC, DWORD mediaSSRC)
+{
+	//No fci
+	return AddFeedback(RTCPPacket::PayloadFeedback,RTCPPayloadFeedback::PictureLossIndication,senderSSRC,mediaSSRC,0);
+}
+
+bool RTCPCompoundBuilder::AddREMB(DWORD senderSSRC, DWORD bitrate, const DWORD* ssrcs, BYTE num)
+{
+	//Write header, media ssrc is always 0
+	BYTE* fci = AddFeedback(RTCPPacket::PayloadFeedback,RTCPPayloadFeedback::ApplicationLayerFeeedbackMessage,senderSSRC,0,8+num*4);
+	//Check size
+	if (!fci)
+		return false;
+	//Find 18 most significants bits
+	BYTE exp = 0;
+	while (bitrate>>exp > 0x3FFFF)
+		exp++;
+	//Get mantisa
+	DWORD mantisa = bitrate >> exp;
+	//Set id
+	fci[0] = 'R';
+	fci[1] = 'E';
+	fci[2] = 'M';
+	fci[3] = 'B';
+	//Set data
+	fci[4] = num;
+	fci[5] = exp << 2 | (mantisa >>16 & 0x03);
+	fci[6] = mantisa >> 8;
+	fci[7] = mantisa;
+	//Set ssrcs
+	for (BYTE i=0;i<num;++i)
+		set4(fci,8+i*4,ssrcs[i]);
+	return true;
+}
+
+bool RTCPCompoundBuilder::AddTransportWideFeedback(DWORD senderSSRC, DWORD mediaSSRC, const RTCPRTPFeedback::TransportWideFeedbackMessageField& field)
+{
+	//Get size, already padded
+	DWORD fciSize = field.GetSize();
+	//Write header
+	BYTE* fci = AddFeedback(RTCPPacket::RTPFeedback,RTCPRTPFeedback::TransportWideFeedbackMessage,senderSSRC,mediaSSRC,fciSize);
+	//Check size
+	if (!fci)
+		return false;
+	//Serialize field
+	if (field.Serialize(fci,fciSize)!=fciSize)
+	{
+		//Remove it
+		len -= 12 + pad32(fciSize);
+		return Error("-RTCPCompoundBuilder::AddTransportWideFeedback() | Error serializing field\n");
+	}
+	return true;
+}
@@ -365,7 +365,7 @@ DWORD RTPHeaderExtension::Parse(const RTPMap &extMap,const BYTE* data,const DWOR
 	return 4+length;
 }
 
-bool RTPHeaderExtension::ParseDependencyDescriptor(const std::optional<TemplateDependencyStructure>& templateDependencyStructure)
+bool RTPHeaderExtension::ParseDependencyDescriptor(const TemplateDependencyStructure* templateDependencyStructure)
 {
 	//Check we have anything to read
 	if (!dependencyDescryptorReader.Left())
@@ -383,7 +383,22 @@ bool RTPHeaderExtension::ParseDependencyDescriptor(const std::optional<TemplateD
 	return hasDependencyDescriptor;
 }
 
-DWORD RTPHeaderExtension::Serialize(const RTPMap &extMap,BYTE* data,const DWORD size) const
+RTPHeaderExtension::IdMap::IdMap(const RTPMap& extMap) : IdMap()
+{
+	//For each negotiated extension
+	for (const auto& [id,type] : extMap)
+		//Keep first id of each known type, as RTPMap::GetTypeForCodec does
+		if (type<ids.size() && ids[type]==RTPMap::NotFound)
+			ids[type] = id;
+}
+
+DWORD RTPHeaderExtension::Serialize(const RTPMap &extMap,BYTE* data,const DWORD size,Offsets* offsets) const
+{
+	//Compile ids and serialize
+	return Serialize(IdMap(extMap),data,size,offsets);
+}
+
+DWORD RTPHeaderExtension::Serialize(const IdMap &ids,BYTE* data,const DWORD size,Offsets* offsets) const
 {
 	size_t n;
 	
@@ -423,7 +438,7 @@ DWORD RTPHeaderExtension::Serialize(const RTPMap &extMap,BYTE* data,const DWORD
 
 			//Get id for extension
 			//Get id for extension
-			BYTE id = extMap.GetTypeForCodec(DependencyDescriptor);
+			BYTE id = ids.GetId(DependencyDescriptor);
 
 			//Write header 
 			if ((n = WriteHeaderIdAndLength(data,len,id,extLen,headerLength)))
@@ -442,7 +457,7 @@ DWORD RTPHeaderExtension::Serialize(const RTPMap &extMap,BYTE* data,const DWORD
 	if (hasAudioLevel)
 	{
 		//Get id for extension
-		BYTE id = extMap.GetTypeForCodec(SSRCAudioLevel);
+		BYTE id = ids.GetId(SSRCAudioLevel);
 
 		// The payload of the audio level header extension element can be
 		// encoded using either the one-byte or two-byte 
@@ -465,7 +480,7 @@ DWORD RTPHeaderExtension::Serialize(const RTPMap &extMap,BYTE* data,const DWORD
 	if (hasTimeOffset)
 	{
 		//Get id for extension
-		BYTE id = extMap.GetTypeForCodec(TimeOffset);
+		BYTE id = ids.GetId(TimeOffset);
 		//  0                   1                   2                   3
 		//  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
 		// +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
@@ -496,7 +511,7 @@ DWORD RTPHeaderExtension::Serialize(const RTPMap &extMap,BYTE* data,const DWORD
 	if (hasAbsSentTime)
 	{
 		//Get id for extension
-		BYTE id = extMap.GetTypeForCodec(AbsoluteSendTime);
+		BYTE id = ids.GetId(AbsoluteSendTime);
 		
 		//  0                   1                   2                   3
 		//  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
@@ -510,6 +525,9 @@ DWORD RTPHeaderExtension::Serialize(const RTPMap &extMap,BYTE* data,const DWORD
 		{
 			//Inc header len
 			len += n;
+			//Store position
+			if (offsets)
+				offsets->absSentTime = len;
 			//Calculate absolute send time field (convert ms to 24-bit unsigned with 18 bit fractional part.
 			// Encoding: Timestamp is in seconds, 24 bit 6.18 fixed point, yielding 64s wraparound and 3.8us resolution (one increment for each 477 bytes going out on a 1Gbps interface).
 			//Set it
@@ -522,7 +540,7 @@ DWORD RTPHeaderExtension::Serialize(const RTPMap &extMap,BYTE* data,const DWORD
 	if (hasVideoOrientation)
 	{
 		//Get id for extension
-		BYTE id = extMap.GetTypeForCodec(CoordinationOfVideoOrientation);
+		BYTE id = ids.GetId(CoordinationOfVideoOrientation);
 		
 		// Bit#		7   6   5   4   3   2   1  0(LSB)
 		// Definition	0   0   0   0   C   F   R1 R0
@@ -548,7 +566,7 @@ DWORD RTPHeaderExtension::Serialize(const RTPMap &extMap,BYTE* data,const DWORD
 	if (hasTransportWideCC)
 	{
 		//Get id for extension
-		BYTE id = extMap.GetTypeForCodec(TransportWideCC);
+		BYTE id = ids.GetId(TransportWideCC);
 		
 		//  0                   1                   2
 		//  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 
@@ -561,6 +579,9 @@ DWORD RTPHeaderExtension::Serialize(const RTPMap &extMap,BYTE* data,const DWORD
 		{
 			//Inc header len
 			len += n;
+			//Store position
+			if (offsets)
+				offsets->transportSeqNum = len;
 			//Set them
 			set2(data,len,transportSeqNum);
 			//Inc length
@@ -571,7 +592,7 @@ DWORD RTPHeaderExtension::Serialize(const RTPMap &extMap,BYTE* data,const DWORD
 	if (hasFrameMarking)
 	{
 		//Get id for extension
-		BYTE id = extMap.GetTypeForCodec(FrameMarking);
+		BYTE id = ids.GetId(FrameMarking);
 		
 	
 		// For Frame Marking RTP Header Extension:
@@ -636,7 +657,7 @@ DWORD RTPHeaderExtension::Serialize(const RTPMap &extMap,BYTE* data,const DWORD
 	if (hasRId)
 	{
 		//Get id for extension
-		BYTE id = extMap.GetTypeForCodec(RTPStreamId);
+		BYTE id = ids.GetId(RTPStreamId);
 		
 		//Write header 
 		if ((n = WriteHeaderIdAndLength(data,len,id,rid.length(),headerLength)))
@@ -653,7 +674,7 @@ DWORD RTPHeaderExtension::Serialize(const RTPMap &extMap,BYTE* data,const DWORD
 	if (hasRepairedId)
 	{
 		//Get id for extension
-		BYTE id = extMap.GetTypeForCodec(RepairedRTPStreamId);
+		BYTE id = ids.GetId(RepairedRTPStreamId);
 		
 		//Write header 
 		if ((n = WriteHeaderIdAndLength(data,len,id,repairedId.length(),headerLength)))
@@ -670,7 +691,7 @@ DWORD RTPHeaderExtension::Serialize(const RTPMap &extMap,BYTE* data,const DWORD
 	if (hasMediaStreamId)
 	{
 		//Get id for extension
-		BYTE id = extMap.GetTypeForCodec(MediaStreamId);
+		BYTE id = ids.GetId(MediaStreamId);
 		
 		//Write header 
 		if ((n = WriteHeaderIdAndLength(data,len,id,mid.length(),headerLength)))
@@ -687,7 +708,7 @@ DWORD RTPHeaderExtension::Serialize(const RTPMap &extMap,BYTE* data,const DWORD
 	if (hasAbsoluteCaptureTime)
 	{
 		//Get id for extension
-		BYTE id = extMap.GetTypeForCodec(AbsoluteCaptureTime);
+		BYTE id = ids.GetId(AbsoluteCaptureTime);
 
 		//Check length
 		DWORD extLength = absoluteCaptureTime.estimatedCaptureClockOffsetNTP ? 16 : 8;
@@ -69,7 +69,7 @@ void RTPIncomingMediaStreamMultiplexer::onRTP(const RTPIncomingMediaStream* stre
 	if (!muted)
 	{
 		//Dispatch in thread async
-		timeService.Async([=](auto now){
+		timeService.Post([=](auto now){
 			//Deliver to all listeners
 			for (auto listener : listeners)
 				//Dispatch rtp packet
@@ -87,7 +87,7 @@ void RTPIncomingMediaStreamMultiplexer::onRTP(const RTPIncomingMediaStream* stre
 	if (!muted)
 	{
 		//Dispatch in thread async
-		timeService.Async([=,ssrc = stream->GetMediaSSRC()](auto now){
+		timeService.Post([=,ssrc = stream->GetMediaSSRC()](auto now){
 			//Trace method
 			TRACE_EVENT("rtp", "RTPIncomingMediaStreamMultiplexer::onRTP async", "ssrc", ssrc, "packets", packets.size());
 			//For each packet
@@ -107,7 +107,7 @@ void RTPIncomingMediaStreamMultiplexer::onBye(const RTPIncomingMediaStream* stre
 	TRACE_EVENT("rtp", "RTPIncomingMediaStreamMultiplexer::onBye", "ssrc", stream->GetMediaSSRC());
 
 	//Dispatch in thread async
-	timeService.Async([=, ssrc = stream->GetMediaSSRC()](auto now){
+	timeService.Post([=, ssrc = stream->GetMediaSSRC()](auto now){
 		//Trace method
 		TRACE_EVENT("rtp", "RTPIncomingMediaStreamMultiplexer::onBye async", "ssrc", ssrc);
 		//Deliver to all listeners
@@ -239,21 +239,32 @@ void RTPIncomingSource::Update(QWORD now)
 }
 
 void RTPIncomingSource::Process(QWORD now, const RTCPSenderReport::shared& sr)
+{
+	ProcessSenderReport(now, *sr);
+}
+
+void RTPIncomingSource::Process(QWORD now, const RTCPSenderReportView& sr)
+{
+	ProcessSenderReport(now, sr);
+}
+
+template<typename SenderReport>
+void RTPIncomingSource::ProcessSenderReport(QWORD now, const SenderReport& sr)
 {
 	//If first
 	if (!firstReceivedSenderTime)
 	{
 		//Store time
-		firstReceivedSenderTime = sr->GetTimestamp()/1000;
-		firstReceivedSenderTimestamp = sr->GetRTPTimestamp();
+		firstReceivedSenderTime = sr.GetTimestamp()/1000;
+		firstReceivedSenderTimestamp = sr.GetRTPTimestamp();
 		//Debug
 		UltraDebug("-RTPIncomingSource::Process() | Got first Report [ssrc:0x%x,firstTime:%lld,firstTimestamp:%lld]\n", ssrc, firstReceivedSenderTime, firstReceivedSenderTimestamp);
 	}
 
 	//Store info
-	lastReceivedSenderNTPTimestamp = sr->GetNTPTimestamp();
-	lastReceivedSenderTime = sr->GetTimestamp()/1000;
-	lastReceivedSenderRTPTimestampExtender.ExtendOrReset(sr->GetRTPTimestamp());
+	lastReceivedSenderNTPTimestamp = sr.GetNTPTimestamp();
+	lastReceivedSenderTime = sr.GetTimestamp()/1000;
+	lastReceivedSenderRTPTimestampExtender.ExtendOrReset(sr.GetRTPTimestamp());
 	lastReceivedSenderReport = now;
 	
 	//Ensure we have clock rate configured
@@ -266,7 +277,7 @@ void RTPIncomingSource::Process(QWORD now, const RTCPSenderReport::shared& sr)
 		skew = deltaTime - deltaTimestamp;
 		drift = deltaTime ? (double)deltaTimestamp/deltaTime : 1;
 		//Debug
-		UltraDebug("-RTPIncomingSource::Process() | Sender Report [ssrc:0x%x,skew:%lld,deltaTime:%llu,deltaTimestamp:%llu,senderTime:%llu,firstTime:%lld,firstTimestamp:%lld,lastExtSeqNum:%u(%u),clockrate:%u]\n",ssrc,skew,deltaTime,deltaTimestamp,lastReceivedSenderTime, firstReceivedSenderTime, firstReceivedSenderTimestamp, sr->GetRTPTimestamp(), lastReceivedSenderRTPTimestampExtender.GetExtSeqNum(),clockrate);
+		UltraDebug("-RTPIncomingSource::Process() | Sender Report [ssrc:0x%x,skew:%lld,deltaTime:%llu,deltaTimestamp:%llu,senderTime:%llu,firstTime:%lld,firstTimestamp:%lld,lastExtSeqNum:%u(%u),clockrate:%u]\n",ssrc,skew,deltaTime,deltaTimestamp,lastReceivedSenderTime, firstReceivedSenderTime, firstReceivedSenderTimestamp, sr.GetRTPTimestamp(), lastReceivedSenderRTPTimestampExtender.GetExtSeqNum(),clockrate);
 	}
 }
 
@@ -1,19 +1,31 @@
 #include "rtp/RTPLostPackets.h"
 
+#include <algorithm>
+
+const BYTE  RTPLostPackets::MaxRetries = 10;
+const DWORD RTPLostPackets::MinRetryInterval = 20;
+
 RTPLostPackets::RTPLostPackets(WORD num)
 {
 	//Store number of packets
 	size = num;
-	//Create buffer
-	packets = (QWORD*) malloc(num*sizeof(QWORD));
-	//Set to 0
-	memset(packets,0,size*sizeof(QWORD));
+	//Get power of 2 capacity, at least one word
+	DWORD capacity = 64;
+	while (capacity<size)
+		capacity *= 2;
+	mask = capacity-1;
+	//Create buffers, set to 0
+	received.resize(capacity/64, 0);
+	retries.resize(capacity, 0);
+	nacked.resize(capacity, 0);
 }
 
 void RTPLostPackets::Reset()
 {
 	//Set to 0
-	memset(packets,0,size*sizeof(QWORD));
+	std::fill(received.begin(), received.end(), 0);
+	std::fill(retries.begin(), retries.end(), 0);
+	std::fill(nacked.begin(), nacked.end(), 0);
 	//No first packet
 	first = 0;
 	//None yet
@@ -21,134 +33,218 @@ void RTPLostPackets::Reset()
 	total = 0;
 }
 
-RTPLostPackets::~RTPLostPackets()
+uint64_t RTPLostPackets::GetLost(DWORD extSeq) const
+{
+	//Get position on the ring
+	DWORD index = extSeq & mask;
+	DWORD word  = index/64;
+	DWORD bit   = index%64;
+	//Get received bits, taking the rest from the next word if not aligned
+	uint64_t bits = received[word] >> bit;
+	if (bit)
+		bits |= received[(word+1) % received.size()] << (64-bit);
+	//Lost ones
+	uint64_t lost = ~bits;
+	//Remove the ones after the window
+	DWORD end = first+len;
+	if (extSeq>=end)
+		return 0;
+	if (end-extSeq<64)
+		lost &= ((uint64_t)1 << (end-extSeq)) - 1;
+	return lost;
+}
+
+void RTPLostPackets::Remove(DWORD extSeq, DWORD num)
 {
-	free(packets);
+	for (DWORD i=0; i<num; i+=64)
+	{
+		//Get lost packets on this word
+		uint64_t lost = GetLost(extSeq+i);
+		//Only the ones removed
+		if (num-i<64)
+			lost &= ((uint64_t)1 << (num-i)) - 1;
+		//Not lost anymore
+		total -= __builtin_popcountll(lost);
+	}
+	//Clear them so they can be reused
+	for (DWORD i=0; i<num; ++i)
+	{
+		DWORD index = (extSeq+i) & mask;
+		received[index/64] &= ~((uint64_t)1 << (index%64));
+		retries[index] = 0;
+		nacked[index]  = 0;
+	}
 }
 
 WORD RTPLostPackets::AddPacket(const RTPPacket::shared &packet)
 {
 	int lost = 0;
-	
+
 	//Get the packet number
 	DWORD extSeq = packet->GetExtSeqNum();
-	
+
 	//Check if is before first
-	if (first && extSeq<first)
+	if (len && extSeq<first)
 		//Exit, very old packet
 		return 0;
 
 	//If we are first
-	if (!first)
+	if (!len)
 		//Set to us
 		first = extSeq;
-	       
+
+	//Get end of window before adding us
+	DWORD end = first+len;
+
 	//Get our position
-	WORD pos = extSeq-first;
-	
+	DWORD pos = extSeq-first;
+
 	//Check if we are still in window
-	if (pos+1>size) 
+	if (pos+1>size)
 	{
 		//How much do we need to remove?
-		int n = pos+1-size;
-		//Check if we have to much to remove
-		if (n>size)
-			//cap it
-			n = size;
-		//Caculate total count
-		for (int i=0;i<n;++i)
-			//If it was lost
-			if (!packets[i])
-				//Decrease total
-				total--;
-		//Move the rest
-		memmove(packets,packets+n,(size-n)*sizeof(QWORD));
-		//Fill with 0 the new ones
-		memset(packets+(size-n),0,n*sizeof(QWORD));
+		DWORD n = pos+1-size;
+		//Remove them from the window, clearing all if it is too much
+		Remove(first,std::min<DWORD>(n,len));
 		//Set first
 		first = extSeq-size+1;
 		//Full
 		len = size-1;
 		//We are last
 		pos = size-1;
-	} 
-	
+	}
+
 	//Check if it is last
 	if (len<pos+1)
 	{
-		//look until we find a non lost and increase counter in the meanwhile
-		for (int i=pos; i>0 && !packets[i-1];--i)
-			//Lost
-			lost++;
+		//All the ones in between are lost
+		lost = extSeq - std::max(end,first);
 		//Increase lost
 		total += lost;
 		//Update last
 		len = pos+1;
 	} else {
 		//If it was lost
-		if (!packets[pos])
+		if (!IsReceived(extSeq))
 			//One lost total less
 			total--;
 	}
-	
+
 	//Set
-	packets[pos] = packet->GetTime();
-	
+	DWORD index = extSeq & mask;
+	received[index/64] |= (uint64_t)1 << (index%64);
+
 	//Return lost ones
 	return lost;
 }
 
+bool RTPLostPackets::CanRetry(DWORD extSeq, QWORD now, DWORD rtt) const
+{
+	DWORD index = extSeq & mask;
+	//Check if not nacked yet or enought time has passed since last time
+	return retries[index]<MaxRetries && (!retries[index] || (DWORD)now-nacked[index]>=std::max(rtt,MinRetryInterval));
+}
+
+void RTPLostPackets::Retry(DWORD extSeq, QWORD now)
+{
+	DWORD index = extSeq & mask;
+	//One more
+	retries[index]++;
+	nacked[index] = now;
+}
 
-std::list<RTCPRTPFeedback::NACKField::shared> RTPLostPackets::GetNacks() const
+DWORD RTPLostPackets::GetNacks(RTCPRTPFeedback::NACKField* fields, DWORD max, QWORD now, DWORD rtt)
 {
-	std::list<RTCPRTPFeedback::NACKField::shared> nacks;
-	WORD lost = 0;
-	WORD mask = 0;
-	int n = 0;
-	
-	//Iterate packets
-	for(WORD i=0;i<len;i++)
+	DWORD num = 0;
+	DWORD seq = first;
+	DWORD end = first+len;
+
+	//Until end of window or buffer is full
+	while (seq<end && num<max)
 	{
-		//Are we in a lost count?
-		if (lost)
+		//Get lost ones from here
+		uint64_t lost = GetLost(seq);
+		//If none
+		if (!lost)
 		{
-			//It was lost?
-			if (packets[i]==0)
-				//Update mask
-				mask |= 1 << n;
-			//Increase mask len
-			n++;
-			//If we are enought
-			if (n==16)
+			//Next word
+			seq += 64;
+			continue;
+		}
+		//Move to first lost
+		seq += __builtin_ctzll(lost);
+		//If we can't nack it now
+		if (!CanRetry(seq,now,rtt))
+		{
+			//Try next
+			seq++;
+			continue;
+		}
+		//Get lost ones on the following 16
+		uint64_t following = GetLost(seq+1) & 0xFFFF;
+		WORD blp = 0;
+		//For each one
+		while (following)
+		{
+			//Get position
+			int i = __builtin_ctzll(following);
+			//Remove it
+			following &= following - 1;
+			//If we can nack it
+			if (CanRetry(seq+1+i,now,rtt))
 			{
-				//Add new NACK field to list
-				nacks.push_back(std::make_shared<RTCPRTPFeedback::NACKField>(lost,mask));
-				//Reset counters
-				n = 0;
-				lost = 0;
-				mask = 0;
+				//Add to mask
+				blp |= 1 << i;
+				//Nacked
+				Retry(seq+1+i,now);
 			}
 		}
-		//Is this the first one lost
-		else if (!packets[i]) {
-			//This is the first one
-			lost = first+i;
-		}
-		
+		//Nacked
+		Retry(seq,now);
+		//Add field
+		fields[num++] = RTCPRTPFeedback::NACKField(seq,blp);
+		//Skip the ones on this field
+		seq += 17;
 	}
-	
-	//Are we in a lost count?
-	if (lost)
+
+	return num;
+}
+
+std::list<RTCPRTPFeedback::NACKField::shared> RTPLostPackets::GetNacks() const
+{
+	std::list<RTCPRTPFeedback::NACKField::shared> nacks;
+	DWORD seq = first;
+	DWORD end = first+len;
+
+	//Until end of window
+	while (seq<end)
+	{
+		//Get lost ones from here
+		uint64_t lost = GetLost(seq);
+		//If none
+		if (!lost)
+		{
+			//Next word
+			seq += 64;
+			continue;
+		}
+		//Move to first lost
+		seq += __builtin_ctzll(lost);
+		//Get lost ones on the following 16
+		WORD blp = GetLost(seq+1) & 0xFFFF;
 		//Add new NACK field to list
-		nacks.push_back(std::make_shared<RTCPRTPFeedback::NACKField>(lost,mask));
-	
+		nacks.push_back(std::make_shared<RTCPRTPFeedback::NACKField>(seq,blp));
+		//Skip the ones on this field
+		seq += 17;
+	}
+
 	return nacks;
 }
 
 void  RTPLostPackets::Dump() const
 {
-	Debug("[RTPLostPackets size=%d first=%d len=%d]\n",size,first,len);
-	for(int i=0;i<len;i++)
-		Debug("[%.3d,%.8u]\n",i,packets[i]);
+	Debug("[RTPLostPackets size=%d first=%d len=%d total=%d]\n",size,first,len,total);
+	for(DWORD i=0;i<len;i++)
+		Debug("[%.3d,%s]\n",i,IsReceived(first+i) ? "received" : "lost");
 	Debug("[/RTPLostPackets]\n");
 }
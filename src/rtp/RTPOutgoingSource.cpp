@@ -161,29 +161,40 @@ RTCPSenderReport::shared RTPOutgoingSource::CreateSenderReport(QWORD now)
 }
 
 bool RTPOutgoingSource::ProcessReceiverReport(QWORD now, const RTCPReport::shared& report)
+{
+	return ProcessReport(now, *report);
+}
+
+bool RTPOutgoingSource::ProcessReceiverReport(QWORD now, const RTCPReportView& report)
+{
+	return ProcessReport(now, report);
+}
+
+template<typename Report>
+bool RTPOutgoingSource::ProcessReport(QWORD now, Report& report)
 {
 	//Increate report count
 	reportCount++;
 	reportCountDelta = reportCountAcumulator.Update(now, 1);
 	
 	//Increase lost counter
-	DWORD lostCount = report->GetLostCount();
+	DWORD lostCount = report.GetLostCount();
 	reportedLostCount += lostCount;
 	reportedLostCountDelta = reportedlostCountAcumulator.Update(now, lostCount);
 	
 	//Get fraction loss
-	reportedFractionLossAcumulator.Update(now, report->GetFactionLost());
+	reportedFractionLossAcumulator.Update(now, report.GetFactionLost());
 	
 	//Get jitter
-	reportedJitter	=  report->GetJitter();
+	reportedJitter	=  report.GetJitter();
 	
 	//Calculate RTT
-	if (!IsLastSenderReportNTP(report->GetLastSR()))
+	if (!IsLastSenderReportNTP(report.GetLastSR()))
 		//Rtt not updated
 		return false;
 	
 	//Calculate new rtt in ms
-	rtt = now - lastSenderReport/1000-report->GetDelaySinceLastSRMilis();
+	rtt = now - lastSenderReport/1000-report.GetDelaySinceLastSRMilis();
 	
 	//RTT updated
 	return true;
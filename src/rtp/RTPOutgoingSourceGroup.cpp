@@ -52,43 +52,27 @@ void RTPOutgoingSourceGroup::RemoveListener(Listener* listener)
 	});
 }
 
-void RTPOutgoingSourceGroup::AddPacket(const RTPPacket::shared& packet)
+void RTPOutgoingSourceGroup::AddPacket(const RTPPacket::shared& packet, const BYTE* data, DWORD size, QWORD now)
 {
-	//Add to the rtx queue
-	packets.Set(packet->GetSeqNum(), packet);
+	//Add to the rtx history
+	history.Add(packet, data, size, now);
 }
 
-RTPPacket::shared RTPOutgoingSourceGroup::GetPacket(WORD seq) const
+RTPPacket::shared RTPOutgoingSourceGroup::GetPacket(WORD seq, QWORD now)
 {
 	//If there are no packets
-	if (!packets.GetLength())
-	{
+	if (!history.GetLength())
 		//Debug
 		UltraDebug("-RTPOutgoingSourceGroup::GetPacket() | no packets available\n");
-		//Not found
-		return nullptr;
-	}
 	
 	//Find packet to retransmit
-	auto packet = packets.Get(seq);
-
-	//If we don't have it
-	if (!packet)
-	{
-		//Debug
-		UltraDebug("-RTPOutgoingSourceGroup::GetPacket() | packet not found [seqNum:%u,media:%u,first:%u,last:%u]\n",seq,media.cycles,packets.GetFirstSeq(), packets.GetLastSeq());
-		//Not found
-		return nullptr;
-	}
-	
-	//Get packet
-	return packet.value();
+	return history.Get(seq, now);
 }
 
 void RTPOutgoingSourceGroup::onPLIRequest(DWORD ssrc)
 {
 	//Send asycn
-	timeService.Async([=](auto) {
+	timeService.Post([=](auto) {
 		//Deliver to all listeners
 		for (auto listener : listeners)
 			listener->onPLIRequest(this,ssrc);
@@ -101,7 +85,7 @@ void RTPOutgoingSourceGroup::onREMB(DWORD ssrc, DWORD bitrate)
 	media.remb = bitrate;
 	
 	//Send asycn
-	timeService.Async([=](auto) {
+	timeService.Post([=](auto) {
 		//Deliver to all listeners
 		for (auto listener : listeners)
 			listener->onREMB(this,ssrc,bitrate);
@@ -80,6 +80,13 @@ RTPPacket::RTPPacket(MediaFrame::Type media, BYTE codec, const RTPHeader& header
 	this->time = time;
 }
 
+RTPPacket::RTPPacket(MediaFrame::Type media, BYTE codec, const RTPHeader& header, RTPHeaderExtension&& extension, QWORD time) :
+	RTPPacket(media, codec, time)
+{
+	//Set header and take extension
+	this->header = header;
+	this->extension = std::move(extension);
+}
 
 RTPPacket::RTPPacket(MediaFrame::Type media,BYTE codec,const RTPHeader &header, const RTPHeaderExtension &extension, const RTPPayload::shared &payload, QWORD time) :
 	header(header),
@@ -115,7 +122,7 @@ RTPPacket::~RTPPacket()
 RTPPacket::shared RTPPacket::Clone() const
 {
 	//New one
-	auto cloned = std::make_shared<RTPPacket>(GetMediaType(),GetCodec(),GetRTPHeader(),GetRTPHeaderExtension(),payload,GetTime());
+	auto cloned = Create(GetMediaType(),GetCodec(),GetRTPHeader(),GetRTPHeaderExtension(),payload,GetTime());
 	//Set attrributes
 	cloned->SetClockRate(GetClockRate());
 	cloned->SetSeqCycles(GetSeqCycles());
@@ -130,6 +137,20 @@ RTPPacket::shared RTPPacket::Clone() const
 	cloned->activeDecodeTargets  = activeDecodeTargets;
 	cloned->templateDependencyStructure = templateDependencyStructure;
 	cloned->config		     = config;
+	//Get serialization shared by all clones
+	auto shared = std::atomic_load(&sharedSerialization);
+	//If first clone
+	if (!shared)
+	{
+		//Create new one, recycled as the packets
+		auto created = std::allocate_shared<SharedSerialization>(ArenaAllocator<SharedSerialization>());
+		//Set it unless other thread has cloned it in the meanwhile
+		shared = std::atomic_compare_exchange_strong(&sharedSerialization,&shared,created) ? created : shared;
+	}
+	//One more clone
+	shared->clones.fetch_add(1,std::memory_order_relaxed);
+	//Share it
+	cloned->sharedSerialization = shared;
 	//Return it
 	return cloned;
 }
@@ -201,7 +222,7 @@ RTPPacket::shared RTPPacket::Parse(const BYTE* data, DWORD size, const RTPMap& r
 	MediaFrame::Type media = GetMediaForCodec(codec);
 	
 	//Create normal packet
-	auto packet = std::make_shared<RTPPacket>(media,codec,header,extension,time);
+	auto packet = Create(media,codec,header,std::move(extension),time);
 	
 	//Set the payload
 	packet->SetPayload(data+ini,size-ini);
@@ -211,7 +232,111 @@ RTPPacket::shared RTPPacket::Parse(const BYTE* data, DWORD size, const RTPMap& r
 }
 
 
+DWORD RTPPacket::GetSerializationFlags() const
+{
+	//Extensions present on the serialized packet
+	return	  header.extension			<< 0
+		| extension.hasAbsSentTime		<< 1
+		| extension.hasTimeOffset		<< 2
+		| extension.hasAudioLevel		<< 3
+		| extension.hasVideoOrientation		<< 4
+		| extension.hasTransportWideCC		<< 5
+		| extension.hasFrameMarking		<< 6
+		| extension.hasRId			<< 7
+		| extension.hasRepairedId		<< 8
+		| extension.hasMediaStreamId		<< 9
+		| extension.hasDependencyDescriptor	<< 10
+		| extension.hasAbsoluteCaptureTime	<< 11;
+}
+
 DWORD RTPPacket::Serialize(BYTE* data,DWORD size,const RTPMap& extMap) const
+{
+	//Compile ids and serialize
+	return Serialize(data,size,RTPHeaderExtension::IdMap(extMap));
+}
+
+DWORD RTPPacket::Serialize(BYTE* data,DWORD size,const RTPHeaderExtension::IdMap& extIds) const
+{
+	//Get serialization shared with the other clones
+	auto shared = std::atomic_load(&sharedSerialization);
+	
+	//If not cloned, cloned only once or it is different for each clone
+	if (!shared || shared->clones.load(std::memory_order_relaxed)<2 || !CanShareSerialization())
+		//Serialize all, nobody would reuse it
+		return SerializeFull(data,size,extIds);
+	
+	//If it has been already serialized by other clone
+	if (shared->ready.load(std::memory_order_acquire))
+	{
+		//Check it has been done with same extensions and payload
+		if (shared->flags!=GetSerializationFlags()
+			|| shared->mediaLength!=GetMediaLength()
+			|| shared->mid!=extension.mid
+			|| shared->extIds!=extIds)
+			//Serialize all
+			return SerializeFull(data,size,extIds);
+		
+		//Serialize header
+		uint32_t len = header.Serialize(data,size);
+		
+		//Check
+		if (!len || len+shared->dataLength>size)
+			//Error
+			return Error("-RTPPacket::Serialize() | Error serializing rtp headers\n");
+		
+		//Copy extensions and payload
+		BYTE* tail = data+len;
+		memcpy(tail,shared->data,shared->dataLength);
+		
+		//Patch values that change on each packet
+		if (shared->offsets.absSentTime)
+			set3(tail,shared->offsets.absSentTime,((extension.absSentTime << 18) / 1000));
+		if (shared->offsets.transportSeqNum)
+			set2(tail,shared->offsets.transportSeqNum,extension.transportSeqNum);
+		
+		//Done
+		return len+shared->dataLength;
+	}
+	
+	//If other thread is serializing it
+	if (!shared->mutex.try_lock())
+		//Don't wait for it
+		return SerializeFull(data,size,extIds);
+	
+	std::lock_guard<std::mutex> lock(shared->mutex,std::adopt_lock);
+	
+	//Serialize and get where the values are
+	DWORD headerLength = 0;
+	RTPHeaderExtension::Offsets offsets;
+	DWORD len = SerializeFull(data,size,extIds,&headerLength,&offsets);
+	
+	//If done, fits and not set in the meanwhile
+	if (len && len-headerLength<=sizeof(shared->data) && !shared->ready.load(std::memory_order_relaxed))
+	{
+		//Store it for next clones
+		shared->extIds		= extIds;
+		shared->mid		= extension.mid;
+		shared->flags		= GetSerializationFlags();
+		shared->mediaLength	= GetMediaLength();
+		shared->offsets		= offsets;
+		shared->dataLength	= len-headerLength;
+		memcpy(shared->data,data+headerLength,shared->dataLength);
+		//Ready
+		shared->ready.store(true,std::memory_order_release);
+	}
+	
+	return len;
+}
+
+bool RTPPacket::IsSerializationShared() const
+{
+	//Get serialization shared with the other clones
+	auto shared = std::atomic_load(&sharedSerialization);
+	//Check if it has been stored
+	return shared && shared->ready.load(std::memory_order_acquire);
+}
+
+DWORD RTPPacket::SerializeFull(BYTE* data,DWORD size,const RTPHeaderExtension::IdMap& extIds,DWORD* headerLength,RTPHeaderExtension::Offsets* offsets) const
 {
 	//Serialize header
 	uint32_t len = header.Serialize(data,size);
@@ -220,12 +345,16 @@ DWORD RTPPacket::Serialize(BYTE* data,DWORD size,const RTPMap& extMap) const
 	if (!len)
 		//Error
 		return Error("-RTPPacket::Serialize() | Error serializing rtp headers\n");
+	
+	//Store fixed header length
+	if (headerLength)
+		*headerLength = len;
 
 	//If we have extension
 	if (header.extension)
 	{
 		//Serialize
-		uint32_t n = extension.Serialize(extMap,data+len,size-len);
+		uint32_t n = extension.Serialize(extIds,data+len,size-len,offsets);
 		//Comprobamos que quepan
 		if (!n)
 			//Error
@@ -297,6 +426,8 @@ BYTE* RTPPacket::AdquireMediaData()
 		//We own the payload
 		ownedPayload = true;
 	}
+	//Payload may change, don't share serialization anymore
+	Invalidate();
 	//You can write on payload now
 	return payload->GetMediaData();
 }
@@ -361,18 +492,25 @@ void RTPPacket::Dump() const
 }
 
 
-bool RTPPacket::ParseDependencyDescriptor(const std::optional<TemplateDependencyStructure>& templateDependencyStructure, std::optional<std::vector<bool>>& activeDecodeTargets)
+bool RTPPacket::ParseDependencyDescriptor(const TemplateDependencyStructure::shared& templateDependencyStructure, const std::optional<std::vector<bool>>& activeDecodeTargets)
 {
 	//parse it
-	if (!extension.ParseDependencyDescriptor(templateDependencyStructure))
+	if (!extension.ParseDependencyDescriptor(templateDependencyStructure.get()))
 		//Nothing to do
 		return false;
 
 	//If packet has a new dependency structure
 	if (extension.dependencyDescryptor && extension.dependencyDescryptor->templateDependencyStructure)
 	{
-		//Store it
-		this->templateDependencyStructure = extension.dependencyDescryptor->templateDependencyStructure;
+		//Get it
+		const auto& received = extension.dependencyDescryptor->templateDependencyStructure.value();
+		//If it is the one we already have, as it is resent on every key frame
+		if (templateDependencyStructure && *templateDependencyStructure==received)
+			//Reuse it
+			this->templateDependencyStructure = templateDependencyStructure;
+		else
+			//Store new one
+			this->templateDependencyStructure = std::make_shared<const TemplateDependencyStructure>(received);
 		this->activeDecodeTargets	  = extension.dependencyDescryptor->activeDecodeTargets;
 	} else {
 		//Keep previous
@@ -0,0 +1,232 @@
+#include "rtp/RTPPacketHistory.h"
+
+#include <algorithm>
+#include <cstring>
+
+const DWORD RTPPacketHistory::DefaultMaxAge	= 1000;		// 1s
+const DWORD RTPPacketHistory::DefaultMaxBytes	= 4*1024*1024;	// 4MB, 1s at 32mbps
+const DWORD RTPPacketHistory::MinAge		= 500;		// 500ms
+const DWORD RTPPacketHistory::RTTs		= 4;
+const DWORD RTPPacketHistory::InitialCapacity	= 16*1024;
+
+RTPPacketHistory::RTPPacketHistory(DWORD maxAge, DWORD maxBytes) :
+	maxAge(maxAge),
+	maxBytes(maxBytes)
+{
+}
+
+DWORD RTPPacketHistory::GetAge() const
+{
+	//Enough for a few nack retries
+	return std::min(maxAge, std::max(MinAge, rtt*RTTs));
+}
+
+void RTPPacketHistory::SetMaxBytes(DWORD maxBytes)
+{
+	//Store new limit
+	this->maxBytes = maxBytes;
+	//Remove oldest ones until we fit
+	while (bytes>maxBytes)
+		Evict();
+	//If the slab is bigger
+	if (slab.size()>maxBytes)
+		//Shrink it
+		Resize(std::max(maxBytes, bytes));
+}
+
+bool RTPPacketHistory::Add(const RTPPacket::shared& packet, const BYTE* data, DWORD size, QWORD now)
+{
+	DWORD extSeqNum = packet->GetExtSeqNum();
+
+	//Only newer packets, history is ordered by seq num
+	if (!entries.empty() && extSeqNum<=entries.back().extSeqNum)
+		return false;
+
+	//Get header length of serialized packet
+	RTPHeader header;
+	DWORD len = header.Parse(data,size);
+	//If it has extensions
+	if (len && header.extension && len+4<=size)
+		//Skip them
+		len += 4 + get2(data,len+2)*4;
+	//Check
+	if (!len || len>size)
+		return Warning("-RTPPacketHistory::Add() | Could not get payload of serialized packet [seq:%u,size:%u]\n",extSeqNum,size);
+
+	//Remove old ones
+	Expire(now);
+
+	//Get payload size as sent, in case it was rewritten on serialization
+	DWORD payloadSize = size - len;
+
+	RTPPayload::shared payload;
+	//If the payload is shared with other clones and has been sent unmodified
+	if (sharePayloads && !packet->rewitePictureIds && payloadSize==packet->GetMediaLength())
+		//Reference it instead of copying it
+		payload = packet->GetSharedPayload();
+
+	//If shared
+	if (payload)
+	{
+		//Nothing to copy
+		payloadSize = 0;
+		referenced++;
+	}
+
+	//Get space for it
+	DWORD offset = Allocate(payloadSize);
+
+	//Copy payload
+	if (payloadSize)
+		memcpy(slab.data()+offset, data+len, payloadSize);
+	head = offset + payloadSize;
+	bytes += payloadSize;
+
+	//Add entry
+	entries.push_back({
+		packet->GetRTPHeader(),
+		packet->GetRTPHeaderExtension(),
+		packet->GetMediaType(),
+		packet->GetCodec(),
+		packet->IsKeyFrame(),
+		packet->GetClockRate(),
+		extSeqNum,
+		packet->GetTime(),
+		now,
+		offset,
+		payloadSize,
+		payload
+	});
+
+	return true;
+}
+
+RTPPacket::shared RTPPacketHistory::Get(WORD seq, QWORD now)
+{
+	//If there are no packets
+	if (entries.empty())
+	{
+		//Not found
+		misses++;
+		return nullptr;
+	}
+
+	//Get extended seq num relative to last one
+	DWORD last = entries.back().extSeqNum;
+	DWORD extSeqNum = last - (WORD)(last - seq);
+
+	//Find it
+	auto it = std::lower_bound(entries.begin(), entries.end(), extSeqNum, [](const Entry& entry, DWORD extSeqNum) {
+		return entry.extSeqNum<extSeqNum;
+	});
+
+	//If not found or too old
+	if (it==entries.end() || it->extSeqNum!=extSeqNum || now>it->sent+GetAge())
+	{
+		//Debug
+		UltraDebug("-RTPPacketHistory::Get() | packet not found [seq:%u,first:%u,last:%u,hits:%llu,misses:%llu,evicted:%llu]\n",seq,GetFirstSeq(),GetLastSeq(),hits,misses+1,evicted);
+		//Not found
+		misses++;
+		return nullptr;
+	}
+
+	//Rebuild packet, using shared payload if we have it
+	auto packet = it->payload
+		? RTPPacket::Create(it->media,it->codec,it->header,it->extension,it->payload,it->time)
+		: RTPPacket::Create(it->media,it->codec,it->header,it->extension,it->time);
+	packet->SetClockRate(it->clockRate);
+	packet->SetSeqCycles(it->extSeqNum>>16);
+	packet->SetKeyFrame(it->keyFrame);
+	//Copy payload from slab
+	if (!it->payload)
+		packet->SetPayload(slab.data()+it->offset,it->size);
+
+	//Found
+	hits++;
+	return packet;
+}
+
+void RTPPacketHistory::Clear()
+{
+	//Remove all
+	entries.clear();
+	head = 0;
+	bytes = 0;
+}
+
+void RTPPacketHistory::Expire(QWORD now)
+{
+	//Get max age
+	DWORD age = GetAge();
+	//Remove the ones too old
+	while (!entries.empty() && now>entries.front().sent+age)
+		Evict();
+}
+
+void RTPPacketHistory::Evict()
+{
+	//Release oldest payload
+	bytes -= entries.front().size;
+	entries.pop_front();
+	//If empty
+	if (entries.empty())
+		//Start again from the begining
+		head = 0;
+	//One more
+	evicted++;
+}
+
+DWORD RTPPacketHistory::Allocate(DWORD size)
+{
+	while (true)
+	{
+		//Get start of the oldest payload
+		DWORD tail = entries.empty() ? head : entries.front().offset;
+		//If used space is not wrapped
+		if (!bytes || head>tail)
+		{
+			//If it fits at the end
+			if (slab.size()-head>=size)
+				return head;
+			//If it fits at the begining before the oldest one
+			if (tail>=size)
+				return 0;
+		//Check if it fits between the newest and the oldest ones
+		} else if (tail-head>=size) {
+			return head;
+		}
+
+		//If we can still grow, or it doesn't fit even when empty
+		if (slab.size()<maxBytes || entries.empty())
+		{
+			//Double size
+			DWORD capacity = std::max({InitialCapacity, (DWORD)slab.size()*2, bytes+size});
+			//Don't go over the limit unless needed for a single payload
+			if (capacity>maxBytes)
+				capacity = std::max(maxBytes, bytes+size);
+			//Move payloads to the new one, leaving the free space at the end
+			Resize(capacity);
+		} else
+			//Remove oldest one
+			Evict();
+	}
+}
+
+void RTPPacketHistory::Resize(DWORD capacity)
+{
+	//New slab
+	std::vector<BYTE> resized(capacity);
+	DWORD pos = 0;
+
+	//Move payloads in order
+	for (auto& entry : entries)
+	{
+		memcpy(resized.data()+pos, slab.data()+entry.offset, entry.size);
+		entry.offset = pos;
+		pos += entry.size;
+	}
+
+	//Use it
+	slab = std::move(resized);
+	head = pos;
+}
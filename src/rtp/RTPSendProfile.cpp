@@ -0,0 +1,38 @@
+#include "rtp/RTPSendProfile.h"
+
+RTPSendProfile::RTPSendProfile()
+{
+	//Nothing negotiated
+	Reset();
+}
+
+void RTPSendProfile::Reset()
+{
+	payloadTypes.fill((BYTE)RTPMap::NotFound);
+	rtxPayloadTypes.fill((BYTE)RTPMap::NotFound);
+	defaultRTXPayloadType = RTPMap::NotFound;
+	extIds = RTPHeaderExtension::IdMap();
+}
+
+void RTPSendProfile::Compile(const RTPMap& rtp, const RTPMap& ext, const RTPMap& apt)
+{
+	//Start from scratch
+	Reset();
+
+	//For each payload type, keeping the first one of each codec as RTPMap::GetTypeForCodec does
+	for (const auto& [type,codec] : rtp)
+		if (payloadTypes[codec]==RTPMap::NotFound)
+			payloadTypes[codec] = type;
+
+	//For each rtx payload type, apt map is keyed by the rtx one
+	for (const auto& [rtx,type] : apt)
+		if (rtxPayloadTypes[type]==RTPMap::NotFound)
+			rtxPayloadTypes[type] = rtx;
+
+	//First one
+	if (!apt.empty())
+		defaultRTXPayloadType = apt.begin()->first;
+
+	//Compile extension ids
+	extIds = RTPHeaderExtension::IdMap(ext);
+}
@@ -178,355 +178,390 @@ void RTPStreamTransponder::onRTP(const RTPIncomingMediaStream* stream,const RTPP
 		return;
 
 	//Run async
-	timeService.Async([=, packet = packet->Clone()](auto now){
+	timeService.Post([=, packet = packet->Clone()](auto now){
+		std::vector<RTPPacket::shared> forwarded;
+		//Process it
+		Forward(stream,packet,forwarded);
+		//Send them
+		if (sender && !forwarded.empty())
+			sender->Enqueue(std::move(forwarded));
+	});
+}
 
-		//If it is from the next transitioning stream
-		if (stream == incomingNext.get())
-		{
-			//If it is a video packet and not an iframe
-			if (packet->GetMediaType()==MediaFrame::Video && !packet->IsKeyFrame())
-				//Skip
-				return;
+void RTPStreamTransponder::onRTP(const RTPIncomingMediaStream* stream,const std::vector<RTPPacket::shared>& packets)
+{
+	//Trace method
+	TRACE_EVENT("rtp","RTPStreamTransponder::onRTP packets", "packets", packets.size());
 
-			//Remove listener from old stream
-			if (this->incoming)
-				this->incoming->RemoveListener(this);
+	std::vector<RTPPacket::shared> cloned;
+	cloned.reserve(packets.size());
+	//Clone all of them
+	for (const auto& packet : packets)
+		if (packet)
+			cloned.push_back(packet->Clone());
 
-			//Reset packets
-			reset = true;
+	//Check
+	if (cloned.empty())
+		//Exit
+		return;
 
-			//Transition to new stream and receiver
-			this->incoming = incomingNext;
-			this->receiver = receiverNext;
-			this->incomingNext = nullptr;
-			this->receiverNext = nullptr;
-		}
+	//Run async once for all of them
+	timeService.Post([=, packets = std::move(cloned)](auto now){
+		std::vector<RTPPacket::shared> forwarded;
+		forwarded.reserve(packets.size());
+		//Process each one
+		for (const auto& packet : packets)
+			Forward(stream,packet,forwarded);
+		//Send them all at once
+		if (sender && !forwarded.empty())
+			sender->Enqueue(std::move(forwarded));
+	});
+}
 
-		//Check if it is from the correct stream
-		if (stream != this->incoming.get())
-			//Skip
-			return;
-	
-		//If muted
-		if (muted)
+void RTPStreamTransponder::Forward(const RTPIncomingMediaStream* stream,const RTPPacket::shared& packet,std::vector<RTPPacket::shared>& forwarded)
+{
+	//If it is from the next transitioning stream
+	if (stream == incomingNext.get())
+	{
+		//If it is a video packet and not an iframe
+		if (packet->GetMediaType()==MediaFrame::Video && !packet->IsKeyFrame())
 			//Skip
 			return;
 
-		//If forwarding only intra frames and video frame is not intra
-		if (intraOnlyForwarding && packet->GetMediaType() == MediaFrame::Video && !packet->IsKeyFrame())
-		{
-			//Drop it
-			dropped++;
-			//Skip
-			return;
-		}
+		//Remove listener from old stream
+		if (this->incoming)
+			this->incoming->RemoveListener(this);
+
+		//Reset packets
+		reset = true;
 
-		//Check if it is an empty packet
-		if (!packet->GetMediaLength())
+		//Transition to new stream and receiver
+		this->incoming = incomingNext;
+		this->receiver = receiverNext;
+		this->incomingNext = nullptr;
+		this->receiverNext = nullptr;
+	}
+
+	//Check if it is from the correct stream
+	if (stream != this->incoming.get())
+		//Skip
+		return;
+
+	//If muted
+	if (muted)
+		//Skip
+		return;
+
+	//If forwarding only intra frames and video frame is not intra
+	if (intraOnlyForwarding && packet->GetMediaType() == MediaFrame::Video && !packet->IsKeyFrame())
+	{
+		//Drop it
+		dropped++;
+		//Skip
+		return;
+	}
+
+	//Check if it is an empty packet
+	if (!packet->GetMediaLength())
+	{
+		UltraDebug("-RTPStreamTransponder::onRTP() | dropping empty packet\n");
+		//Drop it
+		dropped++;
+		//Exit
+		return;
+	}
+
+	//Check sender
+	if (!sender)
+		//Nothing
+		return;
+
+	//Check if source has changed
+	if (source && packet->GetSSRC()!=source)
+		//We need to reset
+		reset = true;
+
+	//If we need to reset
+	if (reset)
+	{
+		Debug("-StreamTransponder::onRTP() | Reset stream\n");
+		//IF last was not completed
+		if (!lastCompleted && type==MediaFrame::Video)
 		{
-			UltraDebug("-RTPStreamTransponder::onRTP() | dropping empty packet\n");
-			//Drop it
-			dropped++;
-			//Exit
-			return;
+			//Create new RTP packet
+			RTPPacket::shared rtp = std::make_shared<RTPPacket>(media,codec);
+			//Set data
+			rtp->SetPayloadType(type);
+			rtp->SetSSRC(ssrc);
+			rtp->SetExtSeqNum(lastExtSeqNum++);
+			rtp->SetMark(true);
+			rtp->SetExtTimestamp(lastTimestamp);
+			//Send it
+			forwarded.push_back(rtp);
 		}
-	
-		//Check sender
-		if (!sender)
-			//Nothing
-			return;
-	
-		//Check if source has changed
-		if (source && packet->GetSSRC()!=source)
-			//We need to reset
-			reset = true;
-	
-		//If we need to reset
-		if (reset)
-		{
-			Debug("-StreamTransponder::onRTP() | Reset stream\n");
-			//IF last was not completed
-			if (!lastCompleted && type==MediaFrame::Video)
-			{
-				//Create new RTP packet
-				RTPPacket::shared rtp = std::make_shared<RTPPacket>(media,codec);
-				//Set data
-				rtp->SetPayloadType(type);
-				rtp->SetSSRC(ssrc);
-				rtp->SetExtSeqNum(lastExtSeqNum++);
-				rtp->SetMark(true);
-				rtp->SetExtTimestamp(lastTimestamp);
-				//Send it
-				if (sender) sender->Enqueue(rtp);
-			}
-			//No source
-			lastCompleted = true;
-			source = 0;
-			//Reset first paquet seq num and timestamp
-			firstExtSeqNum = NoSeqNum;
-			firstTimestamp = NoTimestamp;
-			//Store the last send ones
-			baseExtSeqNum = lastExtSeqNum+1;
-			baseTimestamp = lastTimestamp;
-			//None dropped or added
-			dropped = 0;
-			added = 0;
-			//Not selecting
-			selector = nullptr;
-			//No layer
-			spatialLayerId = LayerInfo::MaxLayerId;
-			temporalLayerId = LayerInfo::MaxLayerId;
-		
-			//Reset frame numbers
-			firstFrameNumber = NoFrameNum;
-			baseFrameNumber = lastFrameNumber + 1;
-			frameNumberExtender.Reset();
+		//No source
+		lastCompleted = true;
+		source = 0;
+		//Reset first paquet seq num and timestamp
+		firstExtSeqNum = NoSeqNum;
+		firstTimestamp = NoTimestamp;
+		//Store the last send ones
+		baseExtSeqNum = lastExtSeqNum+1;
+		baseTimestamp = lastTimestamp;
+		//None dropped or added
+		dropped = 0;
+		added = 0;
+		//Not selecting
+		selector = nullptr;
+		//No layer
+		spatialLayerId = LayerInfo::MaxLayerId;
+		temporalLayerId = LayerInfo::MaxLayerId;
+	
+		//Reset frame numbers
+		firstFrameNumber = NoFrameNum;
+		baseFrameNumber = lastFrameNumber + 1;
+		frameNumberExtender.Reset();
+
+		//Reseted
+		reset = false;
+	}
 
-			//Reseted
-			reset = false;
-		}
-	
-		//Update source
-		source = packet->GetSSRC();
-		//Get new seq number
-		DWORD extSeqNum = packet->GetExtSeqNum();
-	
-		//Check if it the first received packet
-		if (firstExtSeqNum==NoSeqNum || firstTimestamp==NoTimestamp)
-		{
-			//If we have a time offest from last sent packet
-			if (lastTime)
-			{
-				//Calculate time diff
-				QWORD offset = getTimeDiff(lastTime)/1000;
-				//Get timestamp diff on correct clock rate
-				QWORD diff = offset*packet->GetClockRate()/1000;
-			
-				//UltraDebug("-ts offset:%llu diff:%llu baseTimestap:%lu firstTimestamp:%llu lastTimestamp:%llu rate:%llu\n",offset,diff,baseTimestamp,firstTimestamp,lastTimestamp,packet->GetClockRate());
-			
-				//convert it to rtp time and add to the last sent timestamp
-				baseTimestamp = lastTimestamp + diff + 1;
-			}
+	//Update source
+	source = packet->GetSSRC();
+	//Get new seq number
+	DWORD extSeqNum = packet->GetExtSeqNum();
 
-			//Reset drop counter
-			dropped = 0;
-			//Store seq number
-			firstExtSeqNum = extSeqNum;
-			//Get first timestamp
-			firstTimestamp = packet->GetExtTimestamp();
-		
-			UltraDebug("-StreamTransponder::onRTP() | first seq:%lu base:%lu last:%lu ts:%llu baseSeq:%lu baseTimestamp:%llu lastTimestamp:%llu\n",firstExtSeqNum,baseExtSeqNum,lastExtSeqNum,firstTimestamp,baseExtSeqNum,baseTimestamp,lastTimestamp);
-		}
-	
-		//Ensure it is not before first one
-		if (extSeqNum<firstExtSeqNum)
-			//Exit
-			return;
-	
-		//Only for viedo
-		if (packet->GetMediaType()==MediaFrame::Video)
+	//Check if it the first received packet
+	if (firstExtSeqNum==NoSeqNum || firstTimestamp==NoTimestamp)
+	{
+		//If we have a time offest from last sent packet
+		if (lastTime)
 		{
-			//Check if we don't have one or if we have a selector and it is not from the same codec
-			if (!selector || (BYTE)selector->GetCodec()!=packet->GetCodec())
-			{
-				//Create new selector for codec
-				selector.reset(VideoLayerSelector::Create((VideoCodec::Type)packet->GetCodec()));
-				//Set prev layers
-				selector->SelectSpatialLayer(spatialLayerId);
-				selector->SelectTemporalLayer(temporalLayerId);
-			}
+			//Calculate time diff
+			QWORD offset = getTimeDiff(lastTime)/1000;
+			//Get timestamp diff on correct clock rate
+			QWORD diff = offset*packet->GetClockRate()/1000;
+		
+			//UltraDebug("-ts offset:%llu diff:%llu baseTimestap:%lu firstTimestamp:%llu lastTimestamp:%llu rate:%llu\n",offset,diff,baseTimestamp,firstTimestamp,lastTimestamp,packet->GetClockRate());
+		
+			//convert it to rtp time and add to the last sent timestamp
+			baseTimestamp = lastTimestamp + diff + 1;
 		}
+
+		//Reset drop counter
+		dropped = 0;
+		//Store seq number
+		firstExtSeqNum = extSeqNum;
+		//Get first timestamp
+		firstTimestamp = packet->GetExtTimestamp();
 	
-		//Get rtp marking
-		bool mark = packet->GetMark();
-	
-		//If we have selector for codec
-		if (selector)
+		UltraDebug("-StreamTransponder::onRTP() | first seq:%lu base:%lu last:%lu ts:%llu baseSeq:%lu baseTimestamp:%llu lastTimestamp:%llu\n",firstExtSeqNum,baseExtSeqNum,lastExtSeqNum,firstTimestamp,baseExtSeqNum,baseTimestamp,lastTimestamp);
+	}
+
+	//Ensure it is not before first one
+	if (extSeqNum<firstExtSeqNum)
+		//Exit
+		return;
+
+	//Only for viedo
+	if (packet->GetMediaType()==MediaFrame::Video)
+	{
+		//Check if we don't have one or if we have a selector and it is not from the same codec
+		if (!selector || (BYTE)selector->GetCodec()!=packet->GetCodec())
 		{
-			//Select layer
+			//Create new selector for codec
+			selector.reset(VideoLayerSelector::Create((VideoCodec::Type)packet->GetCodec()));
+			//Set prev layers
 			selector->SelectSpatialLayer(spatialLayerId);
 			selector->SelectTemporalLayer(temporalLayerId);
-		
-			//Select pacekt
-			if (!packet->GetMediaLength() || !selector->Select(packet,mark))
-			{
-				//One more dropperd
-				dropped++;
-				//If selector is waiting for intra and last PLI was more than 1s ago
-				if (selector->IsWaitingForIntra() && getTimeDiffMS(lastSentPLI)>1E3)
-				{
-					//Log
-					//UltraDebug("-RTPStreamTransponder::onRTP() | selector IsWaitingForIntra\n");
-					//Request it again
-					RequestPLI();
-				}
-				//Drop
-				return;
-			}
-			//Get current spatial layer id
-			lastSpatialLayerId = selector->GetSpatialLayer();
 		}
+	}
+
+	//Get rtp marking
+	bool mark = packet->GetMark();
+
+	//If we have selector for codec
+	if (selector)
+	{
+		//Select layer
+		selector->SelectSpatialLayer(spatialLayerId);
+		selector->SelectTemporalLayer(temporalLayerId);
 	
-		//Set normalized seq num
-		extSeqNum = baseExtSeqNum + (extSeqNum - firstExtSeqNum) - dropped + added;
-	
-		//Set normailized timestamp
-		uint64_t timestamp = baseTimestamp + (packet->GetExtTimestamp()-firstTimestamp);
-	
-		//UPdate media codec and type
-		media = packet->GetMediaType();
-		codec = packet->GetCodec();
-		type  = packet->GetPayloadType();
-	
-		//UltraDebug("-ext seq:%lu base:%lu first:%lu current:%lu dropped:%lu added:%d ts:%lu normalized:%llu intra:%d codec=%d\n",extSeqNum,baseExtSeqNum,firstExtSeqNum,packet->GetExtSeqNum(),dropped,added,packet->GetTimestamp(),timestamp,packet->IsKeyFrame(),codec);
-	
-		//Rewrite pict id
-		bool rewitePictureIds = false;
-		DWORD pictureId = 0;
-		DWORD temporalLevelZeroIndex = 0;
-		//TODO: this should go into the layer selector??
-		if (rewritePicId && codec==VideoCodec::VP8 && packet->vp8PayloadDescriptor)
+		//Select pacekt
+		if (!packet->GetMediaLength() || !selector->Select(packet,mark))
 		{
-			//Get VP8 desc
-			auto desc = *packet->vp8PayloadDescriptor;
-		
-			//Check if we have a new pictId
-			if (desc.pictureIdPresent && desc.pictureId!=lastPicId)
-			{
-				//Update ids
-				lastPicId = desc.pictureId;
-				//Increase picture id
-				picId++;
-			}
-		
-			//Check if we a new base layer
-			if (desc.temporalLevelZeroIndexPresent && desc.temporalLevelZeroIndex!=lastTl0Idx)
+			//One more dropperd
+			dropped++;
+			//If selector is waiting for intra and last PLI was more than 1s ago
+			if (selector->IsWaitingForIntra() && getTimeDiffMS(lastSentPLI)>1E3)
 			{
-				//Update ids
-				lastTl0Idx = desc.temporalLevelZeroIndex;
-				//Increase tl0 index
-				tl0Idx++;
+				//Log
+				//UltraDebug("-RTPStreamTransponder::onRTP() | selector IsWaitingForIntra\n");
+				//Request it again
+				RequestPLI();
 			}
-		
-			//Rewrite picture id
-			pictureId = picId;
-			//Rewrite tl0 index
-			temporalLevelZeroIndex = tl0Idx;
-			//We need to rewrite vp8 picture ids
-			rewitePictureIds = true;
+			//Drop
+			return;
 		}
+		//Get current spatial layer id
+		lastSpatialLayerId = selector->GetSpatialLayer();
+	}
+
+	//Set normalized seq num
+	extSeqNum = baseExtSeqNum + (extSeqNum - firstExtSeqNum) - dropped + added;
+
+	//Set normailized timestamp
+	uint64_t timestamp = baseTimestamp + (packet->GetExtTimestamp()-firstTimestamp);
+
+	//UPdate media codec and type
+	media = packet->GetMediaType();
+	codec = packet->GetCodec();
+	type  = packet->GetPayloadType();
+
+	//UltraDebug("-ext seq:%lu base:%lu first:%lu current:%lu dropped:%lu added:%d ts:%lu normalized:%llu intra:%d codec=%d\n",extSeqNum,baseExtSeqNum,firstExtSeqNum,packet->GetExtSeqNum(),dropped,added,packet->GetTimestamp(),timestamp,packet->IsKeyFrame(),codec);
+
+	//Rewrite pict id
+	bool rewitePictureIds = false;
+	DWORD pictureId = 0;
+	DWORD temporalLevelZeroIndex = 0;
+	//TODO: this should go into the layer selector??
+	if (rewritePicId && codec==VideoCodec::VP8 && packet->vp8PayloadDescriptor)
+	{
+		//Get VP8 desc
+		auto desc = *packet->vp8PayloadDescriptor;
 	
-		//If we have to append h264 sprop parameters set for the first packet of an iframe
-		if (h264Parameters && codec==VideoCodec::H264 && packet->IsKeyFrame() && (timestamp!=lastTimestamp || firstExtSeqNum==packet->GetExtSeqNum()))
+		//Check if we have a new pictId
+		if (desc.pictureIdPresent && desc.pictureId!=lastPicId)
 		{
-			//UltraDebug("-addding h264 sprop\n");
-		
-			//Clone packet
-			auto cloned = h264Parameters->Clone();
-			//Set new seq numbers
-			cloned->SetExtSeqNum(extSeqNum);
-			//Set normailized timestamp
-			cloned->SetExtTimestamp(timestamp);
-			//Set payload type
-			cloned->SetPayloadType(type);
-			//Change ssrc
-			cloned->SetSSRC(ssrc);
-			//Send packet
-			if (sender)
-				//Create clone on sender thread
-				sender->Enqueue(cloned);
-			//Add new packet
-			added ++;
-			extSeqNum ++;
-		
-			//UltraDebug("-ext seq:%lu base:%lu first:%lu current:%lu dropped:%lu added:%d ts:%lu normalized:%llu intra:%d codec=%d\n",extSeqNum,baseExtSeqNum,firstExtSeqNum,packet->GetExtSeqNum(),dropped,added,packet->GetTimestamp(),timestamp,packet->IsKeyFrame(),codec);
+			//Update ids
+			lastPicId = desc.pictureId;
+			//Increase picture id
+			picId++;
 		}
 	
-		//Dependency descriptor active decodte target mask
-		std::optional<std::vector<bool>> forwaredDecodeTargets;
-	
-		//If it is AV1
-		if (codec==VideoCodec::AV1)
-			//Get decode target
-			forwaredDecodeTargets = static_cast<DependencyDescriptorLayerSelector*>(selector.get())->GetForwardedDecodeTargets();
-
-		//Continous frame number
-		uint64_t continousFrameNumber = NoFrameNum;
-		//Get frame number if we have dependency descriptor
-		if (packet->HasDependencyDestriptor())
+		//Check if we a new base layer
+		if (desc.temporalLevelZeroIndexPresent && desc.temporalLevelZeroIndex!=lastTl0Idx)
 		{
-			//Get it
-			auto dd = packet->GetDependencyDescriptor();
-
-			//Double check
-			if (dd)
-			{
-				//Extend it
-				frameNumberExtender.Extend(dd->frameNumber);
-				//Get extended frame number
-				uint64_t frameNumber = frameNumberExtender.GetExtSeqNum();
-
-				//If it is first
-				if (firstFrameNumber==NoFrameNum)
-					//Set it
-					firstFrameNumber = frameNumber;
-				//If it is the first frame after reset
-				if (baseFrameNumber==NoFrameNum)
-					//Set it
-					baseFrameNumber = frameNumber;
-				//Calculate a continous frame number
-				continousFrameNumber = baseFrameNumber + frameNumber - firstFrameNumber;
-
-				//UltraDebug("-frameNum first:%llu base:%llu current:%llu(%u) continous=%llu\n", firstFrameNumber, baseFrameNumber, lastFrameNumber, dd->frameNumber, continousFrameNumber);
-			}
+			//Update ids
+			lastTl0Idx = desc.temporalLevelZeroIndex;
+			//Increase tl0 index
+			tl0Idx++;
 		}
 	
-		//Get last send seq num and timestamp
-		lastExtSeqNum = extSeqNum;
-		lastTimestamp = timestamp;
-		//Update last sent time
-		lastTime = getTime();
-
-		//Get last frame number
-		lastFrameNumber = continousFrameNumber;
+		//Rewrite picture id
+		pictureId = picId;
+		//Rewrite tl0 index
+		temporalLevelZeroIndex = tl0Idx;
+		//We need to rewrite vp8 picture ids
+		rewitePictureIds = true;
+	}
 
+	//If we have to append h264 sprop parameters set for the first packet of an iframe
+	if (h264Parameters && codec==VideoCodec::H264 && packet->IsKeyFrame() && (timestamp!=lastTimestamp || firstExtSeqNum==packet->GetExtSeqNum()))
+	{
+		//UltraDebug("-addding h264 sprop\n");
+	
+		//Clone packet
+		auto cloned = h264Parameters->Clone();
 		//Set new seq numbers
-		packet->SetExtSeqNum(extSeqNum);
+		cloned->SetExtSeqNum(extSeqNum);
 		//Set normailized timestamp
-		packet->SetTimestamp(timestamp);
-		//Set mark again
-		packet->SetMark(mark);
+		cloned->SetExtTimestamp(timestamp);
+		//Set payload type
+		cloned->SetPayloadType(type);
 		//Change ssrc
-		packet->SetSSRC(ssrc);
-		//We need to rewrite vp8 picture ids
-		packet->rewitePictureIds = rewitePictureIds;
-		//Ensure we have desc
-		if (packet->vp8PayloadDescriptor)
+		cloned->SetSSRC(ssrc);
+		//Send packet
+		forwarded.push_back(cloned);
+		//Add new packet
+		added ++;
+		extSeqNum ++;
+	
+		//UltraDebug("-ext seq:%lu base:%lu first:%lu current:%lu dropped:%lu added:%d ts:%lu normalized:%llu intra:%d codec=%d\n",extSeqNum,baseExtSeqNum,firstExtSeqNum,packet->GetExtSeqNum(),dropped,added,packet->GetTimestamp(),timestamp,packet->IsKeyFrame(),codec);
+	}
+
+	//Dependency descriptor active decodte target mask
+	std::optional<std::vector<bool>> forwaredDecodeTargets;
+
+	//If it is AV1
+	if (codec==VideoCodec::AV1)
+		//Get decode target
+		forwaredDecodeTargets = static_cast<DependencyDescriptorLayerSelector*>(selector.get())->GetForwardedDecodeTargets();
+
+	//Continous frame number
+	uint64_t continousFrameNumber = NoFrameNum;
+	//Get frame number if we have dependency descriptor
+	if (packet->HasDependencyDestriptor())
+	{
+		//Get it
+		auto dd = packet->GetDependencyDescriptor();
+
+		//Double check
+		if (dd)
 		{
-			//Rewrite picture id
-			packet->vp8PayloadDescriptor->pictureId = pictureId;
-			//Rewrite tl0 index
-			packet->vp8PayloadDescriptor->temporalLevelZeroIndex = temporalLevelZeroIndex;
+			//Extend it
+			frameNumberExtender.Extend(dd->frameNumber);
+			//Get extended frame number
+			uint64_t frameNumber = frameNumberExtender.GetExtSeqNum();
+
+			//If it is first
+			if (firstFrameNumber==NoFrameNum)
+				//Set it
+				firstFrameNumber = frameNumber;
+			//If it is the first frame after reset
+			if (baseFrameNumber==NoFrameNum)
+				//Set it
+				baseFrameNumber = frameNumber;
+			//Calculate a continous frame number
+			continousFrameNumber = baseFrameNumber + frameNumber - firstFrameNumber;
+
+			//UltraDebug("-frameNum first:%llu base:%llu current:%llu(%u) continous=%llu\n", firstFrameNumber, baseFrameNumber, lastFrameNumber, dd->frameNumber, continousFrameNumber);
 		}
-		//If it has a dependency descriptor
-		if (forwaredDecodeTargets && packet->HasTemplateDependencyStructure())
-			//Override mak
-			packet->OverrideActiveDecodeTargets(forwaredDecodeTargets);
-		//If we have a continous frame number
-		if (packet->HasDependencyDestriptor() && continousFrameNumber != NoFrameNum)
-			//Update it
-			packet->OverrideFrameNumber(static_cast<uint16_t>(continousFrameNumber));
-	
-		//Send packet
-		if (sender)
-			//Enqueue it
-			sender->Enqueue(packet);
-	});
+	}
+
+	//Get last send seq num and timestamp
+	lastExtSeqNum = extSeqNum;
+	lastTimestamp = timestamp;
+	//Update last sent time
+	lastTime = getTime();
+
+	//Get last frame number
+	lastFrameNumber = continousFrameNumber;
+
+	//Set new seq numbers
+	packet->SetExtSeqNum(extSeqNum);
+	//Set normailized timestamp
+	packet->SetTimestamp(timestamp);
+	//Set mark again
+	packet->SetMark(mark);
+	//Change ssrc
+	packet->SetSSRC(ssrc);
+	//We need to rewrite vp8 picture ids
+	packet->rewitePictureIds = rewitePictureIds;
+	//Ensure we have desc
+	if (packet->vp8PayloadDescriptor)
+	{
+		//Rewrite picture id
+		packet->vp8PayloadDescriptor->pictureId = pictureId;
+		//Rewrite tl0 index
+		packet->vp8PayloadDescriptor->temporalLevelZeroIndex = temporalLevelZeroIndex;
+	}
+	//If it has a dependency descriptor
+	if (forwaredDecodeTargets && packet->HasTemplateDependencyStructure())
+		//Override mak
+		packet->OverrideActiveDecodeTargets(forwaredDecodeTargets);
+	//If we have a continous frame number
+	if (packet->HasDependencyDestriptor() && continousFrameNumber != NoFrameNum)
+		//Update it
+		packet->OverrideFrameNumber(static_cast<uint16_t>(continousFrameNumber));
+
+	//Send packet
+	forwarded.push_back(packet);
 }
 
 void RTPStreamTransponder::onBye(const RTPIncomingMediaStream* stream)
 {
-	timeService.Async([=](auto) {
+	timeService.Post([=](auto) {
 	
 		//If they are the not same
 		if (this->incoming.get() != stream)
@@ -540,7 +575,7 @@ void RTPStreamTransponder::onBye(const RTPIncomingMediaStream* stream)
 
 void RTPStreamTransponder::onEnded(const RTPIncomingMediaStream* stream)
 {
-	timeService.Async([=](auto){
+	timeService.Post([=](auto){
 		//IF it is the current one
 		if (this->incoming.get() == stream)
 		{
@@ -560,7 +595,7 @@ void RTPStreamTransponder::onEnded(const RTPIncomingMediaStream* stream)
 }
 void RTPStreamTransponder::onEnded(const RTPOutgoingSourceGroup* group)
 {
-	timeService.Async([=](auto) {
+	timeService.Post([=](auto) {
 		//IF it is the current one
 		if (this->outgoing.get() == group)
 			//No more outgoing
@@ -572,7 +607,7 @@ void RTPStreamTransponder::onEnded(const RTPOutgoingSourceGroup* group)
 void RTPStreamTransponder::RequestPLI()
 {
 	//Log("-RTPStreamTransponder::RequestPLI() [receiver:%p,incoming:%p]\n",receiver,incoming);
-	timeService.Async([=](auto now) {
+	timeService.Post([=](auto now) {
 		//Request update on the incoming
 		if (receiver && incoming) receiver->SendPLI(incoming->GetMediaSSRC());
 		//Update last sent pli
@@ -4,7 +4,9 @@
 #include <pipevideoinput.h>
 #include <pipevideooutput.h>
 #include <set>
+#include <algorithm>
 #include <functional>
+#include <thread>
 
 typedef std::pair<int, DWORD> Pair;
 typedef std::set<Pair, std::less<Pair>    > OrderedSetOfPairs;
@@ -196,6 +198,13 @@ void VideoMixer::Process(bool forceUpdate, QWORD now)
 		//Reset the change status in the mosaic
 		mosaic->Reset();
 
+		//Get compose start time
+		QWORD start = getTime();
+		//Slot updates
+		std::vector<WorkerPool::Task> tasks;
+		std::atomic<DWORD> updated = 0;
+		std::atomic<DWORD> skipped = 0;
+
 		//For each slot
 		for (int i=0;i<numSlots;i++)
 		{
@@ -219,7 +228,7 @@ void VideoMixer::Process(bool forceUpdate, QWORD now)
 					//If it was not there previously
 					if (changed)
 						//Clean position
-						mosaic->Clean(i,logo);
+						tasks.emplace_back([this,mosaic,i](){ mosaic->Clean(i,logo); });
 					//Next slot
 					continue;
 				}
@@ -235,34 +244,64 @@ void VideoMixer::Process(bool forceUpdate, QWORD now)
 					mosaic->RenderOverlayText(it->second->name,mosaic->GetLeft(i),mosaic->GetTop(i)+mosaic->GetHeight(i)-height,mosaic->GetWidth(i),height,properties);
 				}
 
-				//Get output
-				PipeVideoOutput *output = it->second->output;
+				//Get source and output
+				VideoSource *source = it->second;
+				PipeVideoOutput *output = source->output;
 				
-				//Lock it
-				output->Lock();
-
-				//If we've got a new frame or the participant image was not in slot yet
-				if ((output && output->IsChanged(version)) || changed)
-				{
-					//Change mosaic
-					mosaic->Update(i,output->GetFrame(),output->GetWidth(),output->GetHeight(),keepAspectRatio);
+				//Update slot
+				tasks.emplace_back([this,mosaic,source,output,i,partId,changed,&updated,&skipped](){
+					//Lock it
+					output->Lock();
 
-					//Check if debug is enabled
-					if (vadMode!=NoVAD && proxy && Logger::IsDebugEnabled())
+					//If we've got a new frame or the participant image was not in slot yet
+					if ((output && output->IsChanged(version)) || changed)
 					{
-						//Get vad
-						DWORD vad = proxy->GetVAD(partId);
-						//Set VU meter
-						mosaic->DrawVUMeter(i,vad,48000);
+						//Get slot size
+						int width = mosaic->GetWidth(i);
+						int height = mosaic->GetHeight(i);
+						//Get frame resized to it, shared with other slots and mosaics with same size
+						BYTE* frame = source->scaled.Get(output->GetFrameNum(),output->GetFrame(),output->GetWidth(),output->GetHeight(),width,height,keepAspectRatio);
+						//Change mosaic
+						if (frame)
+							mosaic->Update(i,frame,width,height,keepAspectRatio);
+						else
+							mosaic->Update(i,output->GetFrame(),output->GetWidth(),output->GetHeight(),keepAspectRatio);
+
+						//Check if debug is enabled
+						if (vadMode!=NoVAD && proxy && Logger::IsDebugEnabled())
+						{
+							//Get vad
+							DWORD vad = proxy->GetVAD(partId);
+							//Set VU meter
+							mosaic->DrawVUMeter(i,vad,48000);
+						}
+						//Updated
+						updated++;
+					} else {
+						//Nothing new
+						skipped++;
 					}
-				}
-				//Release it
-				output->Unlock();
+					//Release it
+					output->Unlock();
+				});
 			} else if (changed) {
 				//Clean position
-				mosaic->Clean(i,logo);
+				tasks.emplace_back([this,mosaic,i](){ mosaic->Clean(i,logo); });
 			}
 		}
+		
+		//If slots don't overlap
+		if (workers && !mosaic->HasOverlappingSlots())
+			//Update them in parallel
+			workers->Run(tasks);
+		else
+			//Update them in order
+			for (auto& task : tasks)
+				task();
+		
+		//Update stats
+		mosaic->AddComposeStats(getTime()-start,updated,skipped);
+		
 		//Free mem
 		free(oldPos);
 		free(newPos);
@@ -287,6 +326,17 @@ void VideoMixer::Process(bool forceUpdate, QWORD now)
 		source->refresh = true;
 	}
 	
+	//For each mosaic input
+	for (auto& [mosaicId,input] : mosaicInputs)
+	{
+		//Get mosaic
+		auto it = mosaics.find(mosaicId);
+		//If found
+		if (it!=mosaics.end())
+			//Set frame
+			input->SetFrame(it->second->GetFrame(),it->second->GetWidth(),it->second->GetHeight());
+	}
+	
 	//Reset overlays if displaying names
 	if (displayNames) 
 		//For each mosaic
@@ -438,6 +488,83 @@ int VideoMixer::GetMosaicPositions(int mosaicId,std::list<int> &positions)
 	return numSlots;
 }
 
+int VideoMixer::GetMosaicStats(int mosaicId,Mosaic::Stats &stats)
+{
+	//Protegemos la lista
+	lstVideosUse.IncUse();
+	
+	//Get mosaic from id
+	Mosaics::iterator it = mosaics.find(mosaicId);
+
+	//Check if we have found it
+	if (it==mosaics.end())
+	{
+		//Unlock
+		lstVideosUse.DecUse();
+		//error
+		return Error("Mosaic not found [id:%d]\n",mosaicId);
+	}
+
+	//Copy them
+	stats = it->second->GetStats();
+
+	//Unlock
+	lstVideosUse.DecUse();
+	
+	//Exit
+	return 1;
+}
+
+int VideoMixer::AddMosaicInput(int mosaicId,PipeVideoInput* input)
+{
+	Log("-AddMosaicInput [id:%d]\n",mosaicId);
+
+	//Protegemos la lista
+	lstVideosUse.WaitUnusedAndLock();
+
+	//Check mosaic
+	if (mosaics.find(mosaicId)==mosaics.end())
+	{
+		//Unlock
+		lstVideosUse.Unlock();
+		//Error
+		return Error("Mosaic not found [id:%d]\n",mosaicId);
+	}
+
+	//Add it
+	mosaicInputs.emplace(mosaicId,input);
+
+	//Unlock
+	lstVideosUse.Unlock();
+
+	//Done
+	return 1;
+}
+
+int VideoMixer::RemoveMosaicInput(int mosaicId,PipeVideoInput* input)
+{
+	Log("-RemoveMosaicInput [id:%d]\n",mosaicId);
+
+	//Protegemos la lista
+	lstVideosUse.WaitUnusedAndLock();
+
+	//Find it
+	auto range = mosaicInputs.equal_range(mosaicId);
+	auto it = std::find_if(range.first,range.second,[=](const auto& pair){ return pair.second==input; });
+	//Not found if it was already removed when deleting the mosaic or ending the mixer
+	bool found = it!=range.second;
+
+	//If found
+	if (found)
+		//Remove it, frames are not set on it anymore once we unlock
+		mosaicInputs.erase(it);
+
+	//Unlock
+	lstVideosUse.Unlock();
+
+	return found;
+}
+
 /***********************
 * Init
 *	Inicializa el mezclado de video
@@ -457,6 +584,13 @@ int VideoMixer::Init(const Properties &properties)
 	//Get overlay children properties
 	properties.GetChildren("overlay",overlay);
 	overlay.GetChildren("speaking",overlaySpeaking);
+	
+	//Get number of threads for updating slots, mixing thread also does
+	int numWorkers = properties.GetProperty("mosaics.workers", (int)std::min(3u,std::thread::hardware_concurrency()/2));
+	//If enabled
+	if (numWorkers>0)
+		//Create them
+		workers = std::make_unique<WorkerPool>(numWorkers);
 		
 	//Load file
 	logo.Load(logoFile);
@@ -541,9 +675,15 @@ int VideoMixer::End()
 	//Clean list
 	mosaics.clear();
 	
+	//Stop feeding mosaic inputs, they are released by their owners
+	mosaicInputs.clear();
+	
 	//Close logo
 	logo.Close();
 
+	//Stop workers
+	workers.reset();
+
 	//Desprotegemos la lista
 	lstVideosUse.Unlock();
 
@@ -1318,6 +1458,9 @@ int VideoMixer::DeleteMosaic(int mosaicId)
 	//Remove mosaic
 	mosaics.erase(it);
 
+	//Stop feeding its inputs, they are released by their owners
+	mosaicInputs.erase(mosaicId);
+
 	//Blcok
 	lstVideosUse.Unlock();
 
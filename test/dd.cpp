@@ -35,6 +35,9 @@ public:
 		Log("Serialize+Parser\n");
 		testSerializeParser();
 		
+		Log("testSharedStructure\n");
+		testSharedStructure();
+		
 		end();
 	}
 	
@@ -176,6 +179,64 @@ public:
 		}
 
 	}
+	
+	void testSharedStructure()
+	{
+		BYTE buffer[256];
+		RTPMap rtpMap;
+		RTPMap extMap;
+		rtpMap[96] = VideoCodec::AV1;
+		extMap[5] = RTPHeaderExtension::DependencyDescriptor;
+		
+		DependencyDescriptor dd;
+		dd.templateDependencyStructure = TemplateDependencyStructure{};
+		dd.templateDependencyStructure->dtsCount = 2;
+		dd.templateDependencyStructure->chainsCount = 2;
+		dd.templateDependencyStructure->frameDependencyTemplates.emplace_back(FrameDependencyTemplate{
+			{0, 0}, 
+			{DecodeTargetIndication::Switch, DecodeTargetIndication::Required},
+			{},
+			{0,0}
+		});
+		dd.templateDependencyStructure->decodeTargetProtectedByChain = {0,0};
+		
+		//Delta frame with no structure
+		DependencyDescriptor delta = {true, true, 0, 2};
+		
+		auto parse = [&](DependencyDescriptor& descriptor, WORD seqNum, const TemplateDependencyStructure::shared& current) {
+			RTPPacket packet(MediaFrame::Video,VideoCodec::AV1);
+			packet.SetType(96);
+			packet.SetSeqNum(seqNum);
+			packet.SetDependencyDescriptor(descriptor);
+			DWORD len = packet.Serialize(buffer,sizeof(buffer),extMap);
+			assert(len);
+			auto parsed = RTPPacket::Parse(buffer,len,rtpMap,extMap);
+			assert(parsed);
+			assert(parsed->ParseDependencyDescriptor(current,std::nullopt));
+			return parsed;
+		};
+		
+		//First key frame creates the structure
+		auto first = parse(dd,1,nullptr);
+		auto structure = first->GetTemplateDependencyStructure();
+		assert(structure);
+		assert(*structure==dd.templateDependencyStructure.value());
+		
+		//Delta frames and clones reuse it
+		auto second = parse(delta,2,structure);
+		assert(second->GetTemplateDependencyStructure()==structure);
+		assert(second->Clone()->GetTemplateDependencyStructure()==structure);
+		
+		//Same structure on next key frame is not copied again
+		auto third = parse(dd,3,structure);
+		assert(third->GetTemplateDependencyStructure()==structure);
+		
+		//New structure replaces it
+		dd.templateDependencyStructure->templateIdOffset = 1;
+		auto fourth = parse(dd,4,structure);
+		assert(fourth->GetTemplateDependencyStructure()!=structure);
+		assert(fourth->GetTemplateDependencyStructure()->templateIdOffset==1);
+	}
 		
 };
 
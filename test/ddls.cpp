@@ -79,6 +79,8 @@ struct FrameDescription
 std::vector<RTPPacket::shared> generateRTPStream(const std::vector<FrameDescription>& frames, const TemplateDependencyStructure& templateDependencyStructure, const std::vector<int> lost = {})
 {
 	std::vector<RTPPacket::shared> packets;
+	//Shared by all packets, as the incoming source group does
+	auto sharedTemplateDependencyStructure = std::make_shared<const TemplateDependencyStructure>(templateDependencyStructure);
 	
 	//For each frame
 	for (const auto& frame : frames)
@@ -113,7 +115,7 @@ std::vector<RTPPacket::shared> generateRTPStream(const std::vector<FrameDescript
 			
 		//Set dependency descriptor and template dependency structure
 		packet->SetDependencyDescriptor(dependencyDescriptor);
-		packet->OverrideTemplateDependencyStructure(templateDependencyStructure);
+		packet->OverrideTemplateDependencyStructure(sharedTemplateDependencyStructure);
 		
 		packets.push_back(packet);
 	}
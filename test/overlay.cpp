@@ -1,6 +1,9 @@
 #include "test.h"
 #include "overlay.h"
 
+#include <cstdlib>
+#include <vector>
+
 
 
 class OverlayTestPlan: public TestPlan
@@ -24,9 +27,65 @@ public:
 	}
 
 	
+	void draw()
+	{
+		//Not multiple of tile size to test remaining pixels
+		DWORD width = 72;
+		DWORD height = 8;
+		DWORD numpixels = width*height;
+		
+		Canvas canvas(width,height);
+		
+		//Random frame
+		std::vector<BYTE> frame(numpixels*3/2);
+		for (auto& pixel : frame)
+			pixel = rand();
+		std::vector<BYTE> image(numpixels*3/2);
+		
+		//Get overlay planes
+		BYTE* overlay = canvas.GetCanvas();
+		BYTE* alpha = overlay+numpixels*3/2;
+		//Random overlay
+		for (DWORD i=0; i<numpixels*3/2; ++i)
+			overlay[i] = rand();
+		//Only some parts visible, including fully opaque and last tile
+		for (DWORD j=0; j<height; ++j)
+			for (DWORD i=0; i<width; ++i)
+				alpha[j*width+i] = j<2 ? 0 : i<20 ? 255 : i<40 ? 0 : rand();
+		
+		//Draw
+		canvas.Draw(image.data(),frame.data());
+		
+		//Check against per pixel blend
+		for (DWORD j=0; j<height; ++j)
+			for (DWORD i=0; i<width; ++i)
+			{
+				DWORD p = j*width+i;
+				DWORD a = alpha[p];
+				assert(image[p]==(overlay[p]*a+frame[p]*(255-a))/255);
+			}
+		for (DWORD j=0; j<height/2; ++j)
+			for (DWORD i=0; i<width/2; ++i)
+			{
+				DWORD p = j*2*width+i*2;
+				DWORD a = (alpha[p]+alpha[p+1]+alpha[p+width]+alpha[p+width+1]+2)/4;
+				DWORD u = numpixels+j*width/2+i;
+				DWORD v = numpixels*5/4+j*width/2+i;
+				assert(image[u]==(overlay[u]*a+frame[u]*(255-a))/255);
+				assert(image[v]==(overlay[v]*a+frame[v]*(255-a))/255);
+			}
+		
+		//Clear overlay
+		canvas.Reset();
+		canvas.Draw(image.data(),frame.data());
+		//Frame is not modified
+		assert(image==frame);
+	}
+	
 	virtual void Execute()
 	{
 		canvas();
+		draw();
 	}
 	
 };
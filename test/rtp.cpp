@@ -1,5 +1,9 @@
 #include "test.h"
 #include "rtp.h"
+#include "rtp/RTPBuffer.h"
+#include "rtp/RTPPacketHistory.h"
+#include <thread>
+#include <functional>
 
 class RTPTestPlan: public TestPlan
 {
@@ -50,6 +54,20 @@ public:
 		testExtTimestamp();
 		Log("testlostPackets\n");
 		testlostPackets();
+		Log("testClonedSerialization\n");
+		testClonedSerialization();
+		Log("testClonedSerializationFanout\n");
+		testClonedSerializationFanout();
+		Log("testCrossThreadRelease\n");
+		testCrossThreadRelease();
+		Log("testRTPBuffer\n");
+		testRTPBuffer();
+		Log("testPacketHistory\n");
+		testPacketHistory();
+		Log("testRTCPCompoundView\n");
+		testRTCPCompoundView();
+		Log("testSendProfile\n");
+		testSendProfile();
 		end();
 	}
 	
@@ -873,7 +891,9 @@ public:
 
 	RTCPRTPFeedback::NACKField* nack(RTPLostPackets& lost)
 	{
-		auto list = lost.GetNacks();
+		//Keep them alive after returning
+		static std::list<RTCPRTPFeedback::NACKField::shared> list;
+		list = lost.GetNacks();
 		return (RTCPRTPFeedback::NACKField * )(list.begin()->get());
 	}
 
@@ -899,6 +919,537 @@ public:
 		rtp->SetTime(20); rtp->SetExtSeqNum(20); assert(lost.AddPacket(rtp) == 3); lost.Dump(); assert(nack(lost)->pid == 17); assert(nack(lost)->blp == 0b0011);
 		rtp->SetTime(25); rtp->SetExtSeqNum(25); assert(lost.AddPacket(rtp) == 3); lost.Dump(); assert(nack(lost)->pid == 22); assert(nack(lost)->blp == 0b0011);
 
+		//Nacks are not repeated until an rtt has passed
+		RTPLostPackets tracker(2048);
+		RTCPRTPFeedback::NACKField fields[8];
+		rtp->SetExtSeqNum(100); assert(tracker.AddPacket(rtp) == 0);
+		rtp->SetExtSeqNum(200); assert(tracker.AddPacket(rtp) == 99);
+		assert(tracker.GetTotal() == 99);
+		assert(tracker.GetNacks(fields,8,1000,50) == 6);
+		assert(fields[0].pid == 101); assert(fields[0].blp == 0xFFFF);
+		assert(fields[5].pid == 186); assert(fields[5].blp == 0x1FFF);
+		assert(tracker.GetNacks().size() == 6);
+		assert(tracker.GetNacks(fields,8,1020,50) == 0);
+		//Recovered ones are not nacked again
+		rtp->SetExtSeqNum(101); assert(tracker.AddPacket(rtp) == 0);
+		assert(tracker.GetTotal() == 98);
+		assert(tracker.GetNacks(fields,8,1050,50) == 6);
+		assert(fields[0].pid == 102);
+		//Output is limited to the buffer
+		assert(tracker.GetNacks(fields,2,1100,50) == 2);
+		//Until max retries
+		for (QWORD now=1150; now<2000; now+=50)
+			tracker.GetNacks(fields,8,now,50);
+		assert(tracker.GetNacks(fields,8,5000,50) == 0);
+		assert(tracker.GetTotal() == 98);
+	}
+	
+	void testRTPBuffer()
+	{
+		RTPBuffer buffer;
+		buffer.SetMaxWaitTime(100);
+		
+		auto packet = [](DWORD extSeqNum, QWORD time, DWORD length = 1) {
+			auto rtp = std::make_shared<RTPPacket>(MediaFrame::Video,VideoCodec::VP8,time);
+			rtp->SetExtSeqNum(extSeqNum);
+			rtp->SetMediaLength(length);
+			return rtp;
+		};
+		
+		//Out of order
+		assert(buffer.Add(packet(10,0)));
+		assert(buffer.Add(packet(12,0)));
+		assert(buffer.Add(packet(11,0)));
+		assert(!buffer.Add(packet(12,0)));
+		assert(buffer.Length()==3);
+		assert(buffer.GetOrdered(0)->GetExtSeqNum()==10);
+		assert(buffer.GetOrdered(0)->GetExtSeqNum()==11);
+		assert(buffer.GetOrdered(0)->GetExtSeqNum()==12);
+		assert(!buffer.GetOrdered(0));
+		//Already past
+		assert(!buffer.Add(packet(11,0)));
+		
+		//Wait for lost one, 13 is missing
+		assert(buffer.Add(packet(14,10)));
+		assert(!buffer.GetOrdered(50));
+		assert(buffer.GetWaitTime(50)==60);
+		assert(buffer.GetOrdered(110)->GetExtSeqNum()==14);
+		
+		//Empty packets are skipped
+		assert(buffer.Add(packet(15,200,0)));
+		assert(buffer.Add(packet(16,200)));
+		assert(buffer.GetOrdered(200)->GetExtSeqNum()==16);
+		assert(buffer.GetNumDiscardedPackets()==1);
+		
+		//Grow ring with packets far away
+		for (DWORD i=0;i<1000;++i)
+			assert(buffer.Add(packet(1016-i,300)));
+		buffer.HurryUp();
+		for (DWORD i=0;i<1000;++i)
+			assert(buffer.GetOrdered(300)->GetExtSeqNum()==17+i);
+		assert(!buffer.Length());
+		
+		//Hurry up with gaps
+		assert(buffer.Add(packet(2000,400)));
+		assert(buffer.Add(packet(1500,400)));
+		assert(!buffer.GetOrdered(400));
+		buffer.HurryUp();
+		assert(buffer.GetOrdered(400)->GetExtSeqNum()==1500);
+		assert(buffer.GetOrdered(400)->GetExtSeqNum()==2000);
+		
+		//Jump bigger than a cycle drops queued ones
+		assert(buffer.Add(packet(3000,500)));
+		assert(buffer.Add(packet(3000+RTPBuffer::MaxCapacity,500)));
+		assert(buffer.Length()==1);
+		assert(buffer.GetNumDiscardedPackets()==2);
+		buffer.Reset();
+		assert(!buffer.Length());
+	}
+	
+	void testPacketHistory()
+	{
+		RTPMap extMap;
+		extMap[1] = RTPHeaderExtension::MediaStreamId;
+		
+		RTPPacketHistory history(1000,4096);
+		
+		BYTE data[MTU];
+		BYTE expected[MTU];
+		BYTE payload[1000];
+		
+		auto send = [&](DWORD extSeqNum, QWORD now) {
+			auto rtp = std::make_shared<RTPPacket>(MediaFrame::Video,VideoCodec::VP8);
+			memset(payload,extSeqNum,sizeof(payload));
+			rtp->SetPayload(payload,sizeof(payload));
+			rtp->SetExtSeqNum(extSeqNum);
+			rtp->SetSSRC(0x1234);
+			rtp->SetMediaStreamId("video");
+			DWORD len = rtp->Serialize(data,MTU,extMap);
+			assert(len);
+			return history.Add(rtp,data,len,now);
+		};
+		
+		//Rebuilt packet is the same than sent one
+		assert(send(65534,0));
+		assert(send(65535,0));
+		assert(!send(65534,0));
+		assert(send(65536,0));
+		auto rtp = history.Get(0,10);
+		assert(rtp);
+		assert(rtp->GetExtSeqNum()==65536);
+		assert(rtp->GetMediaStreamId()=="video");
+		DWORD len = rtp->Serialize(expected,MTU,extMap);
+		assert(len && memcmp(data,expected,len)==0);
+		assert(history.Get(65534,10)->GetExtSeqNum()==65534);
+		assert(history.GetHits()==2);
+		
+		//Only fit 4 packets
+		for (DWORD i=65537;i<65545;++i)
+			assert(send(i,100));
+		assert(history.GetLength()==4);
+		assert(history.GetCapacity()<=4096);
+		assert(history.GetFirstSeq()==65541);
+		assert(!history.Get(65540 & 0xFFFF,100));
+		assert(history.Get(65541 & 0xFFFF,100)->GetMediaData()[0]==(BYTE)65541);
+		assert(history.GetEvicted()==7);
+		
+		//Too old
+		assert(!history.Get(65544 & 0xFFFF,1101));
+		assert(history.GetMisses()==2);
+		assert(send(65545,1101));
+		assert(history.GetLength()==1);
+		
+		//Bigger history for longer rtts
+		history.SetRTT(400);
+		history.SetMaxAge(2000);
+		assert(history.GetAge()==1600);
+		assert(history.Get(65545 & 0xFFFF,2700));
+		
+		//Subscribers of the same publisher reference its payloads
+		RTPPacketHistory first(1000,4096);
+		RTPPacketHistory second(1000,4096);
+		first.SetSharePayloads(true);
+		second.SetSharePayloads(true);
+		auto original = std::make_shared<RTPPacket>(MediaFrame::Video,VideoCodec::VP8);
+		memset(payload,7,sizeof(payload));
+		original->SetPayload(payload,sizeof(payload));
+		for (DWORD i=0;i<8;++i)
+		{
+			for (auto subscriber : {&first,&second})
+			{
+				auto cloned = original->Clone();
+				cloned->SetExtSeqNum(100+i);
+				DWORD len = cloned->Serialize(data,MTU,extMap);
+				assert(subscriber->Add(cloned,data,len,0));
+			}
+		}
+		assert(first.GetReferenced()==8 && second.GetReferenced()==8);
+		assert(first.GetLength()==8 && first.GetBytes()==0);
+		rtp = first.Get(103,10);
+		assert(rtp && rtp->GetMediaLength()==sizeof(payload));
+		assert(rtp->GetMediaData()==second.Get(103,10)->GetMediaData());
+		assert(rtp->GetMediaData()[sizeof(payload)-1]==7);
+	}
+	
+	void testRTCPCompoundView()
+	{
+		BYTE data[1024];
+		
+		//Sender report with a report block
+		auto sr = std::make_shared<RTCPSenderReport>();
+		sr->SetSSRC(0x1234);
+		sr->SetTimestamp(1600000000123456ull);
+		sr->SetRtpTimestamp(9000);
+		sr->SetPacketsSent(10);
+		sr->SetOctectsSent(1000);
+		auto report = std::make_shared<RTCPReport>();
+		report->SetSSRC(0x5678);
+		report->SetLostCount(3);
+		report->SetLastSR(0xABCD);
+		report->SetDelaySinceLastSRMilis(1500);
+		sr->AddReport(report);
+		DWORD len = RTCPCompoundPacket::Create(sr)->Serialize(data,sizeof(data));
+		
+		//Append feedback messages
+		RTCPCompoundBuilder builder(data+len,sizeof(data)-len);
+		RTCPRTPFeedback::NACKField nacks[2] = { {100,0x0003}, {200,0x8000} };
+		DWORD ssrcs[2] = { 0x5678, 0x9ABC };
+		RTCPRTPFeedback::TransportWideFeedbackMessageField twcc(7);
+		twcc.referenceTime = 64000;
+		twcc.packets[1000] = 64000;
+		twcc.packets[1001] = 0;
+		twcc.packets[1002] = 65000;
+		assert(builder.AddNACK(0x1234,0x5678,nacks,2));
+		assert(builder.AddPLI(0x1234,0x5678));
+		assert(builder.AddREMB(0x1234,1500000,ssrcs,2));
+		assert(builder.AddTransportWideFeedback(0x1234,0x5678,twcc));
+		len += builder.GetSize();
+		
+		//Not enought size
+		RTCPCompoundBuilder small(data,15);
+		assert(!small.AddNACK(0x1234,0x5678,nacks,1));
+		assert(!small.GetSize());
+		
+		//Must be parseable by compound packet too
+		auto rtcp = RTCPCompoundPacket::Parse(data,len);
+		assert(rtcp && rtcp->GetPacketCount()==5);
+		auto remb = rtcp->GetPacket<RTCPPayloadFeedback>(3);
+		assert(remb->GetFeedbackType()==RTCPPayloadFeedback::ApplicationLayerFeeedbackMessage);
+		
+		RTCPCompoundView view(data,len);
+		assert(view.IsValid());
+		
+		DWORD num = 0;
+		for (const auto& packet : view)
+		{
+			switch(num++)
+			{
+				case 0:
+				{
+					RTCPSenderReportView sr(packet);
+					assert(packet.GetType()==RTCPPacket::SenderReport);
+					assert(sr.IsValid());
+					assert(sr.GetSSRC()==0x1234);
+					assert(sr.GetTimestamp()/1000==1600000000123ull);
+					assert(sr.GetRTPTimestamp()==9000);
+					assert(sr.GetPacketsSent()==10);
+					assert(sr.GetOctectsSent()==1000);
+					assert(sr.GetCount()==1);
+					assert(sr.GetReport(0).GetSSRC()==0x5678);
+					assert(sr.GetReport(0).GetLostCount()==3);
+					assert(sr.GetReport(0).GetLastSR()==0xABCD);
+					assert(sr.GetReport(0).GetDelaySinceLastSRMilis()==report->GetDelaySinceLastSRMilis());
+					break;
+				}
+				case 1:
+				{
+					RTCPFeedbackView fb(packet);
+					assert(packet.GetType()==RTCPPacket::RTPFeedback);
+					assert(fb.GetFeedbackType()==RTCPRTPFeedback::NACK);
+					assert(fb.GetSenderSSRC()==0x1234);
+					assert(fb.GetMediaSSRC()==0x5678);
+					assert(fb.GetNACKCount()==2);
+					assert(fb.GetNACK(1).pid==200 && fb.GetNACK(1).blp==0x8000);
+					break;
+				}
+				case 2:
+				{
+					RTCPFeedbackView fb(packet);
+					assert(packet.GetType()==RTCPPacket::PayloadFeedback);
+					assert(fb.GetFeedbackType()==RTCPPayloadFeedback::PictureLossIndication);
+					assert(!fb.IsREMB());
+					break;
+				}
+				case 3:
+				{
+					RTCPFeedbackView fb(packet);
+					assert(fb.IsREMB());
+					assert(fb.GetREMBBitrate()==1500000);
+					assert(fb.GetREMBSSRCCount()==2);
+					assert(fb.GetREMBSSRC(1)==0x9ABC);
+					break;
+				}
+				case 4:
+				{
+					RTCPFeedbackView fb(packet);
+					assert(fb.GetFeedbackType()==RTCPRTPFeedback::TransportWideFeedbackMessage);
+					RTCPRTPFeedback::TransportWideFeedbackMessageField field;
+					assert(field.Parse(fb.GetFCI(),fb.GetFCISize())==fb.GetFCISize());
+					assert(field.feedbackPacketCount==7);
+					assert(field.packets==twcc.packets);
+					break;
+				}
+			}
+		}
+		assert(num==5);
+		
+		//Truncated
+		assert(!RTCPCompoundView(data,len-4).IsValid());
+	}
+	
+	void testClonedSerialization()
+	{
+		RTPMap extMap;
+		extMap[1] = RTPHeaderExtension::AbsoluteSendTime;
+		extMap[2] = RTPHeaderExtension::TransportWideCC;
+		extMap[3] = RTPHeaderExtension::MediaStreamId;
+		
+		BYTE payload[800];
+		for (size_t i=0;i<sizeof(payload);++i)
+			payload[i] = i;
+		
+		RTPPacket::shared rtp = std::make_shared<RTPPacket>(MediaFrame::Video,VideoCodec::VP8);
+		rtp->SetPayload(payload,sizeof(payload));
+		rtp->SetTimestamp(1000);
+		
+		BYTE first[MTU];
+		BYTE second[MTU];
+		BYTE expected[MTU];
+		
+		//Send it to several viewers, first one fills the shared serialization
+		for (DWORD i=0;i<4;++i)
+		{
+			auto cloned = rtp->Clone();
+			cloned->SetSSRC(0x1000+i);
+			cloned->SetSeqNum(100+i);
+			cloned->SetTransportSeqNum(200+i);
+			cloned->SetAbsSentTime(3000+i);
+			cloned->SetMediaStreamId("0");
+			
+			//Serialize same packet without sharing
+			RTPPacket alone(MediaFrame::Video,VideoCodec::VP8,cloned->GetRTPHeader(),cloned->GetRTPHeaderExtension());
+			alone.SetPayload(payload,sizeof(payload));
+			DWORD len = alone.Serialize(expected,MTU,extMap);
+			assert(len);
+			
+			//Must be the same
+			assert(cloned->Serialize(first,MTU,extMap)==len);
+			assert(memcmp(first,expected,len)==0);
+			
+			//Serializing twice gives same result
+			assert(cloned->Serialize(second,MTU,extMap)==len);
+			assert(memcmp(second,expected,len)==0);
+			
+			//Only stored once there is another clone to reuse it
+			assert(cloned->IsSerializationShared()==(i>0));
+		}
+		
+		//Different extensions on a clone must not use the shared one
+		auto cloned = rtp->Clone();
+		cloned->SetMediaStreamId("video");
+		cloned->DisableAbsSentTime();
+		RTPPacket alone(MediaFrame::Video,VideoCodec::VP8,cloned->GetRTPHeader(),cloned->GetRTPHeaderExtension());
+		alone.SetPayload(payload,sizeof(payload));
+		DWORD len = alone.Serialize(expected,MTU,extMap);
+		assert(cloned->Serialize(first,MTU,extMap)==len);
+		assert(memcmp(first,expected,len)==0);
+	}
+	
+	void testClonedSerializationFanout()
+	{
+		RTPMap extMap;
+		extMap[1] = RTPHeaderExtension::AbsoluteSendTime;
+		extMap[2] = RTPHeaderExtension::TransportWideCC;
+		extMap[3] = RTPHeaderExtension::MediaStreamId;
+		
+		BYTE payload[1000];
+		for (size_t i=0;i<sizeof(payload);++i)
+			payload[i] = i;
+		
+		const DWORD num = 8;
+		const DWORD rounds = 20000;
+		BYTE expected[MTU];
+		BYTE data[MTU];
+		
+		//Single viewer, nothing is stored
+		{
+			RTPPacket::shared rtp = std::make_shared<RTPPacket>(MediaFrame::Video,VideoCodec::VP8);
+			rtp->SetPayload(payload,sizeof(payload));
+			auto cloned = rtp->Clone();
+			cloned->SetMediaStreamId("0");
+			assert(cloned->Serialize(data,MTU,extMap));
+			assert(!cloned->IsSerializationShared());
+		}
+		
+		QWORD full = 0;
+		QWORD shared = 0;
+		
+		for (DWORD r=0;r<rounds;++r)
+		{
+			RTPPacket::shared rtp = std::make_shared<RTPPacket>(MediaFrame::Video,VideoCodec::VP8);
+			rtp->SetPayload(payload,sizeof(payload));
+			rtp->SetTimestamp(1000+r);
+			
+			//Clone for all the viewers before sending
+			std::vector<RTPPacket::shared> clones;
+			std::vector<RTPPacket::shared> alones;
+			for (DWORD i=0;i<num;++i)
+			{
+				auto cloned = rtp->Clone();
+				cloned->SetSSRC(0x1000+i);
+				cloned->SetSeqNum(r+i);
+				cloned->SetTransportSeqNum(r*num+i);
+				cloned->SetAbsSentTime(3000+i);
+				cloned->SetMediaStreamId("0");
+				clones.push_back(cloned);
+				
+				//Same packet without sharing
+				auto alone = std::make_shared<RTPPacket>(MediaFrame::Video,VideoCodec::VP8,cloned->GetRTPHeader(),cloned->GetRTPHeaderExtension());
+				alone->SetPayload(payload,sizeof(payload));
+				alones.push_back(alone);
+			}
+			
+			QWORD ini = getTime();
+			for (auto& alone : alones)
+				assert(alone->Serialize(expected,MTU,extMap));
+			full += getTime()-ini;
+			
+			ini = getTime();
+			for (auto& cloned : clones)
+				assert(cloned->Serialize(data,MTU,extMap));
+			shared += getTime()-ini;
+			
+			//Later clones reuse the stored bytes and are the same than without sharing
+			for (DWORD i=0;i<num;++i)
+			{
+				DWORD len = alones[i]->Serialize(expected,MTU,extMap);
+				assert(clones[i]->Serialize(data,MTU,extMap)==len);
+				assert(memcmp(data,expected,len)==0);
+				assert(clones[i]->IsSerializationShared());
+			}
+		}
+		
+		Log("-testClonedSerializationFanout() | %d clones x %d packets full:%lluus shared:%lluus\n",num,rounds,full,shared);
+	}
+	
+	void testCrossThreadRelease()
+	{
+		RTPMap rtpMap;
+		RTPMap extMap;
+		
+		BYTE data[12+200] = {
+			0x80, 0x60, 0x00, 0x01,
+			0x65, 0x43, 0x12, 0x78,
+			0x12, 0x34, 0x56, 0x78
+		};
+		
+		const DWORD num = 256;
+		size_t allocations = 0;
+		
+		for (DWORD r=0;r<10;++r)
+		{
+			//Parse on this thread
+			std::vector<RTPPacket::shared> packets;
+			for (DWORD i=0;i<num;++i)
+			{
+				auto packet = RTPPacket::Parse(data,sizeof(data),rtpMap,extMap);
+				assert(packet);
+				packets.push_back(packet);
+			}
+			
+			//After first round, blocks must come back from the releasing thread
+			if (r)
+				assert(ArenaAllocator<RTPPacket>::GetHeapAllocations()==allocations);
+			
+			//Release on other one
+			std::thread([&packets](){ packets.clear(); }).join();
+			
+			allocations = ArenaAllocator<RTPPacket>::GetHeapAllocations();
+		}
+		
+		//Packets outliving the parsing thread are freed when released
+		std::vector<RTPPacket::shared> packets;
+		std::thread([&](){
+			for (DWORD i=0;i<num;++i)
+				packets.push_back(RTPPacket::Parse(data,sizeof(data),rtpMap,extMap));
+		}).join();
+		packets.clear();
+		
+		//Allocating after the thread arena is gone falls back to the heap
+		struct Late
+		{
+			std::function<void()> func;
+			~Late() { func(); }
+		};
+		std::thread([&](){
+			//Destroyed after the arena as it is constructed before
+			static thread_local Late late;
+			late.func = [&](){
+				auto packet = RTPPacket::Parse(data,sizeof(data),rtpMap,extMap);
+				assert(packet);
+				packets.push_back(packet);
+			};
+			packets.push_back(RTPPacket::Parse(data,sizeof(data),rtpMap,extMap));
+		}).join();
+		assert(packets.size()==2);
+		packets.clear();
+	}
+	
+	void testSendProfile()
+	{
+		RTPMap rtp;
+		rtp[96]  = VideoCodec::VP8;
+		rtp[97]  = VideoCodec::RTX;
+		rtp[98]  = VideoCodec::H264;
+		rtp[99]  = VideoCodec::RTX;
+		rtp[111] = AudioCodec::OPUS;
+		RTPMap apt;
+		apt[97] = 96;
+		apt[99] = 98;
+		RTPMap ext;
+		ext[3] = RTPHeaderExtension::AbsoluteSendTime;
+		ext[5] = RTPHeaderExtension::TransportWideCC;
+		
+		RTPSendProfile profile;
+		assert(!profile.HasRTX());
+		assert(profile.GetPayloadType(VideoCodec::VP8)==RTPMap::NotFound);
+		
+		profile.Compile(rtp,ext,apt);
+		
+		//Same values than the maps
+		for (BYTE codec : {VideoCodec::VP8,VideoCodec::H264,VideoCodec::RTX,VideoCodec::AV1,(VideoCodec::Type)AudioCodec::OPUS})
+			assert(profile.GetPayloadType(codec)==rtp.GetTypeForCodec(codec));
+		for (BYTE pt : {96,98,111})
+			assert(profile.GetRTXPayloadType(pt)==apt.GetTypeForCodec(pt));
+		assert(profile.HasRTX());
+		assert(profile.GetDefaultRTXPayloadType()==97);
+		assert(profile.HasCodec(VideoCodec::RTX));
+		assert(profile.HasExtension(RTPHeaderExtension::TransportWideCC));
+		assert(profile.HasExtension(RTPHeaderExtension::AbsoluteSendTime));
+		assert(!profile.HasExtension(RTPHeaderExtension::MediaStreamId));
+		
+		//Serialization with compiled ids must be the same
+		RTPPacket packet(MediaFrame::Video,VideoCodec::VP8);
+		BYTE payload[100] = {};
+		packet.SetPayload(payload,sizeof(payload));
+		packet.SetTransportSeqNum(200);
+		packet.SetAbsSentTime(3000);
+		BYTE expected[MTU];
+		BYTE data[MTU];
+		DWORD len = packet.Serialize(expected,MTU,ext);
+		assert(len);
+		assert(packet.Serialize(data,MTU,profile.GetExtensionIds())==len);
+		assert(memcmp(data,expected,len)==0);
 	}
 	
 };
@@ -0,0 +1,160 @@
+#include "test.h"
+#include "SRTPSession.h"
+#include "rtp.h"
+#include <chrono>
+
+class SRTPTestPlan: public TestPlan
+{
+public:
+	SRTPTestPlan() : TestPlan("SRTP test plan")
+	{
+
+	}
+
+	int init()
+	{
+		Log("SRTP::Init\n");
+		srtp_init();
+		return true;
+	}
+
+	int end()
+	{
+		Log("SRTP::End\n");
+		return true;
+	}
+
+	virtual void Execute()
+	{
+		init();
+
+		for (const auto& suite : Suites)
+		{
+			Log("testBatch %s\n", suite.name);
+			testBatch(suite.name, suite.keyLength);
+		}
+
+		end();
+	}
+
+	struct Suite
+	{
+		const char* name;
+		size_t keyLength;
+	};
+
+	static constexpr Suite Suites[] = {
+		{ "AES_CM_128_HMAC_SHA1_80",	30 },
+		{ "AES_CM_128_HMAC_SHA1_32",	30 },
+		{ "AEAD_AES_128_GCM",		28 },
+		{ "AEAD_AES_256_GCM",		44 },
+	};
+
+	//Same number of packets read at once by the event loop
+	static constexpr size_t BatchSize = 128;
+	static constexpr size_t PayloadSize = 1000;
+	static constexpr size_t Rounds = 200;
+
+	static size_t CreatePacket(BYTE* data, WORD seq)
+	{
+		RTPHeader header;
+		header.payloadType = 96;
+		header.sequenceNumber = seq;
+		header.timestamp = seq * 3000;
+		header.ssrc = 0x12345678;
+		//Serialize header
+		size_t len = header.Serialize(data, MTU);
+		//Fill payload
+		memset(data + len, seq, PayloadSize);
+		return len + PayloadSize;
+	}
+
+	void testBatch(const char* suite, size_t keyLength)
+	{
+		std::vector<BYTE> key(keyLength);
+		for (size_t i = 0; i<keyLength; ++i)
+			key[i] = i;
+
+		SRTPSession send;
+		SRTPSession recv;
+		assert(send.Setup(suite, key.data(), key.size()));
+		assert(recv.Setup(suite, key.data(), key.size()));
+
+		static BYTE buffers[BatchSize][MTU + SRTP_MAX_TRAILER_LEN];
+		static BYTE original[BatchSize][MTU];
+		iovec packets[BatchSize];
+		size_t sizes[BatchSize];
+
+		WORD seq = 0;
+
+		//Check batched protection can be unprotected per packet and the other way around
+		for (size_t i = 0; i<BatchSize; ++i)
+		{
+			sizes[i] = CreatePacket(original[i], seq++);
+			memcpy(buffers[i], original[i], sizes[i]);
+			packets[i] = { buffers[i], sizes[i] };
+		}
+		assert(send.ProtectRTP(packets, BatchSize)==BatchSize);
+		for (size_t i = 0; i<BatchSize; ++i)
+		{
+			assert(packets[i].iov_len>sizes[i]);
+			assert(recv.UnprotectRTP(buffers[i], packets[i].iov_len)==sizes[i]);
+			assert(memcmp(buffers[i], original[i], sizes[i])==0);
+		}
+		for (size_t i = 0; i<BatchSize; ++i)
+		{
+			sizes[i] = CreatePacket(original[i], seq++);
+			memcpy(buffers[i], original[i], sizes[i]);
+			packets[i] = { buffers[i], send.ProtectRTP(buffers[i], sizes[i]) };
+			assert(packets[i].iov_len);
+		}
+		assert(recv.UnprotectRTP(packets, BatchSize)==BatchSize);
+		for (size_t i = 0; i<BatchSize; ++i)
+		{
+			assert(packets[i].iov_len==sizes[i]);
+			assert(memcmp(buffers[i], original[i], sizes[i])==0);
+		}
+
+		//Replayed packets fail but don't stop the batch
+		CreatePacket(buffers[0], seq - 1);
+		packets[0] = { buffers[0], send.ProtectRTP(buffers[0], sizes[0]) };
+		CreatePacket(buffers[1], seq++);
+		packets[1] = { buffers[1], send.ProtectRTP(buffers[1], sizes[1]) };
+		assert(recv.UnprotectRTP(packets, 2)==1);
+		assert(packets[0].iov_len==0);
+		assert(packets[1].iov_len==sizes[1]);
+		assert(recv.GetLastStatus()==SRTPSession::ReplayFail);
+
+		//Benchmark per packet against batched protection
+		auto bench = [&](bool batched) {
+			std::chrono::nanoseconds elapsed(0);
+			for (size_t round = 0; round<Rounds; ++round)
+			{
+				for (size_t i = 0; i<BatchSize; ++i)
+					sizes[i] = CreatePacket(buffers[i], seq++);
+				auto start = std::chrono::steady_clock::now();
+				if (batched)
+				{
+					for (size_t i = 0; i<BatchSize; ++i)
+						packets[i] = { buffers[i], sizes[i] };
+					send.ProtectRTP(packets, BatchSize);
+				} else {
+					for (size_t i = 0; i<BatchSize; ++i)
+						send.ProtectRTP(buffers[i], sizes[i]);
+				}
+				elapsed += std::chrono::steady_clock::now() - start;
+			}
+			//Get packets per second
+			return (double)(Rounds * BatchSize) * 1E9 / elapsed.count();
+		};
+
+		double single = bench(false);
+		double batched = bench(true);
+
+		Log("-%s protect [single:%.0fpps,batched:%.0fpps,payload:%.0fMbps]\n", suite, single, batched, batched * PayloadSize * 8 / 1E6);
+	}
+};
+
+constexpr SRTPTestPlan::Suite SRTPTestPlan::Suites[];
+
+SRTPTestPlan srtp;
@@ -3,7 +3,18 @@
 #include "acumulator.h"
 #include "MovingCounter.h"
 #include "CircularBuffer.h"
+#include "RemoteAddressMap.h"
+#include "PacketPool.h"
+#include "Pacer.h"
+#include "SmallFunction.h"
+#include "WorkerPool.h"
+#include "EventLoop.h"
+#include <thread>
 #include <algorithm>
+#include <atomic>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
 
 class ToolsPlan : public TestPlan
 {
@@ -19,9 +30,185 @@ public:
 		testCircularQueue();
 		testAccumulator();
 		testCircularBuffer();
+		testRemoteAddressMap();
+		testPacketPool();
+		testPacer();
+		testSmallFunction();
+		testWorkerPool();
+		testTimerWheelRound();
+		testUringRecvError();
 
 	}
 
+	void testRemoteAddressMap()
+	{
+		Log("-testRemoteAddressMap\n");
+
+		RemoteAddressMap<int> remotes(4);
+		std::vector<int> values(1000);
+
+		//Add enough to grow several times
+		for (int i = 0; i < 1000; ++i)
+			remotes.Set(0x0A000000 + i/10, 5000 + i%10, &values[i]);
+
+		assert(remotes.GetSize() == 1000);
+		for (int i = 0; i < 1000; ++i)
+			assert(remotes.Find(0x0A000000 + i/10, 5000 + i%10) == &values[i]);
+		assert(!remotes.Find(0x0A000000, 4999));
+
+		//Update existing one
+		remotes.Set(0x0A000000, 5000, &values[999]);
+		assert(remotes.GetSize() == 1000);
+		assert(remotes.Find(0x0A000000, 5000) == &values[999]);
+
+		//Remove half of them, including the last hit
+		for (int i = 0; i < 1000; i += 2)
+			assert(remotes.Remove(0x0A000000 + i/10, 5000 + i%10));
+		assert(!remotes.Remove(0x0A000000, 5000));
+
+		//Check the rest are still reachable after shifting clusters
+		assert(remotes.GetSize() == 500);
+		for (int i = 0; i < 1000; ++i)
+			assert(remotes.Find(0x0A000000 + i/10, 5000 + i%10) == (i % 2 ? &values[i] : nullptr));
+
+		remotes.Clear();
+		assert(remotes.IsEmpty());
+		assert(!remotes.Find(0x0A000000, 5001));
+	}
+
+	void testPacketPool()
+	{
+		Log("-testPacketPool\n");
+
+		PacketPool pool(64);
+		pool.SetOwner(std::this_thread::get_id());
+
+		//Get one of each class
+		Packet rtcp = pool.pick(100);
+		Packet rtp = pool.pick();
+		Packet jumbo = pool.pick(2000);
+		Packet huge = pool.pick(PacketPool::JumboPacketSize + 1);
+		assert(rtcp.GetCapacity() == PacketPool::RTCPPacketSize);
+		assert(rtp.GetCapacity() == MTU);
+		assert(jumbo.GetCapacity() == PacketPool::JumboPacketSize);
+		assert(huge.GetCapacity() > PacketPool::JumboPacketSize);
+
+		//RTP ones are preallocated
+		assert(pool.GetStats(PacketPool::RTP).hits == 1);
+		assert(pool.GetStats(PacketPool::RTCP).misses == 1);
+		assert(pool.GetStats(PacketPool::Jumbo).misses == 2);
+
+		//Grow the rtp one, it can be reused as jumbo
+		rtp.SetData(huge.GetData(), PacketPool::JumboPacketSize);
+		pool.release(std::move(rtcp));
+		pool.release(std::move(rtp));
+		pool.release(std::move(jumbo));
+		assert(pool.GetStats(PacketPool::Jumbo).released == 2);
+		rtcp = pool.pick(100);
+		jumbo = pool.pick(10000);
+		assert(rtcp.GetCapacity() == PacketPool::RTCPPacketSize);
+		assert(jumbo.GetCapacity() == PacketPool::JumboPacketSize);
+		assert(pool.GetStats(PacketPool::RTCP).hits == 1);
+		assert(pool.GetStats(PacketPool::Jumbo).hits == 1);
+		pool.release(std::move(rtcp));
+		pool.release(std::move(jumbo));
+
+		//Pick on other threads and release on ours
+		std::vector<Packet> packets;
+		for (int i = 0; i < 4; ++i)
+		{
+			std::thread thread([&](){
+				for (int j = 0; j < 32; ++j)
+					packets.emplace_back(pool.pick());
+			});
+			thread.join();
+		}
+		assert(pool.GetStats(PacketPool::RTP).highWater >= 128);
+		for (auto& packet : packets)
+			pool.release(std::move(packet));
+
+		//And release on other thread what is picked on ours
+		packets.clear();
+		for (int i = 0; i < 128; ++i)
+			packets.emplace_back(pool.pick());
+		std::thread([&](){
+			for (auto& packet : packets)
+				pool.release(std::move(packet));
+		}).join();
+
+		//Everything is back and not more than the limit is kept
+		auto stats = pool.GetStats();
+		assert(stats.inUse == 0);
+		assert(stats.released == 261);
+		assert(pool.GetStats(PacketPool::RTP).dropped > 0);
+	}
+
+	void testPacer()
+	{
+		Log("-testPacer\n");
+
+		Pacer pacer;
+		Pacer::Class type;
+		QWORD now = 1000;
+
+		auto packet = [](DWORD length) {
+			auto rtp = std::make_shared<RTPPacket>(MediaFrame::Video,VideoCodec::VP8);
+			rtp->SetMediaLength(length);
+			return rtp;
+		};
+
+		//Not paced, everything is released at once
+		for (int i=0;i<3;++i)
+			pacer.Enqueue(Pacer::Video,packet(1000),now);
+		for (int i=0;i<3;++i)
+			assert(pacer.Dequeue(now,type) && type==Pacer::Video);
+		assert(pacer.IsEmpty());
+		assert(pacer.GetWaitTime(now)==(QWORD)-1);
+
+		//Pace at 1mbps
+		pacer.SetBitrate(1000000);
+		for (int i=0;i<10;++i)
+			pacer.Enqueue(Pacer::Video,packet(1000),now);
+		pacer.Enqueue(Pacer::Retransmission,packet(1000),now);
+		pacer.Enqueue(Pacer::Audio,packet(100),now);
+
+		//Audio goes first, even without budget
+		assert(pacer.Dequeue(now,type) && type==Pacer::Audio);
+		pacer.OnSent(now,100);
+		assert(!pacer.Dequeue(now,type));
+		assert(pacer.GetWaitTime(now)>0);
+
+		//Then retransmissions and video, spread over time
+		QWORD start = now;
+		DWORD sent = 0;
+		while (!pacer.IsEmpty())
+		{
+			now += pacer.GetWaitTime(now);
+			while (auto rtp = pacer.Dequeue(now,type))
+			{
+				assert(type==(sent ? Pacer::Video : Pacer::Retransmission));
+				pacer.OnSent(now,rtp->GetMediaLength());
+				sent++;
+			}
+		}
+		assert(sent==11);
+		//11000 bytes at 2.5mbps takes 35ms, minus the initial burst
+		assert(now-start>25000 && now-start<40000);
+
+		//Queue is drained in time even if the bitrate is too low
+		for (int i=0;i<500;++i)
+			pacer.Enqueue(Pacer::Video,packet(1000),now);
+		start = now;
+		while (!pacer.IsEmpty())
+		{
+			now += pacer.GetWaitTime(now);
+			while (auto rtp = pacer.Dequeue(now,type))
+				pacer.OnSent(now,rtp->GetMediaLength());
+		}
+		assert(now-start<=Pacer::MaxQueueTime+10000);
+		pacer.Clear();
+	}
+
 	void testCircularQueue()
 	{
 		Log("-testCircularQueue\n");
@@ -369,8 +556,10 @@ public:
 				assert(buffer.Set(i, i));
 				//Log("%i %i %i %i %d\n", i, buffer.Get(i).value(), buffer.GetFirstSeq(), buffer.GetLastSeq(), buffer.GetLength());
 				assert(buffer.IsPresent(i)); assert(buffer.Get(i).value() == i); assert(buffer.GetLastSeq() == i % 256);
+				assert(buffer.GetLastExtSeq() == i);
 			}
 
+			assert(buffer.GetFirstExtSeq() == 389);
 			assert(!buffer.Set(buffer.GetLastSeq() - 11, 0));
 		}
 
@@ -431,6 +620,177 @@ public:
 		}
 	}
 
+	void testSmallFunction()
+	{
+		Log("-testSmallFunction\n");
+
+		auto counter = std::make_shared<int>(0);
+
+		//Small captures are stored inline
+		SmallFunction<void(int)> small = [counter](int inc) { *counter += inc; };
+		assert(small);
+		assert(!small.IsHeap());
+		small(2);
+		assert(*counter == 2);
+
+		//Move only captures are supported
+		auto owned = std::make_unique<int>(3);
+		SmallFunction<int()> moved = [owned = std::move(owned)]() { return *owned; };
+		assert(moved() == 3);
+
+		//Big ones go to the heap
+		std::array<uint8_t, 128> data = {};
+		data[127] = 5;
+		SmallFunction<int()> big = [data, counter]() { return data[127] + *counter; };
+		assert(big.IsHeap());
+		assert(big() == 7);
+
+		//Moving keeps the callable and releases the source
+		SmallFunction<void(int)> other = std::move(small);
+		assert(!small);
+		other(1);
+		assert(*counter == 3);
+		big = std::move(moved);
+		assert(!big.IsHeap());
+		assert(big() == 3);
+
+		//Captures are released on destruction
+		other.reset();
+		big.reset();
+		assert(counter.use_count() == 1);
+	}
+
+	void testWorkerPool()
+	{
+		Log("-testWorkerPool\n");
+
+		WorkerPool pool(2);
+		assert(pool.GetNumWorkers() == 2);
+
+		//Run several batches
+		for (int batch=0; batch<10; ++batch)
+		{
+			std::vector<int> done(25, 0);
+			std::vector<WorkerPool::Task> tasks;
+			for (size_t i=0; i<done.size(); ++i)
+				tasks.emplace_back([&done, i]() {
+					std::this_thread::sleep_for(std::chrono::microseconds(100));
+					done[i]++;
+				});
+			pool.Run(tasks);
+			//All have finished once when it returns
+			assert(std::all_of(done.begin(), done.end(), [](int count) { return count == 1; }));
+		}
+
+		//Empty batch
+		std::vector<WorkerPool::Task> empty;
+		pool.Run(empty);
+	}
+
+
+	void testTimerWheelRound()
+	{
+		Log("-testTimerWheelRound\n");
+
+		EventLoop loop;
+		loop.Start();
+
+		//Wheel round, 256 ticks of 100us
+		const int64_t round = 25600;
+		//Same clock as the loop
+		auto nowMicros = [](){ return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()); };
+
+		//Wait until the begining of a round
+		while (nowMicros().count() % round > 1000)
+			std::this_thread::sleep_for(100us);
+
+		//Get next round
+		auto start = nowMicros();
+		auto boundary = std::chrono::microseconds(start.count() - start.count() % round + round);
+
+		//Timer due just after the next round, it is on the upper level until then
+		std::chrono::microseconds fired = 0us;
+		auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(boundary - start) + 2ms;
+		auto scheduled = start + timeout;
+		auto timer = loop.CreateTimer(timeout, [&,nowMicros](std::chrono::milliseconds now){
+			fired = nowMicros();
+		});
+
+		//Wait until the end of the round
+		std::this_thread::sleep_until(std::chrono::system_clock::time_point(boundary - 2ms));
+		//Make the loop move the wheel forward
+		loop.Async([](std::chrono::milliseconds now){}).wait();
+		//Timer on level 0, due after the first one but on the next round
+		auto later = loop.CreateTimer(20ms, [](std::chrono::milliseconds now){});
+
+		//Wait for both
+		std::this_thread::sleep_for(50ms);
+		loop.Stop();
+
+		//The first one must not wait for the later one
+		Log("-testTimerWheelRound() [delay:%lldus]\n", (long long)(fired - scheduled).count());
+		assert(fired.count());
+		assert(fired - scheduled < 5ms);
+	}
+
+	void testUringRecvError()
+	{
+		Log("-testUringRecvError\n");
+
+		struct Listener : public EventLoop::Listener
+		{
+			virtual void OnRead(const int fd, const uint8_t* data, const size_t size, const uint32_t ipAddr, const uint16_t port) override
+			{
+				received++;
+			}
+			std::atomic<int> received = 0;
+		} listener;
+
+		//Get local address
+		auto bindLocal = [](int fd) {
+			sockaddr_in addr = {};
+			socklen_t len = sizeof(addr);
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			bind(fd, (sockaddr*)&addr, len);
+			getsockname(fd, (sockaddr*)&addr, &len);
+			return addr;
+		};
+
+		int fd = socket(AF_INET, SOCK_DGRAM, 0);
+		int peer = socket(AF_INET, SOCK_DGRAM, 0);
+		int gone = socket(AF_INET, SOCK_DGRAM, 0);
+		auto local = bindLocal(fd);
+		auto remote = bindLocal(peer);
+		auto closed = bindLocal(gone);
+		close(gone);
+
+		//Connect to a closed port so we get the icmp errors on recv
+		connect(fd, (sockaddr*)&closed, sizeof(closed));
+
+		EventLoop loop(&listener);
+		loop.Start(fd, EventLoop::Backend::IoUring);
+
+		//Get ECONNREFUSED on the socket
+		send(fd, "error", 5, 0);
+		std::this_thread::sleep_for(50ms);
+
+		//Connect to the peer so it can receive from it, disconnecting would release the local port
+		connect(fd, (sockaddr*)&remote, sizeof(remote));
+
+		//Loop must be still running
+		assert(loop.Async([](std::chrono::milliseconds now){}).wait_for(1s)==std::future_status::ready);
+
+		//And receiving
+		sendto(peer, "data", 4, 0, (sockaddr*)&local, sizeof(local));
+		for (int i = 0; i<100 && !listener.received; ++i)
+			std::this_thread::sleep_for(10ms);
+		assert(listener.received==1);
+
+		loop.Stop();
+		close(peer);
+		close(fd);
+	}
 };
 
 ToolsPlan tools;
@@ -0,0 +1,130 @@
+#include "test.h"
+#include "videomixer.h"
+#include "VideoEncoderGroup.h"
+
+#include <atomic>
+
+class VideoEncoderGroupTestPlan : public TestPlan
+{
+public:
+	VideoEncoderGroupTestPlan() : TestPlan("VideoEncoderGroup")
+	{
+	}
+
+	virtual void Execute()
+	{
+		testLifecycle();
+		testMixerEnded();
+	}
+
+	struct Listener : public MediaFrame::Listener
+	{
+		virtual void onMediaFrame(const MediaFrame& frame)		{ frames++;	}
+		virtual void onMediaFrame(DWORD ssrc, const MediaFrame& frame)	{ frames++;	}
+		std::atomic<int> frames = 0;
+	};
+
+	static void Mix(VideoMixer& mixer, int num)
+	{
+		//Compose mosaics without participants
+		for (int i=0; i<num; ++i)
+		{
+			mixer.Process(true, getTime());
+			usleep(40000);
+		}
+	}
+
+	void testLifecycle()
+	{
+		Log("-testLifecycle\n");
+
+		//Mix from this thread
+		Properties properties;
+		properties.SetProperty("online", 0);
+
+		VideoMixer mixer(L"test");
+		mixer.Init(properties);
+		int mosaicId = mixer.CreateMosaic(Mosaic::mosaic2x2, CIF);
+
+		VideoEncoderGroup group(mixer, mosaicId, {1024, 256, 512}, 0, properties);
+
+		//Bitrates are rounded down to the tiers, or to the lowest one
+		assert(group.GetTierBitrate(100) == 256);
+		assert(group.GetTierBitrate(256) == 256);
+		assert(group.GetTierBitrate(700) == 512);
+		assert(group.GetTierBitrate(5000) == 1024);
+
+		auto first  = std::make_shared<Listener>();
+		auto second = std::make_shared<Listener>();
+		auto third  = std::make_shared<Listener>();
+
+		//Same tier, one encoder
+		assert(group.AddListener(first, VideoCodec::VP8, 352, 288, 15, 300));
+		assert(group.AddListener(second, VideoCodec::VP8, 352, 288, 15, 400));
+		assert(!group.AddListener(first, VideoCodec::VP8, 352, 288, 15, 300));
+		assert(group.GetNumEncoders() == 1);
+		assert(group.GetNumListeners() == 2);
+
+		//New tier
+		assert(group.AddListener(third, VideoCodec::VP8, 352, 288, 15, 1000));
+		assert(group.GetNumEncoders() == 2);
+
+		VideoEncoderGroup::Tier tier;
+		assert(group.GetTier(second, tier) && tier.bitrate == 256);
+		assert(group.GetTier(third, tier) && tier.bitrate == 512);
+
+		//All get the encoded mosaic
+		group.SendFPU(first);
+		Mix(mixer, 10);
+		assert(first->frames && second->frames && third->frames);
+
+		//Encoder is kept until the last listener of the tier leaves
+		assert(group.RemoveListener(first));
+		assert(group.GetNumEncoders() == 2);
+		assert(group.RemoveListener(second));
+		assert(!group.RemoveListener(second));
+		assert(group.GetNumEncoders() == 1);
+		assert(!group.GetTier(second, tier));
+
+		//Deleting the mosaic stops feeding the remaining encoder
+		mixer.DeleteMosaic(mosaicId);
+		Mix(mixer, 2);
+		assert(group.RemoveListener(third));
+		assert(group.GetNumEncoders() == 0);
+
+		//Can't encode deleted mosaic
+		assert(!group.AddListener(first, VideoCodec::VP8, 352, 288, 15, 300));
+		assert(group.GetNumListeners() == 0);
+
+		group.End();
+		mixer.End();
+	}
+
+	void testMixerEnded()
+	{
+		Log("-testMixerEnded\n");
+
+		Properties properties;
+		properties.SetProperty("online", 0);
+
+		VideoMixer mixer(L"test");
+		mixer.Init(properties);
+		int mosaicId = mixer.CreateMosaic(Mosaic::mosaic2x2, CIF);
+
+		VideoEncoderGroup group(mixer, mosaicId, {}, 0, properties);
+
+		//Exact bitrate without tiers
+		assert(group.GetTierBitrate(300) == 300);
+
+		auto listener = std::make_shared<Listener>();
+		assert(group.AddListener(listener, VideoCodec::VP8, 352, 288, 15, 300));
+		Mix(mixer, 5);
+
+		//Ending the mixer first must not release the inputs still used by the encoders
+		mixer.End();
+		group.End();
+		assert(group.GetNumEncoders() == 0);
+	}
+};
+
+VideoEncoderGroupTestPlan videoEncoderGroup;
@@ -0,0 +1,122 @@
+#include "test.h"
+#include "VideoEncoderWorker.h"
+#include "pipevideoinput.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+class VideoEncoderWorkerTestPlan : public TestPlan
+{
+public:
+	VideoEncoderWorkerTestPlan() : TestPlan("VideoEncoderWorker")
+	{
+	}
+
+	virtual void Execute()
+	{
+		testRenditions();
+		testWrongRenditions();
+	}
+
+	struct Listener : public MediaFrame::Listener
+	{
+		virtual void onMediaFrame(const MediaFrame& frame)
+		{
+			//Not expected on rendition mode
+			plain++;
+		}
+		virtual void onMediaFrame(DWORD id, const MediaFrame& frame)
+		{
+			auto& video = static_cast<const VideoFrame&>(frame);
+			std::lock_guard<std::mutex> lock(mutex);
+			//Store size of each rendition by frame timestamp
+			grabs[video.GetTimestamp()][id] = {video.GetWidth(), video.GetHeight()};
+			frames++;
+		}
+
+		std::mutex mutex;
+		std::map<QWORD, std::map<DWORD, std::pair<DWORD, DWORD>>> grabs;
+		int frames = 0;
+		int plain = 0;
+	};
+
+	void testRenditions()
+	{
+		Log("-testRenditions\n");
+
+		const VideoEncoderWorker::Renditions renditions = {
+			{ 10, 320, 180, 200 },
+			{ 20, 640, 360, 500 },
+			{ 30, 160, 90,  100 },
+		};
+
+		PipeVideoInput input;
+		input.Init();
+
+		Properties properties;
+		VideoEncoderWorker worker;
+		assert(worker.Init(&input));
+		assert(worker.SetVideoCodec(VideoCodec::VP8, renditions, 25, 0, properties));
+
+		auto listener = std::make_shared<Listener>();
+		assert(worker.AddListener(listener));
+		assert(worker.Start());
+
+		//Feed a grey picture at the biggest size
+		std::vector<BYTE> picture(640*360*3/2, 0x80);
+		for (int i=0; i<40; ++i)
+		{
+			input.SetFrame(picture.data(), 640, 360);
+			usleep(40000);
+		}
+
+		worker.Stop();
+		worker.End();
+		input.End();
+
+		assert(!listener->plain);
+		assert(listener->frames);
+
+		bool complete = false;
+		for (const auto& [timestamp, encoded] : listener->grabs)
+		{
+			//Each rendition is encoded at its size
+			for (const auto& [id, size] : encoded)
+			{
+				auto it = std::find_if(renditions.begin(), renditions.end(), [id=id](const auto& rendition){ return rendition.id==id; });
+				assert(it!=renditions.end());
+				assert(size.first==(DWORD)it->width);
+				assert(size.second==(DWORD)it->height);
+			}
+			//All renditions of a grab share the timestamp
+			if (encoded.size()==renditions.size())
+				complete = true;
+		}
+		assert(complete);
+	}
+
+	void testWrongRenditions()
+	{
+		Log("-testWrongRenditions\n");
+
+		PipeVideoInput input;
+		input.Init();
+
+		Properties properties;
+		VideoEncoderWorker worker;
+		assert(worker.Init(&input));
+
+		//Odd sizes can't be scaled to I420
+		assert(!worker.SetVideoCodec(VideoCodec::VP8, {{ 1, 320, 180, 200 }, { 2, 161, 90, 100 }}, 25, 0, properties));
+		assert(!worker.SetVideoCodec(VideoCodec::VP8, {{ 1, 320, 181, 200 }}, 25, 0, properties));
+		//No bitrate
+		assert(!worker.SetVideoCodec(VideoCodec::VP8, {{ 1, 320, 180, 0 }}, 25, 0, properties));
+		assert(worker.SetVideoCodec(VideoCodec::VP8, {{ 1, 320, 180, 200 }}, 25, 0, properties));
+
+		worker.End();
+		input.End();
+	}
+};
+
+VideoEncoderWorkerTestPlan videoEncoderWorker;